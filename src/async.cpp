@@ -0,0 +1,91 @@
+/**
+ * Implementation of the background load, process and save steps
+ *
+ * @file async.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "async.h"
+
+namespace agl {
+
+std::future<Image> loadAsync(const std::string& filename, bool flip) {
+   return std::async(std::launch::async, [filename, flip]() {
+      Image image;
+      image.load(filename, flip);
+      return image;
+   });
+}
+
+AsyncPipeline::AsyncPipeline(int depth) :
+   _submitted(depth), _loaded(depth), _processed(depth), _failures(0), _finished(false) {
+   this->_loader = std::thread(&AsyncPipeline::loadJobs, this);
+   this->_processor = std::thread(&AsyncPipeline::processJobs, this);
+   this->_saver = std::thread(&AsyncPipeline::saveJobs, this);
+}
+
+AsyncPipeline::~AsyncPipeline() {
+   this->finish();
+}
+
+void AsyncPipeline::submit(const std::vector<std::string>& inputs, const std::string& output,
+   const Process& process) {
+   Job job;
+   job.inputs = inputs;
+   job.output = output;
+   job.process = process;
+   job.ok = true;
+   if (!this->_submitted.push(std::move(job))) {
+      std::cerr << "submit(): pipeline already finished" << std::endl;
+   }
+}
+
+int AsyncPipeline::finish() {
+   if (!this->_finished) {
+      this->_finished = true;
+      this->_submitted.close();
+      this->_loader.join();
+      this->_processor.join();
+      this->_saver.join();
+   }
+   return this->_failures;
+}
+
+void AsyncPipeline::loadJobs() {
+   Job job;
+   while (this->_submitted.pop(job)) {
+      job.images.resize(job.inputs.size());
+      for (size_t i = 0; i < job.inputs.size(); i++) {
+         job.ok = job.images[i].load(job.inputs[i]) && job.ok;
+      }
+      this->_loaded.push(std::move(job));
+   }
+   this->_loaded.close();
+}
+
+void AsyncPipeline::processJobs() {
+   Job job;
+   while (this->_loaded.pop(job)) {
+      if (job.ok) {
+         job.result = job.process(job.images);
+      }
+      // the inputs are no longer needed; free them before waiting
+      job.images.clear();
+      this->_processed.push(std::move(job));
+   }
+   this->_processed.close();
+}
+
+void AsyncPipeline::saveJobs() {
+   Job job;
+   while (this->_processed.pop(job)) {
+      if (!job.ok || !job.result.save(job.output)) {
+         std::cerr << "Job for " << job.output << " failed" << std::endl;
+         this->_failures++;
+      }
+      job.result = Image();
+   }
+}
+
+}  // namespace agl
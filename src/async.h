@@ -0,0 +1,165 @@
+/**
+ * Background loading, processing and saving of images, connected by
+ * bounded queues
+ *
+ * @file async.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_ASYNC_H_
+#define AGL_ASYNC_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image.h"
+
+namespace agl {
+
+/**
+ * @brief First-in first-out queue of at most capacity items, shared by
+ * producer and consumer threads
+ *
+ * push() waits while the queue is full, so a fast producer is held back
+ * to the pace of its consumer instead of piling up items.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : _capacity(capacity > 0 ? capacity : 1), _closed(false) {}
+
+  /**
+   * @brief Add item, waiting while the queue is full
+   * @return false, dropping item, if the queue was closed
+   */
+  bool push(T item) {
+     std::unique_lock<std::mutex> lock(this->_mutex);
+     this->_notFull.wait(lock, [this] { return this->_closed || this->_items.size() < this->_capacity; });
+     if (this->_closed) {
+        return false;
+     }
+     this->_items.push_back(std::move(item));
+     this->_notEmpty.notify_one();
+     return true;
+  }
+
+  /**
+   * @brief Take the oldest item, waiting while the queue is empty
+   * @return false once the queue is closed and every item has been taken
+   */
+  bool pop(T& item) {
+     std::unique_lock<std::mutex> lock(this->_mutex);
+     this->_notEmpty.wait(lock, [this] { return this->_closed || !this->_items.empty(); });
+     if (this->_items.empty()) {
+        return false;
+     }
+     item = std::move(this->_items.front());
+     this->_items.pop_front();
+     this->_notFull.notify_one();
+     return true;
+  }
+
+  /**
+   * @brief Accept no more items; consumers still receive the queued ones
+   */
+  void close() {
+     std::lock_guard<std::mutex> lock(this->_mutex);
+     this->_closed = true;
+     this->_notEmpty.notify_all();
+     this->_notFull.notify_all();
+  }
+
+ private:
+  std::mutex _mutex;
+  std::condition_variable _notEmpty;
+  std::condition_variable _notFull;
+  std::deque<T> _items;
+  size_t _capacity;
+  bool _closed;
+};
+
+/**
+ * @brief Start loading filename on another thread
+ *
+ * The image is empty (width 0) if it could not be loaded.
+ */
+std::future<Image> loadAsync(const std::string& filename, bool flip = false);
+
+/**
+ * @brief Runs jobs that load images, process them and save the result,
+ * with each step on its own thread
+ *
+ * While one job is processed, the next job's images are decoded and the
+ * previous job's result is encoded. The queues between the steps hold at
+ * most depth jobs, which bounds memory and makes submit() wait when the
+ * loader falls behind. Jobs are processed one at a time, in the order
+ * they were submitted; operators still use every thread of the pool.
+ *
+ * @verbatim
+ * AsyncPipeline jobs;
+ * jobs.submit({"a.png", "b.png"}, "out.png", [](std::vector<Image>& in) {
+ *    return in[0].add(in[1]).sobel();
+ * });
+ * jobs.finish();
+ * @endverbatim
+ */
+class AsyncPipeline {
+ public:
+  /**
+   * @brief Turns the loaded images of a job, in the order of its input
+   * file names, into the image to save
+   */
+  typedef std::function<Image(std::vector<Image>& inputs)> Process;
+
+  explicit AsyncPipeline(int depth = 2);
+
+  // waits for the submitted jobs
+  ~AsyncPipeline();
+
+  /**
+   * @brief Queue a job; waits while depth jobs are waiting to be loaded
+   */
+  void submit(const std::vector<std::string>& inputs, const std::string& output,
+     const Process& process);
+
+  /**
+   * @brief Wait for every submitted job to be saved; no jobs may be
+   * submitted afterwards
+   * @return The number of jobs that failed to load or save
+   */
+  int finish();
+
+ private:
+  struct Job {
+    std::vector<std::string> inputs;
+    std::string output;
+    Process process;
+    std::vector<Image> images;
+    Image result;
+    bool ok;
+  };
+
+  void loadJobs();
+  void processJobs();
+  void saveJobs();
+
+  // submitted, loaded and processed jobs
+  BoundedQueue<Job> _submitted;
+  BoundedQueue<Job> _loaded;
+  BoundedQueue<Job> _processed;
+  std::thread _loader;
+  std::thread _processor;
+  std::thread _saver;
+  std::atomic<int> _failures;
+  bool _finished;
+};
+}  // namespace agl
+#endif  // AGL_ASYNC_H_
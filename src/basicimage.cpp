@@ -0,0 +1,458 @@
+/**
+ * Implementation of images generic over their pixel format
+ *
+ * @file basicimage.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "basicimage.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "blur.h"
+#include "bufferpool.h"
+#include "stencil.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace agl {
+
+// luminance weights of red, green and blue, as Image::glow uses them
+static const float LUMA[3] = {0.3f, 0.59f, 0.11f};
+
+// a channel value of format F from a float in the same units, rounded and
+// clamped to [0, white()] for integer formats
+template <class F>
+static inline typename F::Channel toChannel(float value) {
+   typedef typename F::Channel Channel;
+   if (std::is_floating_point<Channel>::value) {
+      return (Channel) value;
+   }
+   return (Channel) std::min(std::max(value + 0.5f, 0.0f), (float) F::white());
+}
+
+// read count pixels of format F into rgba[0..3], count floats each of
+// red, green, blue and alpha from 0 to 1; one loop per channel, so the
+// compiler can vectorize them
+template <class F>
+static void toRgba(const typename F::Channel* px, int count, float* const rgba[4]) {
+   const int channels = F::CHANNELS;
+   float scale = 1.0f / F::white();
+   for (int c = 0; c < 3; c++) {
+      int from = channels == 1 ? 0 : c;
+      float* out = rgba[c];
+      for (int j = 0; j < count; j++) {
+         out[j] = px[j * channels + from] * scale;
+      }
+   }
+   float* alpha = rgba[3];
+   for (int j = 0; j < count; j++) {
+      alpha[j] = channels == 4 ? px[j * channels + 3] * scale : 1.0f;
+   }
+}
+
+// write count pixels of format F from rgba as toRgba reads them
+template <class F>
+static void fromRgba(const float* const rgba[4], int count, typename F::Channel* px) {
+   const int channels = F::CHANNELS;
+   float white = F::white();
+   if (channels == 1) {
+      const float* r = rgba[0];
+      const float* g = rgba[1];
+      const float* b = rgba[2];
+      for (int j = 0; j < count; j++) {
+         px[j] = toChannel<F>((LUMA[0] * r[j] + LUMA[1] * g[j] + LUMA[2] * b[j]) * white);
+      }
+      return;
+   }
+   for (int c = 0; c < channels; c++) {
+      const float* in = rgba[c];
+      for (int j = 0; j < count; j++) {
+         px[j * channels + c] = toChannel<F>(in[j] * white);
+      }
+   }
+}
+
+// count floats for each of red, green, blue and alpha
+struct RgbaRow {
+   std::vector<float> values;
+   float* planes[4];
+
+   explicit RgbaRow(int count) : values((size_t) count * 4) {
+      for (int c = 0; c < 4; c++) {
+         this->planes[c] = this->values.data() + (size_t) c * count;
+      }
+   }
+};
+
+template <class Format>
+BasicImage<Format>::BasicImage() {
+   this->_data = NULL;
+   this->_width = 0;
+   this->_height = 0;
+}
+
+template <class Format>
+BasicImage<Format>::BasicImage(int width, int height, bool zero) {
+   this->_data = (Channel*) BufferPool::shared().acquire(numBytes(width, height), zero);
+   this->_width = width;
+   this->_height = height;
+}
+
+template <class Format>
+BasicImage<Format>::BasicImage(const Image& image) : BasicImage(image.width(), image.height(), false) {
+   trace::Scope scope("convert", image.width(), image.height());
+   scope.arg("format", Format::name());
+   Image interleaved;
+   const unsigned char* rgb = image.data();
+   if (image.layout() == Layout::Planar) {
+      interleaved = image.toLayout(Layout::Interleaved);
+      rgb = interleaved.data();
+   }
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      RgbaRow rgba(this->_width);
+      for (int i = firstRow; i < lastRow; i++) {
+         toRgba<RGB8>(rgb + (size_t) i * this->_width * 3, this->_width, rgba.planes);
+         fromRgba<Format>(rgba.planes, this->_width, this->pixel(i, 0));
+      }
+   });
+}
+
+template <class Format>
+BasicImage<Format>::BasicImage(const BasicImage& orig) {
+   this->_width = orig._width;
+   this->_height = orig._height;
+   this->_data = NULL;
+   if (orig._data) {
+      this->_data = (Channel*) BufferPool::shared().acquire(numBytes(orig._width, orig._height), false);
+      memcpy(this->_data, orig._data, numBytes(orig._width, orig._height));
+   }
+}
+
+template <class Format>
+BasicImage<Format>::BasicImage(BasicImage&& orig) noexcept {
+   this->_data = orig._data;
+   this->_width = orig._width;
+   this->_height = orig._height;
+   orig._data = NULL;
+   orig._width = 0;
+   orig._height = 0;
+}
+
+template <class Format>
+BasicImage<Format>& BasicImage<Format>::operator=(const BasicImage& orig) {
+   if (&orig != this) {
+      *this = BasicImage(orig);
+   }
+   return *this;
+}
+
+template <class Format>
+BasicImage<Format>& BasicImage<Format>::operator=(BasicImage&& orig) noexcept {
+   if (&orig == this) {
+      return *this;
+   }
+   this->releaseData();
+   this->_data = orig._data;
+   this->_width = orig._width;
+   this->_height = orig._height;
+   orig._data = NULL;
+   orig._width = 0;
+   orig._height = 0;
+   return *this;
+}
+
+template <class Format>
+BasicImage<Format>::~BasicImage() {
+   this->releaseData();
+}
+
+template <class Format>
+void BasicImage<Format>::releaseData() {
+   BufferPool::shared().release((unsigned char*) this->_data, numBytes(this->_width, this->_height));
+   this->_data = NULL;
+}
+
+template <class Format>
+size_t BasicImage<Format>::numBytes(int width, int height) {
+   return (size_t) width * height * CHANNELS * sizeof(Channel);
+}
+
+template <class Format>
+int BasicImage<Format>::width() const {
+   return this->_width;
+}
+
+template <class Format>
+int BasicImage<Format>::height() const {
+   return this->_height;
+}
+
+template <class Format>
+typename BasicImage<Format>::Channel* BasicImage<Format>::data() const {
+   return this->_data;
+}
+
+template <class Format>
+template <class To>
+BasicImage<To> BasicImage<Format>::convert() const {
+   trace::Scope scope("convert", this->_width, this->_height);
+   scope.arg("format", To::name());
+   BasicImage<To> result(this->_width, this->_height, false);
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      RgbaRow rgba(this->_width);
+      for (int i = firstRow; i < lastRow; i++) {
+         toRgba<Format>(this->pixel(i, 0), this->_width, rgba.planes);
+         fromRgba<To>(rgba.planes, this->_width, result.pixel(i, 0));
+      }
+   });
+   return result;
+}
+
+template <class Format>
+Image BasicImage<Format>::toImage() const {
+   trace::Scope scope("convert", this->_width, this->_height);
+   scope.arg("format", RGB8::name());
+   Image result(this->_width, this->_height, false);
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      RgbaRow rgba(this->_width);
+      for (int i = firstRow; i < lastRow; i++) {
+         toRgba<Format>(this->pixel(i, 0), this->_width, rgba.planes);
+         fromRgba<RGB8>(rgba.planes, this->_width, result.data() + (size_t) i * this->_width * 3);
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::invert() const {
+   trace::Scope scope("invert", this->_width, this->_height);
+   scope.arg("format", Format::name());
+   BasicImage result(*this);
+   int colors = CHANNELS == 4 ? 3 : CHANNELS;
+   Channel white = Format::white();
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         Channel* px = result.pixel(i, 0);
+         for (int j = 0; j < this->_width; j++, px += CHANNELS) {
+            for (int c = 0; c < colors; c++) {
+               px[c] = white - px[c];
+            }
+         }
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::add(const BasicImage& other) const {
+   trace::Scope scope("add", this->_width, this->_height);
+   scope.arg("format", Format::name());
+   BasicImage result(this->_width, this->_height, false);
+   const Channel* a = this->_data;
+   const Channel* b = other._data;
+   Channel* out = result._data;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      size_t rowSize = (size_t) this->_width * CHANNELS;
+      for (size_t k = firstRow * rowSize; k < lastRow * rowSize; k++) {
+         out[k] = toChannel<Format>((float) a[k] + (float) b[k]);
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::alphaBlend(const BasicImage& other, float alpha) const {
+   trace::Scope scope("alphaBlend", this->_width, this->_height);
+   scope.arg("format", Format::name()).arg("alpha", alpha);
+   BasicImage result(this->_width, this->_height, false);
+   const Channel* a = this->_data;
+   const Channel* b = other._data;
+   Channel* out = result._data;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      size_t rowSize = (size_t) this->_width * CHANNELS;
+      for (size_t k = firstRow * rowSize; k < lastRow * rowSize; k++) {
+         out[k] = toChannel<Format>(a[k] * (1 - alpha) + b[k] * alpha);
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::blurGaussian(float sigma) const {
+   trace::Scope scope("blurGaussian", this->_width, this->_height);
+   scope.arg("format", Format::name()).arg("sigma", sigma);
+   if (sigma <= 0.0f) {
+      return BasicImage(*this);
+   }
+   BasicImage result(this->_width, this->_height, false);
+   // 8-bit gray and RGB are what the blur engine already takes, and it
+   // sums in float too
+   if (std::is_same<Channel, unsigned char>::value && (CHANNELS == 1 || CHANNELS == 3)) {
+      blur::gaussianSeparable((const unsigned char*) this->_data, (unsigned char*) result._data,
+         this->_width, this->_height, sigma, CHANNELS);
+      return result;
+   }
+   int radius = std::max((int) ceil(3 * sigma), 1);
+   std::vector<float> kernel(2 * radius + 1);
+   float kernelSum = 0.0f;
+   for (int k = -radius; k <= radius; k++) {
+      kernel[k + radius] = exp(-(k * k) / (2 * sigma * sigma));
+      kernelSum += kernel[k + radius];
+   }
+   for (float& weight : kernel) {
+      weight /= kernelSum;
+   }
+   size_t rowSize = (size_t) this->_width * CHANNELS;
+   PoolVector<float> tmp(rowSize * this->_height);
+
+   // horizontal pass into tmp, with columns outside the image clamped
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         const Channel* in = this->pixel(i, 0);
+         float* out = &tmp[i * rowSize];
+         for (int j = 0; j < this->_width; j++) {
+            float sum[CHANNELS] = {};
+            for (int k = -radius; k <= radius; k++) {
+               const Channel* px = in + std::min(std::max(j + k, 0), this->_width - 1) * CHANNELS;
+               for (int c = 0; c < CHANNELS; c++) {
+                  sum[c] += kernel[k + radius] * px[c];
+               }
+            }
+            for (int c = 0; c < CHANNELS; c++) {
+               out[j * CHANNELS + c] = sum[c];
+            }
+         }
+      }
+   });
+
+   // vertical pass, accumulating whole rows so memory is read in order
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      std::vector<float> sum(rowSize);
+      for (int i = firstRow; i < lastRow; i++) {
+         std::fill(sum.begin(), sum.end(), 0.0f);
+         for (int k = -radius; k <= radius; k++) {
+            const float* in = &tmp[std::min(std::max(i + k, 0), this->_height - 1) * rowSize];
+            float weight = kernel[k + radius];
+            for (size_t idx = 0; idx < rowSize; idx++) {
+               sum[idx] += weight * in[idx];
+            }
+         }
+         Channel* out = result.pixel(i, 0);
+         for (size_t idx = 0; idx < rowSize; idx++) {
+            out[idx] = toChannel<Format>(sum[idx]);
+         }
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::sobel() const {
+   trace::Scope scope("sobel", this->_width, this->_height);
+   scope.arg("format", Format::name());
+   BasicImage result(this->_width, this->_height, false);
+   // 8-bit gray and RGB have vector kernels, which match the code below
+   if (std::is_same<Channel, unsigned char>::value && (CHANNELS == 1 || CHANNELS == 3)) {
+      parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+         (CHANNELS == 1 ? stencil::sobelPlane : stencil::sobel)((const unsigned char*) this->_data, 0,
+            (unsigned char*) result.pixel(firstRow, 0), this->_width, this->_height, firstRow, lastRow);
+      });
+      return result;
+   }
+   int colors = CHANNELS == 4 ? 3 : CHANNELS;
+   bool integer = !std::is_floating_point<Channel>::value;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         Channel* out = result.pixel(i, 0);
+         for (int j = 0; j < this->_width; j++) {
+            for (int c = 0; c < colors; c++) {
+               double v[3][3];
+               for (int k = 0; k < 3; k++) {
+                  for (int l = 0; l < 3; l++) {
+                     int row = i + k - 1, col = j + l - 1;
+                     bool inside = 0 <= row && row < this->_height && 0 <= col && col < this->_width;
+                     v[k][l] = inside ? this->pixel(row, col)[c] : 0.0;
+                  }
+               }
+               double gx = (v[0][0] - v[0][2]) + 2 * (v[1][0] - v[1][2]) + (v[2][0] - v[2][2]);
+               double gy = (v[0][0] + 2 * v[0][1] + v[0][2]) - (v[2][0] + 2 * v[2][1] + v[2][2]);
+               double magnitude = sqrt(gx * gx + gy * gy);
+               // integer formats take the floor, as Image::sobel does
+               out[j * CHANNELS + c] = integer ?
+                  (Channel) std::min(floor(magnitude), (double) Format::white()) : (Channel) magnitude;
+            }
+            if (CHANNELS == 4) {
+               out[j * CHANNELS + 3] = this->pixel(i, j)[3];
+            }
+         }
+      }
+   });
+   return result;
+}
+
+template <class Format>
+BasicImage<Format> BasicImage<Format>::glow() const {
+   trace::Scope scope("glow", this->_width, this->_height);
+   scope.arg("format", Format::name());
+   float threshold = 0.7f;
+   BasicImage<Float32> mask(this->_width, this->_height, false);
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      RgbaRow rgba(this->_width);
+      for (int i = firstRow; i < lastRow; i++) {
+         // the luminance, as a Float32 conversion takes it, then thresholded
+         float* out = mask.pixel(i, 0);
+         toRgba<Format>(this->pixel(i, 0), this->_width, rgba.planes);
+         fromRgba<Float32>(rgba.planes, this->_width, out);
+         for (int j = 0; j < this->_width; j++) {
+            out[j] = out[j] > threshold ? 1.0f : 0.0f;
+         }
+      }
+   });
+   mask = mask.blurGaussian();
+   BasicImage result(this->_width, this->_height, false);
+   int colors = CHANNELS == 4 ? 3 : CHANNELS;
+   float white = Format::white();
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         const Channel* in = this->pixel(i, 0);
+         const float* amount = mask.pixel(i, 0);
+         Channel* out = result.pixel(i, 0);
+         for (int j = 0; j < this->_width; j++) {
+            float alpha = amount[j];
+            for (int c = 0; c < CHANNELS; c++) {
+               float x = in[j * CHANNELS + c];
+               out[j * CHANNELS + c] = c < colors ? toChannel<Format>(x * (1 - alpha) + white * alpha) : in[j * CHANNELS + c];
+            }
+         }
+      }
+   });
+   return result;
+}
+
+// the formats and conversions compiled here
+template class BasicImage<Gray8>;
+template class BasicImage<RGB8>;
+template class BasicImage<RGBA8>;
+template class BasicImage<RGB16>;
+template class BasicImage<Float32>;
+template class BasicImage<Float32x3>;
+
+#define AGL_CONVERT(From, To) template BasicImage<To> BasicImage<From>::convert<To>() const;
+#define AGL_CONVERT_FROM(From) \
+   AGL_CONVERT(From, Gray8) AGL_CONVERT(From, RGB8) AGL_CONVERT(From, RGBA8) \
+   AGL_CONVERT(From, RGB16) AGL_CONVERT(From, Float32) AGL_CONVERT(From, Float32x3)
+
+AGL_CONVERT_FROM(Gray8)
+AGL_CONVERT_FROM(RGB8)
+AGL_CONVERT_FROM(RGBA8)
+AGL_CONVERT_FROM(RGB16)
+AGL_CONVERT_FROM(Float32)
+AGL_CONVERT_FROM(Float32x3)
+
+}  // namespace agl
@@ -0,0 +1,174 @@
+/**
+ * Images generic over their pixel format, for single-channel, 16-bit and
+ * floating-point intermediates
+ *
+ * @file basicimage.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_BASICIMAGE_H_
+#define AGL_BASICIMAGE_H_
+
+#include <cstdint>
+
+#include "image.h"
+
+namespace agl {
+
+// Pixel formats: the type of a channel, the number of channels, the
+// value of a channel at full intensity, and a name for traces. Integer
+// formats saturate at white(); float formats keep any value, with 1 as
+// full intensity.
+
+// luminance only
+struct Gray8 {
+  typedef unsigned char Channel;
+  static const int CHANNELS = 1;
+  static Channel white() { return 255; }
+  static const char* name() { return "gray8"; }
+};
+
+// the format of Image
+struct RGB8 {
+  typedef unsigned char Channel;
+  static const int CHANNELS = 3;
+  static Channel white() { return 255; }
+  static const char* name() { return "rgb8"; }
+};
+
+// RGB and opacity, with 255 opaque
+struct RGBA8 {
+  typedef unsigned char Channel;
+  static const int CHANNELS = 4;
+  static Channel white() { return 255; }
+  static const char* name() { return "rgba8"; }
+};
+
+struct RGB16 {
+  typedef uint16_t Channel;
+  static const int CHANNELS = 3;
+  static Channel white() { return 65535; }
+  static const char* name() { return "rgb16"; }
+};
+
+// luminance as a float, e.g. a mask
+struct Float32 {
+  typedef float Channel;
+  static const int CHANNELS = 1;
+  static Channel white() { return 1.0f; }
+  static const char* name() { return "float32"; }
+};
+
+struct Float32x3 {
+  typedef float Channel;
+  static const int CHANNELS = 3;
+  static Channel white() { return 1.0f; }
+  static const char* name() { return "float32x3"; }
+};
+
+/**
+ * @brief A width by height image of Format pixels, channels interleaved
+ *
+ * Image is always 8-bit RGB. A BasicImage stores only what a step needs:
+ * a Gray8 edge map is a third of the size of an RGB one, and a chain of
+ * Float32x3 operators rounds once, when converted back, rather than after
+ * every step. The operators are compiled separately for each format.
+ *
+ * Conversions are explicit, through normalized floats: channels are
+ * scaled from white() of one format to the other's, gray becomes equal
+ * r, g and b, color becomes gray as 0.3 r + 0.59 g + 0.11 b, missing
+ * alpha is opaque, and integer results are rounded and clamped.
+ *
+ * @verbatim
+ * Image photo;
+ * photo.load("../images/rose.jpg");
+ * Image edges = BasicImage<Gray8>(photo).sobel().toImage();
+ * Image glowing = BasicImage<Float32x3>(photo).glow().toImage();
+ * @endverbatim
+ */
+template <class Format>
+class BasicImage {
+ public:
+  typedef typename Format::Channel Channel;
+  static const int CHANNELS = Format::CHANNELS;
+
+  BasicImage();
+
+  /**
+   * @brief Create a width by height image
+   * @param zero Whether to clear the pixels to 0
+   */
+  BasicImage(int width, int height, bool zero = true);
+
+  /**
+   * @brief Convert an Image, in either layout, to this format
+   */
+  explicit BasicImage(const Image& image);
+
+  BasicImage(const BasicImage& orig);
+  BasicImage(BasicImage&& orig) noexcept;
+  BasicImage& operator=(const BasicImage& orig);
+  BasicImage& operator=(BasicImage&& orig) noexcept;
+  ~BasicImage();
+
+  int width() const;
+  int height() const;
+
+  // return the width * height * CHANNELS channels, row by row
+  Channel* data() const;
+
+  // return the first channel of the pixel at (row, col)
+  Channel* pixel(int row, int col) const {
+    return this->_data + ((size_t) row * this->_width + col) * CHANNELS;
+  }
+
+  /**
+   * @brief Return this image converted to format To
+   */
+  template <class To>
+  BasicImage<To> convert() const;
+
+  /**
+   * @brief Return this image converted to an interleaved Image
+   */
+  Image toImage() const;
+
+  // Operators return a new image in the same format. Alpha, if any, is
+  // kept by invert and sobel and treated as a channel by the others.
+
+  // Replace each channel x with white() - x
+  BasicImage invert() const;
+
+  // Add the channels of an image of the same size
+  BasicImage add(const BasicImage& other) const;
+
+  // this * (1 - alpha) + other * alpha, for an image of the same size
+  BasicImage alphaBlend(const BasicImage& other, float alpha) const;
+
+  // Gaussian blur with standard deviation sigma in pixels, summed in float
+  // through both passes; pixels outside the image repeat the edge
+  BasicImage blurGaussian(float sigma = 8.0f) const;
+
+  // Per channel Sobel gradient magnitude; neighbors outside the image
+  // count as 0
+  BasicImage sobel() const;
+
+  // Blend towards white around pixels brighter than 70%, through a blurred
+  // Float32 mask
+  BasicImage glow() const;
+
+ private:
+  // bytes of pixel data in a width by height image
+  static size_t numBytes(int width, int height);
+
+  // return the pixel buffer to the pool
+  void releaseData();
+
+  Channel* _data;
+  int _width;
+  int _height;
+};
+
+}  // namespace agl
+#endif  // AGL_BASICIMAGE_H_
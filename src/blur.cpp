@@ -0,0 +1,246 @@
+/**
+ * Implementation of the Gaussian blur engine
+ *
+ * @file blur.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "blur.h"
+
+#include "bufferpool.h"
+#include "threadpool.h"
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+namespace agl {
+namespace blur {
+
+// floats per column range handed to a thread by the vertical recursive pass
+static const int COLUMN_GRAIN = 1024;
+
+// Feedback coefficients of the Young-van Vliet filter, divided by b0
+struct Recursive {
+   float B;
+   float b1;
+   float b2;
+   float b3;
+   // maps the last three causal outputs, relative to the edge value, to
+   // the first three anti-causal outputs past the edge (Triggs-Sdika)
+   float M[3][3];
+};
+
+static unsigned char toByte(float value) {
+   return (unsigned char) std::min(std::max(value + 0.5f, 0.0f), 255.0f);
+}
+
+static std::vector<float> gaussianKernel(float sigma, int radius) {
+   std::vector<float> kernel(2 * radius + 1);
+   float kernelSum = 0.0f;
+   for (int k = -radius; k <= radius; k++) {
+      kernel[k + radius] = exp(-(k * k) / (2 * sigma * sigma));
+      kernelSum += kernel[k + radius];
+   }
+   for (int k = 0; k < (int) kernel.size(); k++) {
+      kernel[k] /= kernelSum;
+   }
+   return kernel;
+}
+
+// horizontal pass of gaussianSeparable over one row of CHANNELS
+// interleaved channels, through padded, which has room for the row and
+// radius pixels of its edge on each side
+template <int CHANNELS>
+static void separableRow(const unsigned char* in, float* out, std::vector<float>& padded,
+      const std::vector<float>& kernel, int width, int radius) {
+   int taps = 2 * radius + 1;
+   for (int j = -radius; j < width + radius; j++) {
+      int l = std::min(std::max(j, 0), width - 1);
+      for (int c = 0; c < CHANNELS; c++) {
+         padded[(j + radius) * CHANNELS + c] = in[l * CHANNELS + c];
+      }
+   }
+   for (int j = 0; j < width; j++) {
+      float sum[CHANNELS] = {};
+      const float* window = &padded[j * CHANNELS];
+      for (int k = 0; k < taps; k++) {
+         for (int c = 0; c < CHANNELS; c++) {
+            sum[c] += kernel[k] * window[k * CHANNELS + c];
+         }
+      }
+      for (int c = 0; c < CHANNELS; c++) {
+         out[j * CHANNELS + c] = sum[c];
+      }
+   }
+}
+
+void gaussianSeparable(const unsigned char* src, unsigned char* dst,
+      int width, int height, float sigma, int channels) {
+   int radius = std::max((int) ceil(3 * sigma), 1);
+   std::vector<float> kernel = gaussianKernel(sigma, radius);
+   int taps = 2 * radius + 1;
+   int rowSize = width * channels;
+   PoolVector<float> tmp((size_t) rowSize * height);
+
+   // horizontal pass into tmp, through a row padded with its edge pixels
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      std::vector<float> padded((width + 2 * radius) * channels);
+      for (int i = firstRow; i < lastRow; i++) {
+         (channels == 1 ? separableRow<1> : separableRow<3>)(src + i * rowSize, &tmp[i * rowSize],
+            padded, kernel, width, radius);
+      }
+   });
+
+   // vertical pass, accumulating whole rows so memory is read in order
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      std::vector<float> sum(rowSize);
+      for (int i = firstRow; i < lastRow; i++) {
+         std::fill(sum.begin(), sum.end(), 0.0f);
+         for (int k = 0; k < taps; k++) {
+            int row = std::min(std::max(i + k - radius, 0), height - 1);
+            const float* in = &tmp[row * rowSize];
+            float weight = kernel[k];
+            for (int idx = 0; idx < rowSize; idx++) {
+               sum[idx] += weight * in[idx];
+            }
+         }
+         unsigned char* out = dst + i * rowSize;
+         for (int idx = 0; idx < rowSize; idx++) {
+            out[idx] = toByte(sum[idx]);
+         }
+      }
+   });
+}
+
+// I. T. Young and L. J. van Vliet, "Recursive implementation of the
+// Gaussian filter", Signal Processing 44 (1995)
+static Recursive recursiveCoefficients(float sigma) {
+   double q;
+   if (sigma >= 2.5) {
+      q = 0.98711 * sigma - 0.96330;
+   } else {
+      q = 3.97156 - 4.14554 * sqrt(1 - 0.26891 * sigma);
+   }
+   double q2 = q * q;
+   double q3 = q2 * q;
+   double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+   double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+   double b2 = -(1.4281 * q2 + 1.26661 * q3);
+   double b3 = 0.422205 * q3;
+   Recursive coeffs;
+   coeffs.b1 = b1 / b0;
+   coeffs.b2 = b2 / b0;
+   coeffs.b3 = b3 / b0;
+   coeffs.B = 1 - (coeffs.b1 + coeffs.b2 + coeffs.b3);
+
+   // The boundary matrix is linear in the causal state, so it is found by
+   // running the filter past the edge once for each unit state. The tail
+   // is long enough for the impulse response to decay below float epsilon.
+   int tail = (int) (12 * sigma) + 64;
+   std::vector<double> w(tail + 3), y(tail + 6);
+   for (int unit = 0; unit < 3; unit++) {
+      std::fill(w.begin(), w.end(), 0.0);
+      std::fill(y.begin(), y.end(), 0.0);
+      w[2 - unit] = 1.0;
+      for (int n = 3; n < tail + 3; n++) {
+         w[n] = coeffs.b1 * w[n - 1] + coeffs.b2 * w[n - 2] + coeffs.b3 * w[n - 3];
+      }
+      for (int n = tail + 2; n >= 3; n--) {
+         y[n] = coeffs.B * w[n] + coeffs.b1 * y[n + 1] + coeffs.b2 * y[n + 2] + coeffs.b3 * y[n + 3];
+      }
+      for (int k = 0; k < 3; k++) {
+         coeffs.M[k][unit] = (float) y[3 + k];
+      }
+   }
+   return coeffs;
+}
+
+// Anti-causal state just past the edge, given the last three causal
+// outputs w1, w2, w3 (w1 nearest the edge) and the edge input value
+static void boundary(const Recursive& f, float w1, float w2, float w3,
+      float edge, float* y1, float* y2, float* y3) {
+   float d1 = w1 - edge, d2 = w2 - edge, d3 = w3 - edge;
+   *y1 = edge + f.M[0][0] * d1 + f.M[0][1] * d2 + f.M[0][2] * d3;
+   *y2 = edge + f.M[1][0] * d1 + f.M[1][1] * d2 + f.M[1][2] * d3;
+   *y3 = edge + f.M[2][0] * d1 + f.M[2][1] * d2 + f.M[2][2] * d3;
+}
+
+// Filter count values spaced stride apart, forward then backward. Values
+// beyond either end are taken to equal the end value.
+static void recursiveLine(float* data, int count, int stride, const Recursive& f) {
+   float edge = data[(count - 1) * stride];
+   float w1 = data[0], w2 = data[0], w3 = data[0];
+   for (int n = 0; n < count; n++) {
+      float w = f.B * data[n * stride] + f.b1 * w1 + f.b2 * w2 + f.b3 * w3;
+      data[n * stride] = w;
+      w3 = w2; w2 = w1; w1 = w;
+   }
+   float y1, y2, y3;
+   boundary(f, w1, w2, w3, edge, &y1, &y2, &y3);
+   for (int n = count - 1; n >= 0; n--) {
+      float y = f.B * data[n * stride] + f.b1 * y1 + f.b2 * y2 + f.b3 * y3;
+      data[n * stride] = y;
+      y3 = y2; y2 = y1; y1 = y;
+   }
+}
+
+void gaussianRecursive(const unsigned char* src, unsigned char* dst,
+      int width, int height, float sigma, int channels) {
+   Recursive f = recursiveCoefficients(sigma);
+   int rowSize = width * channels;
+   PoolVector<float> tmp((size_t) rowSize * height);
+
+   // horizontal pass, one channel of one row at a time
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int idx = i * rowSize; idx < (i + 1) * rowSize; idx++) {
+            tmp[idx] = src[idx];
+         }
+         for (int c = 0; c < channels; c++) {
+            recursiveLine(&tmp[i * rowSize + c], width, channels, f);
+         }
+      }
+   });
+
+   // vertical pass, filtering whole rows at once so memory is read in
+   // order; threads take disjoint ranges of columns
+   std::vector<float> first(tmp.begin(), tmp.begin() + rowSize);
+   std::vector<float> edge(tmp.end() - rowSize, tmp.end());
+   std::vector<float> past(rowSize * 3);
+   parallelFor(0, rowSize, COLUMN_GRAIN, [&](int firstCol, int lastCol) {
+      for (int i = 0; i < height; i++) {
+         float* row = &tmp[i * rowSize];
+         const float* r1 = i >= 1 ? &tmp[(i - 1) * rowSize] : &first[0];
+         const float* r2 = i >= 2 ? &tmp[(i - 2) * rowSize] : &first[0];
+         const float* r3 = i >= 3 ? &tmp[(i - 3) * rowSize] : &first[0];
+         for (int idx = firstCol; idx < lastCol; idx++) {
+            row[idx] = f.B * row[idx] + f.b1 * r1[idx] + f.b2 * r2[idx] + f.b3 * r3[idx];
+         }
+      }
+      for (int idx = firstCol; idx < lastCol; idx++) {
+         float w1 = tmp[(height - 1) * rowSize + idx];
+         float w2 = height >= 2 ? tmp[(height - 2) * rowSize + idx] : first[idx];
+         float w3 = height >= 3 ? tmp[(height - 3) * rowSize + idx] : first[idx];
+         boundary(f, w1, w2, w3, edge[idx],
+            &past[idx], &past[rowSize + idx], &past[2 * rowSize + idx]);
+      }
+      for (int i = height - 1; i >= 0; i--) {
+         float* row = &tmp[i * rowSize];
+         const float* r1 = i + 1 < height ? &tmp[(i + 1) * rowSize] : &past[(i + 1 - height) * rowSize];
+         const float* r2 = i + 2 < height ? &tmp[(i + 2) * rowSize] : &past[(i + 2 - height) * rowSize];
+         const float* r3 = i + 3 < height ? &tmp[(i + 3) * rowSize] : &past[(i + 3 - height) * rowSize];
+         for (int idx = firstCol; idx < lastCol; idx++) {
+            row[idx] = f.B * row[idx] + f.b1 * r1[idx] + f.b2 * r2[idx] + f.b3 * r3[idx];
+         }
+         unsigned char* out = dst + i * rowSize;
+         for (int idx = firstCol; idx < lastCol; idx++) {
+            out[idx] = toByte(row[idx]);
+         }
+      }
+   });
+}
+
+}  // namespace blur
+}  // namespace agl
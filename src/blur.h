@@ -0,0 +1,40 @@
+/**
+ * Gaussian blur engine with separable and recursive (IIR) implementations
+ *
+ * Both functions read width * height pixels of channels interleaved bytes,
+ * 3 for RGB or 1 for one plane of a planar image, from src and write the
+ * blurred pixels to dst. src and dst must not overlap. Pixels outside the
+ * image repeat the nearest edge pixel.
+ *
+ * @file blur.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_BLUR_H_
+#define AGL_BLUR_H_
+
+namespace agl {
+namespace blur {
+
+/**
+ * @brief Blur with a sampled Gaussian kernel of radius ceil(3 * sigma)
+ *
+ * Runs a horizontal pass then a vertical pass, so the cost per pixel is
+ * linear in sigma rather than quadratic.
+ */
+void gaussianSeparable(const unsigned char* src, unsigned char* dst,
+   int width, int height, float sigma, int channels = 3);
+
+/**
+ * @brief Blur with the Young-van Vliet recursive Gaussian filter
+ *
+ * A third-order causal and anti-causal IIR filter per axis; the cost per
+ * pixel does not depend on sigma. Sigma must be at least 0.5.
+ */
+void gaussianRecursive(const unsigned char* src, unsigned char* dst,
+   int width, int height, float sigma, int channels = 3);
+
+}  // namespace blur
+}  // namespace agl
+#endif  // AGL_BLUR_H_
@@ -0,0 +1,184 @@
+/**
+ * Implementation of the pixel buffer pool
+ *
+ * @file bufferpool.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "bufferpool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace agl {
+
+// free buffers the shared pool keeps by default (enough for a few
+// full-frame temporaries of a large image)
+static const size_t DEFAULT_CAPACITY = 256 * 1024 * 1024;
+
+// bytes handed out to the current thread, for tracing
+static thread_local size_t threadAcquired = 0;
+
+BufferPool::BufferPool(size_t capacity) {
+   this->_cached = 0;
+   this->_capacity = capacity;
+   this->_live = 0;
+   this->_peak = 0;
+   this->_peakResident = 0;
+   this->_allocations = 0;
+   this->_largest = 0;
+}
+
+BufferPool::~BufferPool() {
+   this->trim();
+}
+
+unsigned char* BufferPool::acquire(size_t bytes, bool zero) {
+   if (bytes == 0) {
+      return NULL;
+   }
+   unsigned char* data = NULL;
+   {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      auto bucket = this->_free.find(bytes);
+      if (bucket != this->_free.end() && !bucket->second.empty()) {
+         data = bucket->second.back();
+         bucket->second.pop_back();
+         this->_cached -= bytes;
+      }
+      this->track(bytes);
+   }
+   if (!data) {
+      // calloc can hand back fresh zero pages without touching them
+      return (unsigned char*) (zero ? calloc(bytes, 1) : malloc(bytes));
+   }
+   if (zero) {
+      memset(data, 0, bytes);
+   }
+   return data;
+}
+
+void BufferPool::release(unsigned char* data, size_t bytes) {
+   if (!data) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      this->_live -= std::min(bytes, this->_live);
+      if (bytes <= this->_capacity) {
+         this->_free[bytes].push_back(data);
+         this->_cached += bytes;
+         this->shrink(this->_capacity);
+         return;
+      }
+   }
+   free(data);
+}
+
+void BufferPool::adopt(unsigned char* data, size_t bytes) {
+   if (!data) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->track(bytes);
+}
+
+void BufferPool::trim() {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->shrink(0);
+}
+
+void BufferPool::setCapacity(size_t capacity) {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->_capacity = capacity;
+   this->shrink(capacity);
+}
+
+size_t BufferPool::cachedBytes() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   return this->_cached;
+}
+
+MemoryStats BufferPool::stats() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   MemoryStats stats;
+   stats.liveBytes = this->_live;
+   stats.peakBytes = this->_peak;
+   stats.peakResidentBytes = this->_peakResident;
+   stats.cachedBytes = this->_cached;
+   stats.allocations = this->_allocations;
+   stats.largestBuffer = this->_largest;
+   return stats;
+}
+
+void BufferPool::resetPeak() {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->_peak = this->_live;
+   this->_peakResident = this->_live + this->_cached;
+}
+
+void BufferPool::report(std::ostream& os) const {
+   MemoryStats stats = this->stats();
+   const double MB = 1024.0 * 1024.0;
+   os << "Pixel memory: " << stats.liveBytes / MB << " MB live, "
+      << stats.peakBytes / MB << " MB peak, "
+      << stats.peakResidentBytes / MB << " MB peak with cache, "
+      << stats.cachedBytes / MB << " MB cached, "
+      << stats.allocations << " allocations, largest "
+      << stats.largestBuffer / MB << " MB" << std::endl;
+}
+
+size_t BufferPool::threadBytes() {
+   return threadAcquired;
+}
+
+void BufferPool::track(size_t bytes) {
+   threadAcquired += bytes;
+   this->_live += bytes;
+   this->_peak = std::max(this->_peak, this->_live);
+   // a reused buffer moves from cached to live, so only fresh ones raise
+   // the total
+   this->_peakResident = std::max(this->_peakResident, this->_live + this->_cached);
+   this->_allocations++;
+   this->_largest = std::max(this->_largest, bytes);
+}
+
+// report the shared pool's counters; registered with atexit
+static void reportAtExit() {
+   BufferPool::shared().report(std::cerr);
+}
+
+void BufferPool::shrink(size_t limit) {
+   for (auto bucket = this->_free.begin(); bucket != this->_free.end() && this->_cached > limit; ) {
+      std::vector<unsigned char*>& buffers = bucket->second;
+      while (!buffers.empty() && this->_cached > limit) {
+         free(buffers.back());
+         buffers.pop_back();
+         this->_cached -= bucket->first;
+      }
+      if (buffers.empty()) {
+         bucket = this->_free.erase(bucket);
+      } else {
+         ++bucket;
+      }
+   }
+}
+
+// create the shared pool, reporting it at exit if AGL_MEMORY_STATS is set
+static BufferPool* createShared() {
+   BufferPool* pool = new BufferPool(DEFAULT_CAPACITY);
+   if (getenv("AGL_MEMORY_STATS")) {
+      atexit(reportAtExit);
+   }
+   return pool;
+}
+
+BufferPool& BufferPool::shared() {
+   // never destroyed, so images destroyed during exit can still release
+   static BufferPool* pool = createShared();
+   return *pool;
+}
+
+}  // namespace agl
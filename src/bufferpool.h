@@ -0,0 +1,169 @@
+/**
+ * Recycling pool for image pixel buffers
+ *
+ * @file bufferpool.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_BUFFERPOOL_H_
+#define AGL_BUFFERPOOL_H_
+
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace agl {
+
+/**
+ * @brief Pixel memory counters of a BufferPool
+ */
+struct MemoryStats {
+    // bytes in buffers handed out and not yet released
+    size_t liveBytes;
+    // most live bytes at any one time
+    size_t peakBytes;
+    // most live plus cached bytes at any one time, the pixel memory the
+    // process actually held
+    size_t peakResidentBytes;
+    // bytes in free buffers kept for reuse
+    size_t cachedBytes;
+    // buffers handed out, whether fresh or reused
+    size_t allocations;
+    // size of the largest buffer handed out
+    size_t largestBuffer;
+};
+
+/**
+ * @brief Keeps released pixel buffers, bucketed by size, for reuse
+ *
+ * Operator chains free a buffer and allocate one of exactly the same size
+ * a step later; the pool hands the freed one back instead of going to the
+ * allocator and faulting in fresh pages. All methods are thread safe.
+ *
+ * Buffers are allocated with malloc, so any malloc'd buffer (e.g. from
+ * stbi_load) may be released to the pool.
+ */
+class BufferPool {
+ public:
+  /**
+   * @brief Create a pool that caches at most capacity bytes of free buffers
+   */
+  explicit BufferPool(size_t capacity);
+  ~BufferPool();
+
+  /**
+   * @brief Return a buffer of exactly bytes bytes
+   * @param zero Whether the buffer must be cleared; pass false when the
+   * caller overwrites every byte
+   */
+  unsigned char* acquire(size_t bytes, bool zero);
+
+  /**
+   * @brief Return a buffer of the given size to the pool (null is ignored)
+   */
+  void release(unsigned char* data, size_t bytes);
+
+  /**
+   * @brief Count a malloc'd buffer from elsewhere (e.g. stbi_load) as live,
+   * so it can later be released to the pool
+   */
+  void adopt(unsigned char* data, size_t bytes);
+
+  /** @brief Free all cached buffers
+   */
+  void trim();
+
+  /** @brief Set the most bytes of free buffers to keep, trimming if needed
+   */
+  void setCapacity(size_t capacity);
+
+  /** @brief Return the number of bytes held in free buffers
+   */
+  size_t cachedBytes() const;
+
+  /** @brief Return the current memory counters
+   */
+  MemoryStats stats() const;
+
+  /** @brief Restart peak tracking from the current live and cached bytes
+   */
+  void resetPeak();
+
+  /** @brief Write the memory counters to os in a human readable form
+   */
+  void report(std::ostream& os) const;
+
+  /**
+   * @brief Return the bytes of buffers acquired or adopted by the calling
+   * thread, from any pool, since it started
+   */
+  static size_t threadBytes();
+
+  /**
+   * @brief Return the pool used by Image
+   *
+   * If the AGL_MEMORY_STATS environment variable is set, its counters are
+   * reported to stderr when the program exits.
+   */
+  static BufferPool& shared();
+
+ private:
+  // free the cached buffers until at most limit bytes are held; the
+  // caller holds _mutex
+  void shrink(size_t limit);
+
+  // update the counters for a buffer handed out; the caller holds _mutex
+  void track(size_t bytes);
+
+  mutable std::mutex _mutex;
+  // free buffers by exact size in bytes
+  std::unordered_map<size_t, std::vector<unsigned char*>> _free;
+  size_t _cached;
+  size_t _capacity;
+  size_t _live;
+  size_t _peak;
+  size_t _peakResident;
+  size_t _allocations;
+  size_t _largest;
+};
+
+/**
+ * @brief Allocator that takes memory from BufferPool::shared(), so scratch
+ * containers such as the float copy of an image in a blur count in its
+ * stats and reuse its buffers
+ */
+template <class T>
+struct PoolAllocator {
+  typedef T value_type;
+
+  PoolAllocator() {}
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    return (T*) BufferPool::shared().acquire(n * sizeof(T), false);
+  }
+
+  void deallocate(T* data, size_t n) {
+    BufferPool::shared().release((unsigned char*) data, n * sizeof(T));
+  }
+};
+
+template <class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+// a vector of image-sized scratch data, held in the shared pool
+template <class T>
+using PoolVector = std::vector<T, PoolAllocator<T>>;
+}  // namespace agl
+#endif  // AGL_BUFFERPOOL_H_
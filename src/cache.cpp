@@ -0,0 +1,412 @@
+/**
+ * Implementation of the on-disk result cache
+ *
+ * @file cache.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include "pnm.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace agl {
+
+// bytes hashed per task; fixed, so keys do not depend on the thread count
+static const int HASH_CHUNK = 1 << 20;
+
+static const uint64_t PRIME = 0x9e3779b97f4a7c15ULL;
+
+// age after which a temporary is deleted even if its process id is in
+// use, since ids are reused
+static const long long STALE_SECONDS = 60 * 60;
+
+// finalizer of MurmurHash3, so every input bit affects every output bit
+static uint64_t mix(uint64_t h) {
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ULL;
+   h ^= h >> 33;
+   return h;
+}
+
+// hash n bytes as four interleaved streams of 64-bit words, so the
+// multiplies of one word do not wait on the last
+static uint64_t hashBytes(const unsigned char* data, size_t n, uint64_t seed) {
+   uint64_t lanes[4] = {seed, seed + PRIME, seed + 2 * PRIME, seed + 3 * PRIME};
+   size_t i = 0;
+   for (; i + 32 <= n; i += 32) {
+      for (int l = 0; l < 4; l++) {
+         uint64_t word;
+         memcpy(&word, data + i + l * 8, 8);
+         lanes[l] = (lanes[l] ^ word) * PRIME;
+         lanes[l] ^= lanes[l] >> 29;
+      }
+   }
+   uint64_t h = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3);
+   for (; i < n; i++) {
+      h = (h ^ data[i]) * PRIME;
+   }
+   return mix(h ^ n);
+}
+
+static std::string hex(uint64_t key) {
+   char text[17];
+   snprintf(text, sizeof(text), "%016llx", (unsigned long long) key);
+   return text;
+}
+
+// parse the 16 hex digits that start name
+static bool parseKey(const std::string& name, uint64_t& key) {
+   if (name.size() < 16) {
+      return false;
+   }
+   key = 0;
+   for (int i = 0; i < 16; i++) {
+      char c = name[i];
+      int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+      if (digit < 0) {
+         return false;
+      }
+      key = key << 4 | digit;
+   }
+   return true;
+}
+
+// parse a file name of the form <16 hex digits>.ppm
+static bool parseName(const std::string& name, uint64_t& key) {
+   return name.size() == 20 && name.compare(16, 4, ".ppm") == 0 && parseKey(name, key);
+}
+
+// parse the name of a temporary written by store, <16 hex digits>.<pid>-
+// <n>.ppm, possibly with the suffix of Image::save's own temporary
+static bool parseTemporary(const std::string& name, int& pid) {
+   uint64_t key;
+   if (!parseKey(name, key) || name.size() < 18 || name[16] != '.') {
+      return false;
+   }
+   size_t dash = name.find('-', 17);
+   if (dash == std::string::npos || dash == 17 || dash - 17 > 10) {
+      return false;
+   }
+   long long value = 0;
+   for (size_t i = 17; i < dash; i++) {
+      if (name[i] < '0' || name[i] > '9') {
+         return false;
+      }
+      value = value * 10 + (name[i] - '0');
+   }
+   pid = (int) value;
+   return value <= INT_MAX;
+}
+
+struct DirectoryFile {
+   std::string name;
+   size_t bytes;
+   // last modification, in seconds
+   long long time;
+};
+
+static bool makeDirectory(const std::string& directory) {
+#ifdef _WIN32
+   return _mkdir(directory.c_str()) == 0 || errno == EEXIST;
+#else
+   return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+static std::vector<DirectoryFile> listDirectory(const std::string& directory) {
+   std::vector<DirectoryFile> files;
+#ifdef _WIN32
+   WIN32_FIND_DATAA found;
+   HANDLE handle = FindFirstFileA((directory + "\\*").c_str(), &found);
+   if (handle == INVALID_HANDLE_VALUE) {
+      return files;
+   }
+   // seconds from 1601, where file times start, to 1970
+   const long long EPOCH_OFFSET = 11644473600LL;
+   do {
+      ULARGE_INTEGER time;
+      time.LowPart = found.ftLastWriteTime.dwLowDateTime;
+      time.HighPart = found.ftLastWriteTime.dwHighDateTime;
+      files.push_back(DirectoryFile{found.cFileName, ((size_t) found.nFileSizeHigh << 32) | found.nFileSizeLow,
+         (long long) (time.QuadPart / 10000000) - EPOCH_OFFSET});
+   } while (FindNextFileA(handle, &found));
+   FindClose(handle);
+#else
+   DIR* dir = opendir(directory.c_str());
+   if (!dir) {
+      return files;
+   }
+   while (dirent* entry = readdir(dir)) {
+      struct stat info;
+      std::string name = entry->d_name;
+      if (stat((directory + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+         files.push_back(DirectoryFile{name, (size_t) info.st_size, (long long) info.st_mtime});
+      }
+   }
+   closedir(dir);
+#endif
+   return files;
+}
+
+// mark a file used now, so the order of use survives a restart
+static void touch(const std::string& path) {
+#ifdef _WIN32
+   _utime(path.c_str(), NULL);
+#else
+   utime(path.c_str(), NULL);
+#endif
+}
+
+static int processId() {
+#ifdef _WIN32
+   return _getpid();
+#else
+   return (int) getpid();
+#endif
+}
+
+// whether a process with the given id is running on this machine
+static bool processAlive(int pid) {
+#ifdef _WIN32
+   HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD) pid);
+   if (!process) {
+      return false;
+   }
+   DWORD code = 0;
+   bool alive = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE;
+   CloseHandle(process);
+   return alive;
+#else
+   return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+ResultCache::ResultCache(const std::string& directory, size_t capacity) {
+   this->_directory = directory;
+   this->_capacity = capacity;
+   this->_bytes = 0;
+   this->_hits = 0;
+   this->_misses = 0;
+   this->_enabled = !directory.empty() && makeDirectory(directory);
+   if (!directory.empty() && !this->_enabled) {
+      std::cerr << "Cannot create cache directory " << directory << std::endl;
+   }
+   if (this->_enabled) {
+      this->scan();
+   }
+}
+
+ResultCache& ResultCache::shared() {
+   static ResultCache* cache = []() {
+      const char* directory = getenv("AGL_CACHE_DIR");
+      const char* megabytes = getenv("AGL_CACHE_MB");
+      size_t capacity = (size_t) (megabytes ? std::max(atoi(megabytes), 0) : 1024) << 20;
+      return new ResultCache(directory ? directory : "", capacity);
+   }();
+   return *cache;
+}
+
+bool ResultCache::enabled() const {
+   return this->_enabled;
+}
+
+uint64_t ResultCache::hash(const Image& image) {
+   if (image.layout() == Layout::Planar) {
+      return hash(image.toLayout(Layout::Interleaved));
+   }
+   size_t numBytes = (size_t) image.width() * image.height() * 3;
+   int numChunks = (int) ((numBytes + HASH_CHUNK - 1) / HASH_CHUNK);
+   std::vector<uint64_t> chunks(numChunks);
+   parallelFor(0, numChunks, 1, [&](int first, int last) {
+      for (int c = first; c < last; c++) {
+         size_t begin = (size_t) c * HASH_CHUNK;
+         size_t n = std::min((size_t) HASH_CHUNK, numBytes - begin);
+         chunks[c] = hashBytes(image.data() + begin, n, c);
+      }
+   });
+   uint64_t h = mix(((uint64_t) image.width() << 32) | (uint32_t) image.height());
+   for (uint64_t chunk : chunks) {
+      h = mix(h ^ chunk) * PRIME;
+   }
+   return mix(h);
+}
+
+uint64_t ResultCache::hash(uint64_t key, const std::string& step) {
+   return hashBytes((const unsigned char*) step.data(), step.size(), mix(key));
+}
+
+std::string ResultCache::path(uint64_t key) const {
+   return this->_directory + "/" + hex(key) + ".ppm";
+}
+
+void ResultCache::scan() {
+   std::vector<std::pair<long long, Entry>> found;
+   long long now = (long long) time(NULL);
+   for (const DirectoryFile& file : listDirectory(this->_directory)) {
+      uint64_t key;
+      int pid;
+      if (parseName(file.name, key)) {
+         found.push_back(std::make_pair(file.time, Entry{key, file.bytes}));
+      } else if (parseTemporary(file.name, pid) &&
+         (!processAlive(pid) || now - file.time > STALE_SECONDS)) {
+         // left by a process that died mid-store; nothing else would
+         // ever remove it
+         std::remove((this->_directory + "/" + file.name).c_str());
+      }
+   }
+   std::sort(found.begin(), found.end(), [](const std::pair<long long, Entry>& a,
+      const std::pair<long long, Entry>& b) { return a.first > b.first; });
+   for (const auto& f : found) {
+      this->_entries.push_back(f.second);
+      this->_index[f.second.key] = std::prev(this->_entries.end());
+      this->_bytes += f.second.bytes;
+   }
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->evict(0);
+}
+
+bool ResultCache::load(uint64_t key, Image& image) {
+   if (!this->_enabled) {
+      return false;
+   }
+   trace::Scope scope("cacheLoad");
+   {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      auto found = this->_index.find(key);
+      if (found == this->_index.end()) {
+         this->_misses++;
+         return false;
+      }
+      this->_entries.splice(this->_entries.begin(), this->_entries, found->second);
+   }
+   std::string file = this->path(key);
+   Image loaded;
+   // the entry may have been evicted, here or by another process, since
+   if (!loaded.load(file)) {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      auto found = this->_index.find(key);
+      if (found != this->_index.end()) {
+         this->_bytes -= found->second->bytes;
+         this->_entries.erase(found->second);
+         this->_index.erase(found);
+      }
+      this->_misses++;
+      return false;
+   }
+   touch(file);
+   scope.setSize(loaded.width(), loaded.height());
+   image = std::move(loaded);
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   this->_hits++;
+   return true;
+}
+
+bool ResultCache::store(uint64_t key, const Image& image) {
+   static std::atomic<int> numTemporaries(0);
+   if (!this->_enabled) {
+      return false;
+   }
+   trace::Scope scope("cacheStore", image.width(), image.height());
+   // header plus pixels, as Image::save writes them
+   size_t bytes = pnm::header(image.width(), image.height(), false).size() +
+      (size_t) image.width() * image.height() * 3;
+   if (bytes > this->_capacity) {
+      return false;
+   }
+   std::string file = this->path(key);
+   std::string temporary = this->_directory + "/" + hex(key) + "." + std::to_string(processId()) +
+      "-" + std::to_string(numTemporaries++) + ".ppm";
+   if (!image.save(temporary)) {
+      std::remove(temporary.c_str());
+      return false;
+   }
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   auto found = this->_index.find(key);
+   if (found != this->_index.end()) {
+      this->_bytes -= found->second->bytes;
+      this->_entries.erase(found->second);
+      this->_index.erase(found);
+   }
+   this->evict(bytes);
+   std::remove(file.c_str());
+   if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return false;
+   }
+   this->_entries.push_front(Entry{key, bytes});
+   this->_index[key] = this->_entries.begin();
+   this->_bytes += bytes;
+   return true;
+}
+
+void ResultCache::evict(size_t bytes) {
+   while (!this->_entries.empty() && this->_bytes + bytes > this->_capacity) {
+      const Entry& oldest = this->_entries.back();
+      std::remove(this->path(oldest.key).c_str());
+      this->_bytes -= oldest.bytes;
+      this->_index.erase(oldest.key);
+      this->_entries.pop_back();
+   }
+}
+
+void ResultCache::clear() {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   for (const Entry& entry : this->_entries) {
+      std::remove(this->path(entry.key).c_str());
+   }
+   this->_entries.clear();
+   this->_index.clear();
+   this->_bytes = 0;
+}
+
+size_t ResultCache::bytes() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   return this->_bytes;
+}
+
+int ResultCache::size() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   return (int) this->_entries.size();
+}
+
+int ResultCache::hits() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   return this->_hits;
+}
+
+int ResultCache::misses() const {
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   return this->_misses;
+}
+
+}  // namespace agl
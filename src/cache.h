@@ -0,0 +1,129 @@
+/**
+ * On-disk cache of operator results, addressed by the content of the
+ * input and the operators applied to it
+ *
+ * @file cache.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_CACHE_H_
+#define AGL_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "image.h"
+
+namespace agl {
+
+/**
+ * @brief Stores images in a directory under 64-bit keys, evicting the
+ * least recently used when over capacity
+ *
+ * A key names an image by how it was made: hash(image) for a source, then
+ * hash(key, step) for each operator applied, where step names the
+ * operator and its parameters. Equal keys therefore mean equal results,
+ * and a changed step changes the keys of every step after it.
+ *
+ * Entries are raw PPM files, so a hit is mapped rather than decoded. They
+ * are written under a temporary name and renamed, so readers never see a
+ * partial file, and file times record use, so the order survives
+ * restarts. One cache may be used from several threads; several
+ * processes may share a directory, at worst evicting each other's
+ * entries early.
+ */
+class ResultCache {
+ public:
+  /**
+   * @brief Open the cache in directory, created if needed, holding at
+   * most capacity bytes
+   */
+  ResultCache(const std::string& directory, size_t capacity);
+
+  /**
+   * @brief Return the cache in the directory named by AGL_CACHE_DIR,
+   * capped at AGL_CACHE_MB megabytes (1024 by default)
+   *
+   * Without AGL_CACHE_DIR it is disabled: every lookup misses and nothing
+   * is stored.
+   */
+  static ResultCache& shared();
+
+  // whether the cache has a usable directory
+  bool enabled() const;
+
+  /**
+   * @brief Return the key of a source image, from its size and pixels;
+   * the layout does not change the key
+   */
+  static uint64_t hash(const Image& image);
+
+  /**
+   * @brief Return the key of the result of applying step to the image
+   * with the given key
+   */
+  static uint64_t hash(uint64_t key, const std::string& step);
+
+  /**
+   * @brief Load the image stored under key, and mark it used
+   *
+   * Returns false, leaving image unchanged, if there is none.
+   */
+  bool load(uint64_t key, Image& image);
+
+  /**
+   * @brief Store image under key, evicting the least recently used
+   * entries to stay within capacity
+   *
+   * An image larger than the whole capacity is not stored.
+   */
+  bool store(uint64_t key, const Image& image);
+
+  // remove every entry
+  void clear();
+
+  // return the bytes stored, the number of entries, and the lookups so
+  // far that hit and missed
+  size_t bytes() const;
+  int size() const;
+  int hits() const;
+  int misses() const;
+
+ private:
+  ResultCache(const ResultCache&) = delete;
+  ResultCache& operator=(const ResultCache&) = delete;
+
+  struct Entry {
+    uint64_t key;
+    size_t bytes;
+  };
+
+  // return the file of the entry with the given key
+  std::string path(uint64_t key) const;
+
+  // read the entries already in the directory, oldest first, and delete
+  // the temporaries of stores that never finished
+  void scan();
+
+  // remove least recently used entries until bytes fit; the lock is held
+  void evict(size_t bytes);
+
+  std::string _directory;
+  size_t _capacity;
+  bool _enabled;
+  mutable std::mutex _mutex;
+  // most recently used first
+  std::list<Entry> _entries;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+  size_t _bytes;
+  int _hits;
+  int _misses;
+};
+
+}  // namespace agl
+#endif  // AGL_CACHE_H_
@@ -0,0 +1,257 @@
+/**
+ * Border policies, and convolution with kernels given at run time
+ *
+ * @file convolve.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "convolve.h"
+
+#include <cstdlib>
+
+#include "bufferpool.h"
+#include "fft.h"
+
+namespace agl {
+namespace convolution {
+
+int borderIndex(int idx, int size, Border border) {
+   switch (border) {
+      case Border::Clamp:
+         return std::min(std::max(idx, 0), size - 1);
+      case Border::Mirror: {
+         // reflections repeat every 2 * (size - 1) indices
+         if (size == 1) {
+            return 0;
+         }
+         int period = 2 * (size - 1);
+         idx = std::abs(idx) % period;
+         return idx < size ? idx : period - idx;
+      }
+      case Border::Wrap:
+         return (idx % size + size) % size;
+      case Border::Constant:
+      default:
+         return -1;
+   }
+}
+
+const char* borderName(Border border) {
+   switch (border) {
+      case Border::Clamp:
+         return "clamp";
+      case Border::Mirror:
+         return "mirror";
+      case Border::Wrap:
+         return "wrap";
+      case Border::Constant:
+      default:
+         return "constant";
+   }
+}
+
+// smallest and largest side of a transformed tile
+static const int MIN_TILE = 16;
+static const int MAX_TILE = 1024;
+
+// time to transform an n by n tile forward and back, per n^2 log2(n),
+// in units of one direct tap; measured on 1920x1080 with 5x5 to 97x97
+// kernels
+static const double TILE_COST = 4.0;
+
+static inline unsigned char toByte(float value) {
+   return (unsigned char) std::min(std::max(value + 0.5f, 0.0f), 255.0f);
+}
+
+// for each index from -before to size + after - 1, where it reads from in
+// [0, size) under border, or -1 for the constant
+static std::vector<int> borderMap(int size, int before, int after, Border border) {
+   std::vector<int> map(size + before + after);
+   for (int i = 0; i < (int) map.size(); i++) {
+      int idx = i - before;
+      map[i] = 0 <= idx && idx < size ? idx : borderIndex(idx, size, border);
+   }
+   return map;
+}
+
+void direct(const unsigned char* src, unsigned char* dst, int width, int height, int step,
+   const float* kernel, int kernelWidth, int kernelHeight, Border border, unsigned char constant) {
+   int rx = kernelWidth / 2;
+   int ry = kernelHeight / 2;
+   std::vector<int> cols = borderMap(width, rx, kernelWidth - 1 - rx, border);
+   std::vector<int> rows = borderMap(height, ry, kernelHeight - 1 - ry, border);
+   int paddedWidth = width + kernelWidth - 1;
+   parallelRows(height, width, [&](int first, int last) {
+      // the rows the band reads, with the border filled in, so the sums
+      // below run without checks
+      int numRows = last - first + kernelHeight - 1;
+      PoolVector<float> padded((size_t) numRows * paddedWidth);
+      for (int r = 0; r < numRows; r++) {
+         int y = rows[first + r];
+         float* out = &padded[(size_t) r * paddedWidth];
+         const unsigned char* in = src + (size_t) std::max(y, 0) * width * step;
+         for (int x = 0; x < paddedWidth; x++) {
+            out[x] = y < 0 || cols[x] < 0 ? constant : in[cols[x] * step];
+         }
+      }
+      std::vector<float> sum(width);
+      for (int i = first; i < last; i++) {
+         std::fill(sum.begin(), sum.end(), 0.0f);
+         for (int k = 0; k < kernelHeight; k++) {
+            for (int l = 0; l < kernelWidth; l++) {
+               float weight = kernel[k * kernelWidth + l];
+               if (weight == 0.0f) {
+                  continue;
+               }
+               const float* in = &padded[(size_t) (i - first + k) * paddedWidth + l];
+               for (int j = 0; j < width; j++) {
+                  sum[j] += weight * in[j];
+               }
+            }
+         }
+         unsigned char* out = dst + (size_t) i * width * step;
+         for (int j = 0; j < width; j++) {
+            out[j * step] = toByte(sum[j]);
+         }
+      }
+   });
+}
+
+// the tiles of side block that cover the padded image, which is one
+// kernel less one larger than the image
+static long long numTiles(int width, int height, int kernelWidth, int kernelHeight, int block) {
+   long long across = (width + kernelWidth - 1 + block - 1) / block;
+   long long down = (height + kernelHeight - 1 + block - 1) / block;
+   return across * down;
+}
+
+// the tile side of least total work, or 0 if none fits the kernel
+static int tileSize(int width, int height, int kernelWidth, int kernelHeight, double* cost) {
+   int kernelSize = std::max(kernelWidth, kernelHeight);
+   int best = 0;
+   double bestCost = 0;
+   for (int n = MIN_TILE; n <= MAX_TILE; n *= 2) {
+      // overlap-add needs room for the kernel, and blocks at least as
+      // large as it so that only neighboring blocks overlap
+      int block = n - kernelSize + 1;
+      if (block < kernelSize) {
+         continue;
+      }
+      double total = TILE_COST * numTiles(width, height, kernelWidth, kernelHeight, block) *
+         n * n * log2((double) n);
+      if (!best || total < bestCost) {
+         best = n;
+         bestCost = total;
+      }
+   }
+   *cost = bestCost;
+   return best;
+}
+
+bool preferSpectral(int width, int height, int kernelWidth, int kernelHeight, int taps) {
+   double cost;
+   if (!tileSize(width, height, kernelWidth, kernelHeight, &cost)) {
+      return false;
+   }
+   return cost < (double) width * height * taps;
+}
+
+void spectral(const unsigned char* src, unsigned char* dst, int width, int height, int step,
+   const float* kernel, int kernelWidth, int kernelHeight, Border border, unsigned char constant) {
+   double cost;
+   int n = tileSize(width, height, kernelWidth, kernelHeight, &cost);
+   if (!n) {
+      direct(src, dst, width, height, step, kernel, kernelWidth, kernelHeight, border, constant);
+      return;
+   }
+   int block = n - std::max(kernelWidth, kernelHeight) + 1;
+   int rx = kernelWidth / 2;
+   int ry = kernelHeight / 2;
+   std::vector<int> cols = borderMap(width, rx, kernelWidth - 1 - rx, border);
+   std::vector<int> rows = borderMap(height, ry, kernelHeight - 1 - ry, border);
+   int paddedWidth = (int) cols.size();
+   int paddedHeight = (int) rows.size();
+   fft::RealPlan2D plan(n);
+   int m = plan.spectrumWidth();
+
+   // the kernel flipped, so the product of transforms correlates, and
+   // scaled by the 2 / n^2 the inverse leaves over
+   PoolVector<fft::Complex> kernelSpectrum((size_t) n * m);
+   {
+      PoolVector<float> tile((size_t) n * n, 0.0f);
+      std::vector<fft::Complex> scratch(n);
+      float scale = 2.0f / ((float) n * n);
+      for (int k = 0; k < kernelHeight; k++) {
+         for (int l = 0; l < kernelWidth; l++) {
+            tile[(size_t) (kernelHeight - 1 - k) * n + kernelWidth - 1 - l] = kernel[k * kernelWidth + l] * scale;
+         }
+      }
+      plan.forward(tile.data(), kernelSpectrum.data(), scratch.data());
+   }
+
+   // overlap-add: each block of the padded image, convolved with the
+   // kernel, adds to the output up to a kernel beyond its own rows and
+   // columns. Blocks are at least as tall as the kernel, so a row of
+   // blocks only overlaps the next one: even rows run in parallel, then
+   // odd ones.
+   PoolVector<float> sum((size_t) width * height, 0.0f);
+   int blocksDown = (paddedHeight + block - 1) / block;
+   for (int parity = 0; parity < 2; parity++) {
+      parallelFor(0, (blocksDown - parity + 1) / 2, 1, [&](int firstPair, int lastPair) {
+         PoolVector<float> tile((size_t) n * n);
+         PoolVector<fft::Complex> spectrum((size_t) n * m);
+         std::vector<fft::Complex> scratch(n);
+         for (int pair = firstPair; pair < lastPair; pair++) {
+            int top = (2 * pair + parity) * block;
+            int blockHeight = std::min(block, paddedHeight - top);
+            for (int left = 0; left < paddedWidth; left += block) {
+               int blockWidth = std::min(block, paddedWidth - left);
+               std::fill(tile.begin(), tile.end(), 0.0f);
+               for (int y = 0; y < blockHeight; y++) {
+                  int row = rows[top + y];
+                  const unsigned char* in = src + (size_t) std::max(row, 0) * width * step;
+                  float* out = &tile[(size_t) y * n];
+                  for (int x = 0; x < blockWidth; x++) {
+                     int col = cols[left + x];
+                     out[x] = row < 0 || col < 0 ? constant : in[col * step];
+                  }
+               }
+               plan.forward(tile.data(), spectrum.data(), scratch.data());
+               for (size_t idx = 0; idx < spectrum.size(); idx++) {
+                  const fft::Complex& a = spectrum[idx];
+                  const fft::Complex& b = kernelSpectrum[idx];
+                  spectrum[idx] = fft::Complex(a.real() * b.real() - a.imag() * b.imag(),
+                     a.real() * b.imag() + a.imag() * b.real());
+               }
+               plan.inverse(spectrum.data(), tile.data(), scratch.data());
+               // the full convolution at padded (y, x) is the output pixel
+               // one kernel less one up and to the left
+               int firstY = std::max(kernelHeight - 1 - top, 0);
+               int lastY = std::min(blockHeight + kernelHeight - 1, height + kernelHeight - 1 - top);
+               int firstX = std::max(kernelWidth - 1 - left, 0);
+               int lastX = std::min(blockWidth + kernelWidth - 1, width + kernelWidth - 1 - left);
+               for (int y = firstY; y < lastY; y++) {
+                  const float* in = &tile[(size_t) y * n];
+                  float* out = &sum[(size_t) (top + y - kernelHeight + 1) * width];
+                  for (int x = firstX; x < lastX; x++) {
+                     out[left + x - kernelWidth + 1] += in[x];
+                  }
+               }
+            }
+         }
+      });
+   }
+   parallelRows(height, width, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+         const float* in = &sum[(size_t) i * width];
+         unsigned char* out = dst + (size_t) i * width * step;
+         for (int j = 0; j < width; j++) {
+            out[j * step] = toByte(in[j]);
+         }
+      }
+   });
+}
+
+}  // namespace convolution
+}  // namespace agl
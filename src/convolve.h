@@ -0,0 +1,295 @@
+/**
+ * Convolution with small kernels fixed at compile time
+ *
+ * A kernel's size and integer coefficients are template arguments, so the
+ * sum for each pixel is unrolled and zero coefficients drop out. Pixels
+ * whose whole neighborhood lies in the image take a path without bounds
+ * checks; the rest read through a Border policy.
+ *
+ * Kernels known only at run time, such as a bokeh disk, go through direct,
+ * which sums every nonzero tap, or spectral, which multiplies FFTs of
+ * tiles and adds up the overlapping results; Image::convolve picks
+ * whichever is estimated faster.
+ *
+ * @verbatim
+ * Image soft = convolve<kernels::Gaussian5>(image, Border::Mirror);
+ * Image edges = convolveMagnitude<kernels::SobelX, kernels::SobelY>(image,
+ *    Border::Constant, 0);  // same as image.sobel()
+ * @endverbatim
+ *
+ * @file convolve.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_CONVOLVE_H_
+#define AGL_CONVOLVE_H_
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "image.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace agl {
+
+/**
+ * @brief A WIDTH by HEIGHT kernel, both odd, of integer COEFFICIENTS row
+ * by row, centered on the pixel; sums are divided by DIVISOR
+ */
+template <int WIDTH_, int HEIGHT_, int DIVISOR_, int... COEFFICIENTS>
+struct Kernel {
+  static_assert(WIDTH_ % 2 == 1 && HEIGHT_ % 2 == 1, "kernel sides must be odd");
+  static_assert(sizeof...(COEFFICIENTS) == WIDTH_ * HEIGHT_, "need WIDTH * HEIGHT coefficients");
+  static_assert(DIVISOR_ > 0, "divisor must be positive");
+
+  static const int WIDTH = WIDTH_;
+  static const int HEIGHT = HEIGHT_;
+  static const int DIVISOR = DIVISOR_;
+
+  // coefficient idx, row by row
+  static constexpr int at(int idx) {
+    const int values[] = {COEFFICIENTS...};
+    return values[idx];
+  }
+};
+
+namespace kernels {
+
+// 3x3 mean
+typedef Kernel<3, 3, 9,
+  1, 1, 1,
+  1, 1, 1,
+  1, 1, 1> Box3;
+
+// Sobel responses as stencil::sobel takes them: left minus right, and top
+// minus bottom
+typedef Kernel<3, 3, 1,
+  1, 0, -1,
+  2, 0, -2,
+  1, 0, -1> SobelX;
+typedef Kernel<3, 3, 1,
+  1, 2, 1,
+  0, 0, 0,
+  -1, -2, -1> SobelY;
+
+// binomial approximation of a Gaussian with sigma 1
+typedef Kernel<5, 5, 256,
+  1, 4, 6, 4, 1,
+  4, 16, 24, 16, 4,
+  6, 24, 36, 24, 6,
+  4, 16, 24, 16, 4,
+  1, 4, 6, 4, 1> Gaussian5;
+
+// the center minus its four neighbors, added back to the center
+typedef Kernel<3, 3, 1,
+  0, -1, 0,
+  -1, 5, -1,
+  0, -1, 0> Sharpen3;
+
+// relief lit from the top left
+typedef Kernel<3, 3, 1,
+  -2, -1, 0,
+  -1, 1, 1,
+  0, 1, 2> Emboss3;
+
+}  // namespace kernels
+
+namespace convolution {
+
+/**
+ * @brief Where index idx, outside [0, size), reads from under border, or
+ * -1 for Border::Constant
+ */
+int borderIndex(int idx, int size, Border border);
+
+// the name of border in traces
+const char* borderName(Border border);
+
+/**
+ * @brief Correlate one channel with a kernel given at run time
+ *
+ * src and dst hold width by height pixels step bytes apart; kernel holds
+ * kernelWidth * kernelHeight weights row by row, and its center, (
+ * kernelWidth / 2, kernelHeight / 2), sits on each pixel in turn. Sums
+ * are rounded and clamped to 0..255. direct sums every tap; spectral
+ * multiplies transforms of tiles, and may differ from direct by 1.
+ */
+void direct(const unsigned char* src, unsigned char* dst, int width, int height, int step,
+   const float* kernel, int kernelWidth, int kernelHeight, Border border, unsigned char constant);
+void spectral(const unsigned char* src, unsigned char* dst, int width, int height, int step,
+   const float* kernel, int kernelWidth, int kernelHeight, Border border, unsigned char constant);
+
+// whether spectral is expected to be faster than direct for this image
+// and kernel size, with taps of the weights nonzero
+bool preferSpectral(int width, int height, int kernelWidth, int kernelHeight, int taps);
+
+// K's coefficients times the bytes around byte x of rows, the rows of the
+// neighborhood top to bottom, with neighboring columns STEP bytes apart.
+// Each coefficient is a compile-time constant, so the sum is unrolled.
+template <class K, int STEP, size_t... IDX>
+inline int dot(const unsigned char* const* rows, int x, std::index_sequence<IDX...>) {
+   int sum = 0;
+   int expand[] = {0, (sum += std::integral_constant<int, K::at(IDX)>::value *
+      rows[IDX / K::WIDTH][x + ((int) (IDX % K::WIDTH) - K::WIDTH / 2) * STEP], 0)...};
+   (void) expand;
+   return sum;
+}
+
+template <class K, int STEP>
+inline int dot(const unsigned char* const* rows, int x) {
+   return dot<K, STEP>(rows, x, std::make_index_sequence<K::WIDTH * K::HEIGHT>());
+}
+
+/**
+ * @brief One kernel: the sum over DIVISOR, rounded and clamped to 0..255
+ */
+template <class K>
+struct Filter {
+  static const int WIDTH = K::WIDTH;
+  static const int HEIGHT = K::HEIGHT;
+
+  template <int STEP>
+  static unsigned char apply(const unsigned char* const* rows, int x) {
+    int sum = dot<K, STEP>(rows, x);
+    if (K::DIVISOR > 1) {
+      sum = (sum + K::DIVISOR / 2) / K::DIVISOR;
+    }
+    return (unsigned char) std::min(std::max(sum, 0), 255);
+  }
+};
+
+/**
+ * @brief Two kernels of one size, such as SobelX and SobelY: floor(sqrt(
+ * x^2 + y^2)) of their sums over DIVISOR, clamped to 255
+ */
+template <class KX, class KY>
+struct Magnitude {
+  static_assert(KX::WIDTH == KY::WIDTH && KX::HEIGHT == KY::HEIGHT, "kernels must have one size");
+  static const int WIDTH = KX::WIDTH;
+  static const int HEIGHT = KX::HEIGHT;
+
+  template <int STEP>
+  static unsigned char apply(const unsigned char* const* rows, int x) {
+    int gx = dot<KX, STEP>(rows, x) / KX::DIVISOR;
+    int gy = dot<KY, STEP>(rows, x) / KY::DIVISOR;
+    int squared = gx * gx + gy * gy;
+    return squared >= 255 * 255 ? 255 : (unsigned char) sqrtf((float) squared);
+  }
+};
+
+/**
+ * @brief Run Op over rows [first, last) of src, width by height pixels of
+ * CHANNELS interleaved channels, into dst, which receives row first
+ * onwards. Op has WIDTH, HEIGHT and apply<STEP>(rows, x), as Filter.
+ */
+template <class Op, int CHANNELS>
+void band(const unsigned char* src, unsigned char* dst, int width, int height,
+   int first, int last, Border border, unsigned char constant) {
+   const int rx = Op::WIDTH / 2;
+   const int ry = Op::HEIGHT / 2;
+   int rowSize = width * CHANNELS;
+   // the row outside the image under Border::Constant
+   std::vector<unsigned char> constantRow(border == Border::Constant ? rowSize : 0, constant);
+   // the neighborhood of one edge pixel and channel, gathered through the
+   // border policy so it runs through the same Op
+   unsigned char patch[Op::HEIGHT][Op::WIDTH];
+   const unsigned char* patchRows[Op::HEIGHT];
+   for (int k = 0; k < Op::HEIGHT; k++) {
+      patchRows[k] = patch[k];
+   }
+   for (int i = first; i < last; i++) {
+      const unsigned char* rows[Op::HEIGHT];
+      for (int k = 0; k < Op::HEIGHT; k++) {
+         int row = i + k - ry;
+         if (row < 0 || row >= height) {
+            row = borderIndex(row, height, border);
+         }
+         rows[k] = row < 0 ? constantRow.data() : src + (size_t) row * rowSize;
+      }
+      unsigned char* out = dst + (size_t) (i - first) * rowSize;
+      // interior columns: every neighbor is in rows, no checks
+      for (int x = rx * CHANNELS; x < (width - rx) * CHANNELS; x++) {
+         out[x] = Op::template apply<CHANNELS>(rows, x);
+      }
+      // edge columns, the first and last rx, or all of them when the image
+      // is narrower than the kernel
+      auto edge = [&](int j) {
+         for (int c = 0; c < CHANNELS; c++) {
+            for (int l = 0; l < Op::WIDTH; l++) {
+               int col = j + l - rx;
+               if (col < 0 || col >= width) {
+                  col = borderIndex(col, width, border);
+               }
+               for (int k = 0; k < Op::HEIGHT; k++) {
+                  patch[k][l] = col < 0 ? constant : rows[k][col * CHANNELS + c];
+               }
+            }
+            out[j * CHANNELS + c] = Op::template apply<1>(patchRows, rx);
+         }
+      };
+      for (int j = 0; j < std::min(rx, width); j++) {
+         edge(j);
+      }
+      for (int j = std::max(width - rx, rx); j < width; j++) {
+         edge(j);
+      }
+   }
+}
+
+/**
+ * @brief Run Op over every pixel of image, in its layout
+ */
+template <class Op>
+Image filter(const Image& image, Border border, unsigned char constant) {
+   int width = image.width();
+   int height = image.height();
+   trace::Scope scope("convolve", width, height);
+   scope.arg("kernel", std::to_string(Op::WIDTH) + "x" + std::to_string(Op::HEIGHT))
+      .arg("border", borderName(border));
+   Image result(width, height, image.layout(), false);
+   size_t planeSize = (size_t) width * height;
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      if (image.layout() == Layout::Planar) {
+         for (int c = 0; c < 3; c++) {
+            band<Op, 1>(image.data() + c * planeSize, result.data() + c * planeSize + (size_t) firstRow * width,
+               width, height, firstRow, lastRow, border, constant);
+         }
+         return;
+      }
+      band<Op, 3>(image.data(), result.data() + (size_t) firstRow * width * 3,
+         width, height, firstRow, lastRow, border, constant);
+   });
+   return result;
+}
+
+}  // namespace convolution
+
+/**
+ * @brief Convolve each channel of image with kernel K
+ * @param border What pixels outside the image read
+ * @param constant The channel value outside the image for Border::Constant
+ */
+template <class K>
+Image convolve(const Image& image, Border border = Border::Clamp, unsigned char constant = 0) {
+   return convolution::filter<convolution::Filter<K>>(image, border, constant);
+}
+
+/**
+ * @brief Gradient magnitude of each channel of image from kernels KX and KY
+ * @param border What pixels outside the image read
+ * @param constant The channel value outside the image for Border::Constant
+ */
+template <class KX, class KY>
+Image convolveMagnitude(const Image& image, Border border = Border::Clamp, unsigned char constant = 0) {
+   return convolution::filter<convolution::Magnitude<KX, KY>>(image, border, constant);
+}
+
+}  // namespace agl
+#endif  // AGL_CONVOLVE_H_
@@ -0,0 +1,636 @@
+/**
+ * Implementation of the deflate compressor: LZ77 matching over hash
+ * chains, then dynamic Huffman blocks (or stored blocks when the data does
+ * not compress)
+ *
+ * @file deflate.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "deflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace agl {
+namespace deflate {
+
+static const int WINDOW_SIZE = 32768;
+static const int WINDOW_MASK = WINDOW_SIZE - 1;
+static const int HASH_BITS = 15;
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const int MAX_STORED = 65535;
+
+// symbols collected before a block is written
+static const size_t BLOCK_SYMBOLS = 32768;
+
+static const int NUM_LITLEN = 286;
+static const int NUM_DIST = 30;
+static const int NUM_CODELEN = 19;
+
+static const int LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23,
+   27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+   2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97,
+   129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+   16385, 24577};
+static const int DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5,
+   6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const int CODELEN_ORDER[NUM_CODELEN] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+   11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// search effort per compression level (zlib's configuration table)
+struct LevelParams {
+  // search a quarter of the chain once a match is this long
+  int goodLength;
+  // lazy levels: look ahead only when the match is shorter than this;
+  // greedy levels: index the positions inside matches up to this long
+  int maxLazy;
+  // stop searching once a match is this long
+  int niceLength;
+  // hash chain entries tried per position
+  int maxChain;
+  // check whether the next position has a longer match before taking one
+  bool lazy;
+};
+static const LevelParams LEVELS[10] = {
+   {0, 0, 0, 0, false}, {4, 4, 8, 4, false}, {4, 5, 16, 8, false},
+   {4, 6, 32, 32, false}, {4, 4, 16, 16, true}, {8, 16, 32, 32, true},
+   {8, 16, 128, 128, true}, {8, 32, 128, 256, true}, {32, 128, 258, 1024, true},
+   {32, 258, 258, 4096, true}};
+
+// lookup tables from match lengths and distances to their codes
+struct CodeTables {
+  unsigned char lengthCode[MAX_MATCH + 1];
+  // code of distance d: near[d - 1] for d <= 256, else far[(d - 1) >> 7]
+  unsigned char near[256];
+  unsigned char far[256];
+  unsigned int crc[256];
+
+  CodeTables() {
+     for (int code = 0; code < 29; code++) {
+        int top = code < 28 ? LENGTH_BASE[code + 1] : MAX_MATCH + 1;
+        for (int len = LENGTH_BASE[code]; len < top && len <= MAX_MATCH; len++) {
+           this->lengthCode[len] = code;
+        }
+     }
+     this->lengthCode[MAX_MATCH] = 28;
+     for (int code = 0; code < NUM_DIST; code++) {
+        int top = code < NUM_DIST - 1 ? DIST_BASE[code + 1] : WINDOW_SIZE + 1;
+        for (int d = DIST_BASE[code]; d < top; d++) {
+           if (d <= 256) {
+              this->near[d - 1] = code;
+           } else {
+              this->far[(d - 1) >> 7] = code;
+           }
+        }
+     }
+     for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++) {
+           c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        this->crc[n] = c;
+     }
+  }
+
+  int distCode(int d) const {
+     return d <= 256 ? this->near[d - 1] : this->far[(d - 1) >> 7];
+  }
+};
+
+static const CodeTables& tables() {
+   static const CodeTables codes;
+   return codes;
+}
+
+// a literal byte (dist 0) or a match of length litLen at distance dist
+struct Symbol {
+  unsigned short litLen;
+  unsigned short dist;
+};
+
+// packs bits least significant first, as deflate requires
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<unsigned char>& out) : _out(out) {
+     this->_bits = 0;
+     this->_count = 0;
+  }
+
+  // append the low n bits of value
+  void put(unsigned int value, int n) {
+     this->_bits |= (unsigned long long) value << this->_count;
+     this->_count += n;
+     while (this->_count >= 8) {
+        this->_out.push_back((unsigned char) this->_bits);
+        this->_bits >>= 8;
+        this->_count -= 8;
+     }
+  }
+
+  // pad with zero bits to the next byte boundary
+  void align() {
+     if (this->_count > 0) {
+        this->_out.push_back((unsigned char) this->_bits);
+     }
+     this->_bits = 0;
+     this->_count = 0;
+  }
+
+  std::vector<unsigned char>& bytes() {
+     return this->_out;
+  }
+
+ private:
+  std::vector<unsigned char>& _out;
+  unsigned long long _bits;
+  int _count;
+};
+
+// set lengths to Huffman code lengths of at most maxBits for the n
+// symbols with the given frequencies; unused symbols get length 0
+static void buildLengths(const unsigned int* freq, int n, int maxBits, unsigned char* lengths) {
+   std::vector<int> symbols;
+   for (int i = 0; i < n; i++) {
+      lengths[i] = 0;
+      if (freq[i] > 0) {
+         symbols.push_back(i);
+      }
+   }
+   int numSymbols = (int) symbols.size();
+   if (numSymbols == 0) {
+      return;
+   }
+   if (numSymbols == 1) {
+      lengths[symbols[0]] = 1;
+      return;
+   }
+   std::stable_sort(symbols.begin(), symbols.end(), [freq](int a, int b) {
+      return freq[a] < freq[b];
+   });
+   // two-queue Huffman construction: leaves in frequency order, and
+   // internal nodes, which are created in frequency order too
+   std::vector<unsigned long long> weight(2 * numSymbols - 1);
+   std::vector<int> parent(2 * numSymbols - 1, -1);
+   for (int i = 0; i < numSymbols; i++) {
+      weight[i] = freq[symbols[i]];
+   }
+   int leaf = 0;
+   int internal = numSymbols;
+   for (int node = numSymbols; node < 2 * numSymbols - 1; node++) {
+      int pick[2];
+      for (int k = 0; k < 2; k++) {
+         if (leaf < numSymbols && (internal == node || weight[leaf] <= weight[internal])) {
+            pick[k] = leaf++;
+         } else {
+            pick[k] = internal++;
+         }
+      }
+      weight[node] = weight[pick[0]] + weight[pick[1]];
+      parent[pick[0]] = parent[pick[1]] = node;
+   }
+   // depths from the root down; parents always come after their children
+   std::vector<int> depth(2 * numSymbols - 1, 0);
+   std::vector<int> counts(maxBits + 1, 0);
+   for (int node = 2 * numSymbols - 3; node >= 0; node--) {
+      depth[node] = depth[parent[node]] + 1;
+      if (node < numSymbols) {
+         counts[std::min(depth[node], maxBits)]++;
+      }
+   }
+   // codes longer than maxBits were clamped; lengthen shorter codes until
+   // the lengths form a valid prefix code again
+   unsigned long long total = 0;
+   for (int len = 1; len <= maxBits; len++) {
+      total += (unsigned long long) counts[len] << (maxBits - len);
+   }
+   while (total > (1ull << maxBits)) {
+      counts[maxBits]--;
+      for (int len = maxBits - 1; len > 0; len--) {
+         if (counts[len] > 0) {
+            counts[len]--;
+            counts[len + 1] += 2;
+            break;
+         }
+      }
+      total--;
+   }
+   // the rarest symbols get the longest codes
+   int next = 0;
+   for (int len = maxBits; len > 0; len--) {
+      for (int k = 0; k < counts[len]; k++) {
+         lengths[symbols[next++]] = len;
+      }
+   }
+}
+
+// set codes to the canonical Huffman codes for lengths, bit-reversed for
+// writing least significant bit first
+static void buildCodes(const unsigned char* lengths, int n, unsigned short* codes) {
+   int counts[16] = {0};
+   for (int i = 0; i < n; i++) {
+      counts[lengths[i]]++;
+   }
+   counts[0] = 0;
+   int next[16] = {0};
+   int code = 0;
+   for (int len = 1; len < 16; len++) {
+      code = (code + counts[len - 1]) << 1;
+      next[len] = code;
+   }
+   for (int i = 0; i < n; i++) {
+      int len = lengths[i];
+      if (len == 0) {
+         codes[i] = 0;
+         continue;
+      }
+      int value = next[len]++;
+      int reversed = 0;
+      for (int k = 0; k < len; k++) {
+         reversed = (reversed << 1) | ((value >> k) & 1);
+      }
+      codes[i] = reversed;
+   }
+}
+
+// give at least two symbols a nonzero frequency, so every tree is a
+// complete code
+static void ensureTwoSymbols(unsigned int* freq, int n) {
+   int used = 0;
+   for (int i = 0; i < n; i++) {
+      used += freq[i] > 0;
+   }
+   for (int i = 0; i < n && used < 2; i++) {
+      if (freq[i] == 0) {
+         freq[i] = 1;
+         used++;
+      }
+   }
+}
+
+// write size bytes as stored blocks (at least one, even when size is 0)
+static void writeStored(BitWriter& bits, const unsigned char* raw, size_t size, bool last) {
+   do {
+      int n = (int) std::min(size, (size_t) MAX_STORED);
+      bits.put(last && (size_t) n == size ? 1 : 0, 1);
+      bits.put(0, 2);
+      bits.align();
+      std::vector<unsigned char>& out = bits.bytes();
+      out.push_back(n & 0xff);
+      out.push_back(n >> 8);
+      out.push_back(~n & 0xff);
+      out.push_back((~n >> 8) & 0xff);
+      out.insert(out.end(), raw, raw + n);
+      raw += n;
+      size -= n;
+   } while (size > 0);
+}
+
+// an entry of the run-length coded code lengths
+struct CodeLength {
+  unsigned char symbol;
+  unsigned char extra;
+};
+
+// write symbols, which encode the rawSize bytes at raw, as one dynamic
+// Huffman block, or as stored blocks if that is smaller
+static void writeBlock(BitWriter& bits, const std::vector<Symbol>& symbols,
+   const unsigned char* raw, size_t rawSize, bool last) {
+   const CodeTables& codes = tables();
+   unsigned int litFreq[NUM_LITLEN] = {0};
+   unsigned int distFreq[NUM_DIST] = {0};
+   for (const Symbol& s : symbols) {
+      if (s.dist == 0) {
+         litFreq[s.litLen]++;
+      } else {
+         litFreq[257 + codes.lengthCode[s.litLen]]++;
+         distFreq[codes.distCode(s.dist)]++;
+      }
+   }
+   litFreq[256] = 1;
+   ensureTwoSymbols(litFreq, NUM_LITLEN);
+   ensureTwoSymbols(distFreq, NUM_DIST);
+   unsigned char litLen[NUM_LITLEN];
+   unsigned char distLen[NUM_DIST];
+   buildLengths(litFreq, NUM_LITLEN, 15, litLen);
+   buildLengths(distFreq, NUM_DIST, 15, distLen);
+
+   int numLit = NUM_LITLEN;
+   while (numLit > 257 && litLen[numLit - 1] == 0) {
+      numLit--;
+   }
+   int numDist = NUM_DIST;
+   while (numDist > 1 && distLen[numDist - 1] == 0) {
+      numDist--;
+   }
+   // run-length code both sets of lengths as one sequence
+   std::vector<unsigned char> all(litLen, litLen + numLit);
+   all.insert(all.end(), distLen, distLen + numDist);
+   std::vector<CodeLength> runs;
+   for (size_t i = 0; i < all.size(); ) {
+      int len = all[i];
+      int run = 1;
+      while (i + run < all.size() && all[i + run] == len) {
+         run++;
+      }
+      i += run;
+      if (len == 0) {
+         while (run >= 11) {
+            int n = std::min(run, 138);
+            runs.push_back(CodeLength{18, (unsigned char) (n - 11)});
+            run -= n;
+         }
+         if (run >= 3) {
+            runs.push_back(CodeLength{17, (unsigned char) (run - 3)});
+            run = 0;
+         }
+      } else {
+         runs.push_back(CodeLength{(unsigned char) len, 0});
+         run--;
+         while (run >= 3) {
+            int n = std::min(run, 6);
+            runs.push_back(CodeLength{16, (unsigned char) (n - 3)});
+            run -= n;
+         }
+      }
+      for (; run > 0; run--) {
+         runs.push_back(CodeLength{(unsigned char) len, 0});
+      }
+   }
+   unsigned int clFreq[NUM_CODELEN] = {0};
+   for (const CodeLength& c : runs) {
+      clFreq[c.symbol]++;
+   }
+   ensureTwoSymbols(clFreq, NUM_CODELEN);
+   unsigned char clLen[NUM_CODELEN];
+   buildLengths(clFreq, NUM_CODELEN, 7, clLen);
+   int numCl = NUM_CODELEN;
+   while (numCl > 4 && clLen[CODELEN_ORDER[numCl - 1]] == 0) {
+      numCl--;
+   }
+
+   // compare the size of the dynamic block against storing the bytes
+   static const int CL_EXTRA[3] = {2, 3, 7};
+   unsigned long long dynamicBits = 3 + 14 + 3 * numCl;
+   for (const CodeLength& c : runs) {
+      dynamicBits += clLen[c.symbol] + (c.symbol >= 16 ? CL_EXTRA[c.symbol - 16] : 0);
+   }
+   for (int i = 0; i < NUM_LITLEN; i++) {
+      dynamicBits += (unsigned long long) litFreq[i] * litLen[i];
+      if (i >= 257) {
+         dynamicBits += (unsigned long long) litFreq[i] * LENGTH_EXTRA[i - 257];
+      }
+   }
+   for (int i = 0; i < NUM_DIST; i++) {
+      dynamicBits += (unsigned long long) distFreq[i] * (distLen[i] + DIST_EXTRA[i]);
+   }
+   unsigned long long storedBits = (rawSize + 5 * (rawSize / MAX_STORED + 1)) * 8 + 7;
+   if (storedBits < dynamicBits) {
+      writeStored(bits, raw, rawSize, last);
+      return;
+   }
+
+   unsigned short litCodes[NUM_LITLEN];
+   unsigned short distCodes[NUM_DIST];
+   unsigned short clCodes[NUM_CODELEN];
+   buildCodes(litLen, NUM_LITLEN, litCodes);
+   buildCodes(distLen, NUM_DIST, distCodes);
+   buildCodes(clLen, NUM_CODELEN, clCodes);
+   bits.put(last ? 1 : 0, 1);
+   bits.put(2, 2);
+   bits.put(numLit - 257, 5);
+   bits.put(numDist - 1, 5);
+   bits.put(numCl - 4, 4);
+   for (int i = 0; i < numCl; i++) {
+      bits.put(clLen[CODELEN_ORDER[i]], 3);
+   }
+   for (const CodeLength& c : runs) {
+      bits.put(clCodes[c.symbol], clLen[c.symbol]);
+      if (c.symbol >= 16) {
+         bits.put(c.extra, CL_EXTRA[c.symbol - 16]);
+      }
+   }
+   for (const Symbol& s : symbols) {
+      if (s.dist == 0) {
+         bits.put(litCodes[s.litLen], litLen[s.litLen]);
+      } else {
+         int lc = codes.lengthCode[s.litLen];
+         bits.put(litCodes[257 + lc], litLen[257 + lc]);
+         bits.put(s.litLen - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+         int dc = codes.distCode(s.dist);
+         bits.put(distCodes[dc], distLen[dc]);
+         bits.put(s.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+      }
+   }
+   bits.put(litCodes[256], litLen[256]);
+}
+
+// return how many of the first maxLen bytes of p and q are equal,
+// comparing 8 bytes at a time
+static inline int matchLength(const unsigned char* p, const unsigned char* q, int maxLen) {
+   int len = 0;
+   while (len + 8 <= maxLen) {
+      unsigned long long a;
+      unsigned long long b;
+      memcpy(&a, p + len, 8);
+      memcpy(&b, q + len, 8);
+      if (a != b) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+         return len + (__builtin_ctzll(a ^ b) >> 3);
+#else
+         break;
+#endif
+      }
+      len += 8;
+   }
+   while (len < maxLen && p[len] == q[len]) {
+      len++;
+   }
+   return len;
+}
+
+// finds LZ77 matches in a buffer through hash chains of earlier positions
+class Matcher {
+ public:
+  Matcher(const unsigned char* base, size_t end, const LevelParams& params) :
+     _base(base), _end(end), _params(params),
+     _head(1 << HASH_BITS, -1), _prev(WINDOW_SIZE, -1) {}
+
+  // add position pos to the chains
+  void insert(size_t pos) {
+     if (pos + MIN_MATCH <= this->_end) {
+        unsigned int h = this->hash(pos);
+        this->_prev[pos & WINDOW_MASK] = this->_head[h];
+        this->_head[h] = (int) pos;
+     }
+  }
+
+  // return the longest match for pos among the chained earlier positions
+  Symbol find(size_t pos, int prevLen = 0) const {
+     Symbol best = {0, 0};
+     if (pos + MIN_MATCH > this->_end) {
+        return best;
+     }
+     int maxLen = (int) std::min((size_t) MAX_MATCH, this->_end - pos);
+     const unsigned char* p = this->_base + pos;
+     int bestLen = 0;
+     int cand = this->_head[this->hash(pos)];
+     int chain = this->_params.maxChain;
+     // a good match already waits at the previous position
+     if (prevLen >= this->_params.goodLength) {
+        chain >>= 2;
+     }
+     for (; cand >= 0 && chain > 0; chain--) {
+        if (pos - cand > (size_t) WINDOW_SIZE) {
+           break;
+        }
+        const unsigned char* q = this->_base + cand;
+        if (q[bestLen] == p[bestLen] && q[0] == p[0] && q[1] == p[1]) {
+           int len = matchLength(p, q, maxLen);
+           if (len > bestLen) {
+              bestLen = len;
+              best.litLen = len;
+              best.dist = (unsigned short) (pos - cand);
+              if (len >= this->_params.niceLength || len == maxLen) {
+                 break;
+              }
+           }
+        }
+        int next = this->_prev[cand & WINDOW_MASK];
+        // a slot reused by a newer position ends the chain
+        if (next >= cand) {
+           break;
+        }
+        cand = next;
+     }
+     if (bestLen < MIN_MATCH) {
+        best.litLen = 0;
+        best.dist = 0;
+     }
+     return best;
+  }
+
+ private:
+  unsigned int hash(size_t pos) const {
+     const unsigned char* p = this->_base + pos;
+     unsigned int key = p[0] | (p[1] << 8) | (p[2] << 16);
+     return (key * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  const unsigned char* _base;
+  size_t _end;
+  LevelParams _params;
+  std::vector<int> _head;
+  std::vector<int> _prev;
+};
+
+void compress(const unsigned char* data, size_t size, size_t dictSize,
+   int level, bool last, std::vector<unsigned char>& out) {
+   BitWriter bits(out);
+   if (level <= 0) {
+      writeStored(bits, data, size, last);
+      return;
+   }
+   const LevelParams& params = LEVELS[std::min(level, 9)];
+   dictSize = std::min(dictSize, (size_t) WINDOW_SIZE);
+   const unsigned char* base = data - dictSize;
+   size_t end = dictSize + size;
+   Matcher matcher(base, end, params);
+   for (size_t pos = 0; pos < dictSize; pos++) {
+      matcher.insert(pos);
+   }
+   std::vector<Symbol> symbols;
+   symbols.reserve(BLOCK_SYMBOLS);
+   size_t blockStart = dictSize;
+   size_t pos = dictSize;
+   // match found for pos while looking ahead from pos - 1
+   Symbol next = {0, 0};
+   bool haveNext = false;
+   while (pos < end) {
+      Symbol match = haveNext ? next : matcher.find(pos);
+      haveNext = false;
+      matcher.insert(pos);
+      if (match.dist && params.lazy && match.litLen < params.maxLazy && pos + 1 < end) {
+         next = matcher.find(pos + 1, match.litLen);
+         haveNext = true;
+         if (next.litLen > match.litLen) {
+            // a longer match starts at the next byte
+            match.dist = 0;
+         }
+      }
+      if (match.dist) {
+         symbols.push_back(match);
+         if (params.lazy || match.litLen <= params.maxLazy) {
+            for (size_t k = 1; k < match.litLen; k++) {
+               matcher.insert(pos + k);
+            }
+         }
+         pos += match.litLen;
+         haveNext = false;
+      } else {
+         symbols.push_back(Symbol{base[pos], 0});
+         pos++;
+      }
+      if (symbols.size() >= BLOCK_SYMBOLS) {
+         writeBlock(bits, symbols, base + blockStart, pos - blockStart, false);
+         symbols.clear();
+         blockStart = pos;
+      }
+   }
+   writeBlock(bits, symbols, base + blockStart, pos - blockStart, last);
+   if (!last) {
+      // an empty stored block ends the chunk on a byte boundary
+      writeStored(bits, NULL, 0, false);
+   }
+   bits.align();
+}
+
+unsigned int adler32(const unsigned char* data, size_t size, unsigned int adler) {
+   static const unsigned int BASE = 65521;
+   // most bytes that can be summed before the sums may overflow
+   static const size_t NMAX = 5552;
+   unsigned int a = adler & 0xffff;
+   unsigned int b = adler >> 16;
+   while (size > 0) {
+      size_t n = std::min(size, NMAX);
+      size -= n;
+      for (size_t i = 0; i < n; i++) {
+         a += data[i];
+         b += a;
+      }
+      data += n;
+      a %= BASE;
+      b %= BASE;
+   }
+   return (b << 16) | a;
+}
+
+unsigned int adler32Combine(unsigned int adler1, unsigned int adler2, size_t size2) {
+   static const unsigned int BASE = 65521;
+   unsigned int rem = (unsigned int) (size2 % BASE);
+   unsigned int a1 = adler1 & 0xffff;
+   unsigned int b1 = adler1 >> 16;
+   unsigned int a2 = adler2 & 0xffff;
+   unsigned int b2 = adler2 >> 16;
+   // the second buffer's sums continue from a1: a = a1 + a2 - 1 and
+   // b = b1 + b2 + size2 * (a1 - 1), all mod BASE
+   unsigned int a = (a1 + a2 + BASE - 1) % BASE;
+   unsigned int b = (unsigned int) ((b1 + b2 + (unsigned long long) rem * a1 + BASE - rem) % BASE);
+   return (b << 16) | a;
+}
+
+unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc) {
+   const unsigned int* table = tables().crc;
+   crc = ~crc;
+   for (size_t i = 0; i < size; i++) {
+      crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+   }
+   return ~crc;
+}
+
+}  // namespace deflate
+}  // namespace agl
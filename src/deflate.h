@@ -0,0 +1,50 @@
+/**
+ * Deflate (RFC 1951) compressor that can encode a stream in independent
+ * chunks, so the chunks can be compressed on separate threads and
+ * concatenated, as pigz does
+ *
+ * @file deflate.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_DEFLATE_H_
+#define AGL_DEFLATE_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace agl {
+namespace deflate {
+
+/**
+ * @brief Append the deflate blocks of size bytes at data to out
+ * @param dictSize Bytes before data that matches may refer back to (the
+ * end of the previous chunk); at most 32 KB are used
+ * @param level 0 (store only, fastest) to 9 (smallest)
+ * @param last Whether this is the final chunk of the stream. Other chunks
+ * end with an empty stored block, so they end on a byte boundary and the
+ * next chunk's bytes can simply follow.
+ */
+void compress(const unsigned char* data, size_t size, size_t dictSize,
+   int level, bool last, std::vector<unsigned char>& out);
+
+/**
+ * @brief Update the Adler-32 checksum adler (1 to start) with size bytes
+ */
+unsigned int adler32(const unsigned char* data, size_t size, unsigned int adler = 1);
+
+/**
+ * @brief Return the Adler-32 of two buffers joined, from their checksums
+ * @param size2 The size of the second buffer
+ */
+unsigned int adler32Combine(unsigned int adler1, unsigned int adler2, size_t size2);
+
+/**
+ * @brief Update the CRC-32 checksum crc (0 to start) with size bytes
+ */
+unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0);
+
+}  // namespace deflate
+}  // namespace agl
+#endif  // AGL_DEFLATE_H_
@@ -0,0 +1,166 @@
+/**
+ * Implementation of the power-of-two FFTs
+ *
+ * @file fft.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace agl {
+namespace fft {
+
+// a * b without the NaN and infinity handling of std::complex, which
+// compiles to a library call
+static inline Complex mul(const Complex& a, const Complex& b) {
+   return Complex(a.real() * b.real() - a.imag() * b.imag(),
+      a.real() * b.imag() + a.imag() * b.real());
+}
+
+static inline Complex twiddle(int k, int n) {
+   double angle = -2 * M_PI * k / n;
+   return Complex((float) cos(angle), (float) sin(angle));
+}
+
+Plan::Plan(int n) {
+   this->_n = n;
+   this->_reversed.resize(n);
+   int bits = 0;
+   while ((1 << bits) < n) {
+      bits++;
+   }
+   for (int i = 0; i < n; i++) {
+      int reversed = 0;
+      for (int b = 0; b < bits; b++) {
+         reversed |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      this->_reversed[i] = reversed;
+   }
+   for (int k = 0; k < n / 2; k++) {
+      this->_twiddles.push_back(twiddle(k, n));
+   }
+}
+
+int Plan::size() const {
+   return this->_n;
+}
+
+void Plan::forward(Complex* data) const {
+   this->transform(data, false);
+}
+
+void Plan::inverse(Complex* data) const {
+   this->transform(data, true);
+}
+
+void Plan::transform(Complex* data, bool inverse) const {
+   int n = this->_n;
+   for (int i = 0; i < n; i++) {
+      int j = this->_reversed[i];
+      if (i < j) {
+         std::swap(data[i], data[j]);
+      }
+   }
+   // butterflies of each size combine pairs of transforms of half the size
+   for (int size = 2; size <= n; size *= 2) {
+      int half = size / 2;
+      int stride = n / size;
+      for (int start = 0; start < n; start += size) {
+         for (int k = 0; k < half; k++) {
+            Complex w = this->_twiddles[k * stride];
+            if (inverse) {
+               w = std::conj(w);
+            }
+            Complex t = mul(w, data[start + k + half]);
+            data[start + k + half] = data[start + k] - t;
+            data[start + k] += t;
+         }
+      }
+   }
+}
+
+RealPlan2D::RealPlan2D(int n) : _half(n / 2), _columns(n) {
+   this->_n = n;
+   for (int k = 0; k <= n / 2; k++) {
+      this->_twiddles.push_back(twiddle(k, n));
+   }
+}
+
+int RealPlan2D::size() const {
+   return this->_n;
+}
+
+int RealPlan2D::spectrumWidth() const {
+   return this->_n / 2 + 1;
+}
+
+void RealPlan2D::forward(const float* in, Complex* out, Complex* scratch) const {
+   int n = this->_n;
+   int half = n / 2;
+   int m = this->spectrumWidth();
+   for (int r = 0; r < n; r++) {
+      const float* row = in + (size_t) r * n;
+      for (int j = 0; j < half; j++) {
+         scratch[j] = Complex(row[2 * j], row[2 * j + 1]);
+      }
+      this->_half.forward(scratch);
+      // Z = E + iO, with E and O the transforms of the evens and odds;
+      // X[k] = E[k] + e^(-2 pi i k / n) O[k]
+      Complex* spectrum = out + (size_t) r * m;
+      for (int k = 0; k <= half; k++) {
+         Complex z = scratch[k % half];
+         Complex mirror = std::conj(scratch[(half - k) % half]);
+         Complex even = (z + mirror) * 0.5f;
+         Complex diff = (z - mirror) * 0.5f;
+         Complex odd(diff.imag(), -diff.real());
+         spectrum[k] = even + mul(this->_twiddles[k], odd);
+      }
+   }
+   for (int c = 0; c < m; c++) {
+      for (int r = 0; r < n; r++) {
+         scratch[r] = out[(size_t) r * m + c];
+      }
+      this->_columns.forward(scratch);
+      for (int r = 0; r < n; r++) {
+         out[(size_t) r * m + c] = scratch[r];
+      }
+   }
+}
+
+void RealPlan2D::inverse(Complex* spectrum, float* out, Complex* scratch) const {
+   int n = this->_n;
+   int half = n / 2;
+   int m = this->spectrumWidth();
+   for (int c = 0; c < m; c++) {
+      for (int r = 0; r < n; r++) {
+         scratch[r] = spectrum[(size_t) r * m + c];
+      }
+      this->_columns.inverse(scratch);
+      for (int r = 0; r < n; r++) {
+         spectrum[(size_t) r * m + c] = scratch[r];
+      }
+   }
+   for (int r = 0; r < n; r++) {
+      const Complex* x = spectrum + (size_t) r * m;
+      // the reverse of the split in forward
+      for (int k = 0; k < half; k++) {
+         Complex mirror = std::conj(x[half - k]);
+         Complex even = (x[k] + mirror) * 0.5f;
+         Complex odd = mul((x[k] - mirror) * 0.5f, std::conj(this->_twiddles[k]));
+         scratch[k] = even + Complex(-odd.imag(), odd.real());
+      }
+      this->_half.inverse(scratch);
+      float* row = out + (size_t) r * n;
+      for (int j = 0; j < half; j++) {
+         row[2 * j] = scratch[j].real();
+         row[2 * j + 1] = scratch[j].imag();
+      }
+   }
+}
+
+}  // namespace fft
+}  // namespace agl
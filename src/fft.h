@@ -0,0 +1,83 @@
+/**
+ * Fast Fourier transforms of power-of-two sizes, for convolution with
+ * large kernels
+ *
+ * @file fft.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_FFT_H_
+#define AGL_FFT_H_
+
+#include <complex>
+#include <vector>
+
+namespace agl {
+namespace fft {
+
+typedef std::complex<float> Complex;
+
+/**
+ * @brief Radix-2 complex FFT of a fixed power-of-two length
+ *
+ * forward computes X[k] = sum of x[j] e^(-2 pi i jk / n), in place;
+ * inverse uses e^(+2 pi i jk / n) and does not divide by n.
+ */
+class Plan {
+ public:
+  explicit Plan(int n);
+
+  int size() const;
+  void forward(Complex* data) const;
+  void inverse(Complex* data) const;
+
+ private:
+  void transform(Complex* data, bool inverse) const;
+
+  int _n;
+  // where each index moves in the bit-reversed order
+  std::vector<int> _reversed;
+  // e^(-2 pi i k / n) for k < n / 2
+  std::vector<Complex> _twiddles;
+};
+
+/**
+ * @brief 2D FFT of n by n real values, n a power of two
+ *
+ * The spectrum of real input is conjugate symmetric, so only columns 0 to
+ * n / 2 are kept: n rows of n / 2 + 1 values. Each row is transformed as
+ * n / 2 complex values, evens real and odds imaginary, and then split.
+ */
+class RealPlan2D {
+ public:
+  explicit RealPlan2D(int n);
+
+  int size() const;
+
+  // complex values per spectrum row, n / 2 + 1
+  int spectrumWidth() const;
+
+  /**
+   * @brief Transform in, n * n floats, into out, n * spectrumWidth()
+   * values; scratch holds at least n values
+   */
+  void forward(const float* in, Complex* out, Complex* scratch) const;
+
+  /**
+   * @brief Transform spectrum back into out, overwriting spectrum; the
+   * result is n * n / 2 times the input of forward
+   */
+  void inverse(Complex* spectrum, float* out, Complex* scratch) const;
+
+ private:
+  int _n;
+  Plan _half;
+  Plan _columns;
+  // e^(-2 pi i k / n) for k <= n / 2, to split the half-length transforms
+  std::vector<Complex> _twiddles;
+};
+
+}  // namespace fft
+}  // namespace agl
+#endif  // AGL_FFT_H_
@@ -8,47 +8,161 @@
 
 #include "image.h"
 
+#include "blur.h"
+#include "bufferpool.h"
+#include "convolve.h"
+#include "integral.h"
+#include "lut.h"
+#include "mappedfile.h"
+#include "pipeline.h"
+#include "png.h"
+#include "pnm.h"
+#include "pointops.h"
+#include "qoi.h"
+#include "resample.h"
+#include "rowio.h"
+#include "simd.h"
+#include "stencil.h"
+#include "threadpool.h"
+#include "trace.h"
+
 #include <cassert>
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "../external/include/stb/stb_image_write.h"
 #define STB_IMAGE_IMPLEMENTATION
+// the failure reason is a global, so concurrent loads would race on it
+#define STBI_NO_FAILURE_STRINGS
 #include "../external/include/stb/stb_image.h"
 
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <vector>
 
 namespace agl {
 
+// pixels per block handed to a thread by the per-pixel loops
+static const int BLOCK_PIXELS = 16384;
+
+// Apply a binary simd kernel to the bytes of a and b, writing to result,
+// in parallel. All three images must be the same size, and a and result
+// the same layout; b is converted if its layout differs.
+static void combine(const Image& a, const Image& b, Image& result,
+      void (*kernel)(const unsigned char*, const unsigned char*, unsigned char*, int)) {
+   Image converted;
+   const unsigned char* other = b.data();
+   if (b.layout() != a.layout()) {
+      converted = b.toLayout(a.layout());
+      other = converted.data();
+   }
+   parallelFor(0, a.width() * a.height(), BLOCK_PIXELS, [&](int first, int last) {
+      kernel(a.data() + first * 3, other + first * 3, result.data() + first * 3, (last - first) * 3);
+   });
+}
+
+
+// bytes of pixel data in a width by height image
+static size_t numBytes(int width, int height) {
+   return (size_t) width * height * 3;
+}
+
+// round(total / count) for boxBlur, using a reciprocal of count in place
+// of an integer division, then correcting the quotient by one if needed
+static inline unsigned char roundedMean(uint64_t total, uint64_t count, double inverse) {
+   uint64_t n = total + count / 2;
+   uint64_t q = (uint64_t) (n * inverse);
+   if (q * count > n) {
+      q--;
+   } else if ((q + 1) * count <= n) {
+      q++;
+   }
+   return (unsigned char) q;
+}
+
+// r,g,b text of a color, for trace arguments
+static std::string colorName(const Pixel& c) {
+   return std::to_string(c.r) + "," + std::to_string(c.g) + "," + std::to_string(c.b);
+}
 
 Image::Image() {
    this->_data = NULL;
+   this->_mapped = NULL;
    this->_width = 0;
    this->_height = 0;
+   this->_layout = Layout::Interleaved;
 }
 
-Image::Image(int width, int height)  {
-   this->_data = (unsigned char*) calloc(width * height * 3, sizeof(unsigned char*));
+Image::Image(int width, int height, bool zero)  {
+   this->_data = BufferPool::shared().acquire(numBytes(width, height), zero);
+   this->_mapped = NULL;
    this->_width = width;
    this->_height = height;
+   this->_layout = Layout::Interleaved;
+}
+
+Image::Image(int width, int height, Layout layout, bool zero) : Image(width, height, zero) {
+   this->_layout = layout;
 }
 
 Image::Image(const Image& orig) {
-   this->_data = (unsigned char*) malloc(sizeof(unsigned char*) * orig.width() * orig.height() * 3);
-   for (int idx = 0; idx < orig.width() * orig.height(); idx++) {
-      this->set(idx, orig.get(idx));
-   }
    this->_width = orig.width();
    this->_height = orig.height();
+   this->_layout = orig.layout();
+   this->_data = NULL;
+   this->_mapped = NULL;
+   if (orig.data()) {
+      trace::Scope scope("copy", orig.width(), orig.height());
+      this->_data = BufferPool::shared().acquire(numBytes(orig.width(), orig.height()), false);
+      memcpy(this->_data, orig.data(), numBytes(orig.width(), orig.height()));
+   }
+}
+
+Image::Image(Image&& orig) noexcept {
+   this->_data = orig._data;
+   this->_mapped = orig._mapped;
+   this->_width = orig._width;
+   this->_height = orig._height;
+   this->_layout = orig._layout;
+   orig._data = NULL;
+   orig._mapped = NULL;
+   orig._width = 0;
+   orig._height = 0;
 }
 
 Image& Image::operator=(const Image& orig) {
    if (&orig == this) {
       return *this;
    }
-   free(this->_data);
-   this->_data = orig.data();
+   trace::Scope scope("copy", orig.width(), orig.height());
+   // keep our buffer when it is already the right size
+   if (numBytes(this->_width, this->_height) != numBytes(orig.width(), orig.height()) || !orig.data()) {
+      this->releaseData();
+      if (orig.data()) {
+         this->_data = BufferPool::shared().acquire(numBytes(orig.width(), orig.height()), false);
+      }
+   }
+   if (orig.data()) {
+      memcpy(this->_data, orig.data(), numBytes(orig.width(), orig.height()));
+   }
    this->_width = orig.width();
    this->_height = orig.height();
+   this->_layout = orig.layout();
+   return *this;
+}
+
+Image& Image::operator=(Image&& orig) noexcept {
+   if (&orig == this) {
+      return *this;
+   }
+   this->releaseData();
+   this->_data = orig._data;
+   this->_mapped = orig._mapped;
+   this->_width = orig._width;
+   this->_height = orig._height;
+   this->_layout = orig._layout;
+   orig._data = NULL;
+   orig._mapped = NULL;
+   orig._width = 0;
+   orig._height = 0;
    return *this;
 }
 
@@ -70,10 +184,17 @@ std::ostream& operator<<(std::ostream& os, const Image& image) {
 }
 
 Image::~Image() {
-   std::cout << "~ Freeing memory" << std::endl;
-   if (this->_data) {
-      free(this->_data);
+   this->releaseData();
+}
+
+void Image::releaseData() {
+   if (this->_mapped) {
+      delete this->_mapped;
+      this->_mapped = NULL;
+   } else {
+      BufferPool::shared().release(this->_data, numBytes(this->_width, this->_height));
    }
+   this->_data = NULL;
 }
 
 int Image::width() const { 
@@ -88,8 +209,53 @@ unsigned char* Image::data() const {
    return this->_data;
 }
 
+Layout Image::layout() const {
+   return this->_layout;
+}
+
+Image Image::toLayout(Layout layout) const& {
+   if (layout == this->_layout) {
+      return Image(*this);
+   }
+   trace::Scope scope("toLayout", this->_width, this->_height);
+   scope.arg("layout", layout == Layout::Planar ? "planar" : "interleaved");
+   Image result(this->_width, this->_height, layout, false);
+   size_t planeSize = (size_t) this->_width * this->_height;
+   unsigned char* rgb = layout == Layout::Planar ? this->_data : result._data;
+   unsigned char* planes = layout == Layout::Planar ? result._data : this->_data;
+   parallelFor(0, this->_width * this->_height, BLOCK_PIXELS, [&](int first, int last) {
+      unsigned char* r = planes + first;
+      unsigned char* g = planes + planeSize + first;
+      unsigned char* b = planes + 2 * planeSize + first;
+      if (layout == Layout::Planar) {
+         simd::deinterleave(rgb + first * 3, r, g, b, last - first);
+      } else {
+         simd::interleave(r, g, b, rgb + first * 3, last - first);
+      }
+   });
+   return result;
+}
+
+Image Image::toLayout(Layout layout) && {
+   this->toLayoutInPlace(layout);
+   return std::move(*this);
+}
+
+Image& Image::toLayoutInPlace(Layout layout) {
+   if (layout != this->_layout && this->_data) {
+      // the bytes move across the whole image, so convert into a new buffer
+      *this = static_cast<const Image&>(*this).toLayout(layout);
+   }
+   this->_layout = layout;
+   return *this;
+}
+
 void Image::set(int width, int height, unsigned char* data) {
    if (this->_width == width && this->_height == height) {
+      if (this->_data != data) {
+         this->releaseData();
+         BufferPool::shared().adopt(data, numBytes(width, height));
+      }
       this->_data = data;
    } else {
       std::cerr << "set(): Dimensions must match!" << std::endl;
@@ -97,28 +263,142 @@ void Image::set(int width, int height, unsigned char* data) {
 }
 
 bool Image::load(const std::string& filename, bool flip) {
-   std::cout << "Loading " << filename << std::endl;
+   Layout layout = this->_layout;
+   this->_layout = Layout::Interleaved;
+   bool loaded = this->decode(filename, flip);
+   this->toLayoutInPlace(layout);
+   return loaded;
+}
+
+bool Image::decode(const std::string& filename, bool flip) {
+   trace::Scope scope("load");
+   scope.arg("file", filename);
    int n;
+   this->releaseData();
+   if (hasExtension(filename, ".ppm") || hasExtension(filename, ".pam")) {
+      if (!this->loadMapped(filename)) {
+         this->_width = 0;
+         this->_height = 0;
+         return false;
+      }
+      scope.setSize(this->_width, this->_height);
+      if (flip) {
+         this->flipHorizontalInPlace();
+      }
+      return true;
+   }
+   if (hasExtension(filename, ".qoi")) {
+      QoiReader reader;
+      if (!reader.open(filename)) {
+         this->_width = 0;
+         this->_height = 0;
+         return false;
+      }
+      this->_width = reader.width();
+      this->_height = reader.height();
+      this->_data = BufferPool::shared().acquire(numBytes(this->_width, this->_height), false);
+      if (!reader.read(this->_data, this->_height)) {
+         this->releaseData();
+         this->_width = 0;
+         this->_height = 0;
+         return false;
+      }
+      scope.setSize(this->_width, this->_height);
+      if (flip) {
+         this->flipHorizontalInPlace();
+      }
+      return true;
+   }
+   // stbi allocates exactly width * height * 3 bytes with malloc, so the
+   // buffer can go back to the pool like any other
    this->_data = stbi_load(filename.c_str(), &this->_width, &this->_height, &n, 3);
+   if (!this->_data) {
+      this->_width = 0;
+      this->_height = 0;
+      return false;
+   }
+   BufferPool::shared().adopt(this->_data, numBytes(this->_width, this->_height));
+   scope.setSize(this->_width, this->_height);
    if (flip) {
-      this->set(this->_width, this->_height, (this->flipHorizontal()).data());
+      this->flipHorizontalInPlace();
    }
-   if (!this->_data) {
+   return true;
+}
+
+bool Image::loadMapped(const std::string& filename) {
+   MappedFile* file = MappedFile::openPrivate(filename);
+   if (!file) {
+      std::cerr << "Cannot map " << filename << std::endl;
       return false;
-   } else {
+   }
+   const unsigned char* bytes = file->data();
+   size_t size = file->size();
+   size_t pos = 0;
+   pnm::Header header;
+   bool ok = pnm::parseHeader([&]() { return pos < size ? (int) bytes[pos++] : EOF; }, header);
+   // pixels the file holds, divided down so a huge header cannot
+   // overflow the product of its sides
+   size_t available = ok ? (size - header.dataOffset) / header.depth : 0;
+   if (!ok || (size_t) header.height > available / header.width) {
+      std::cerr << filename << " is not an 8-bit RGB PPM or PAM file" << std::endl;
+      delete file;
+      return false;
+   }
+   size_t numPixels = (size_t) header.width * header.height;
+   this->_width = header.width;
+   this->_height = header.height;
+   if (header.depth == 3) {
+      // point straight at the pixels in the mapping
+      this->_mapped = file;
+      this->_data = file->data() + header.dataOffset;
       return true;
    }
+   // RGBA: drop the alpha channel
+   this->_data = BufferPool::shared().acquire(numBytes(header.width, header.height), false);
+   const unsigned char* rgba = bytes + header.dataOffset;
+   parallelFor(0, (int) numPixels, BLOCK_PIXELS, [&](int first, int last) {
+      for (int idx = first; idx < last; idx++) {
+         memcpy(this->_data + idx * 3, rgba + (size_t) idx * 4, 3);
+      }
+   });
+   delete file;
+   return true;
 }
 
 bool Image::save(const std::string& filename, bool flip) const {
-   std::cout << "Saving to " << filename << std::endl;
+   trace::Scope scope("save", this->_width, this->_height);
+   scope.arg("file", filename);
    unsigned char* data = this->_data;
-   if (flip) {
-      data = (this->flipHorizontal()).data();
+   Image converted;
+   if (flip || this->_layout == Layout::Planar) {
+      converted = this->toLayout(Layout::Interleaved);
+      if (flip) {
+         converted.flipHorizontalInPlace();
+      }
+      data = converted.data();
+   }
+   int saved;
+   bool pam = hasExtension(filename, ".pam");
+   if (pam || hasExtension(filename, ".ppm")) {
+      // the header and pixels are copied straight into the file's pages
+      std::string header = pnm::header(this->_width, this->_height, pam);
+      MappedFile* file = MappedFile::create(filename, header.size() + numBytes(this->_width, this->_height));
+      saved = file != NULL;
+      if (file) {
+         memcpy(file->data(), header.data(), header.size());
+         memcpy(file->data() + header.size(), data, numBytes(this->_width, this->_height));
+         saved = file->commit();
+         delete file;
+      }
+   } else if (hasExtension(filename, ".qoi")) {
+      QoiWriter writer;
+      saved = writer.open(filename, this->_width, this->_height) &&
+         writer.write(data, this->_height) && writer.finish();
+   } else {
+      saved = png::write(filename, this->_width, this->_height, data);
    }
-   int saved = stbi_write_png(filename.c_str(), this->_width, this->_height, 3, (void*) data, this->_width * 3);
    if (!saved) {
-      std::cout << "Write error" << std::endl;
+      std::cerr << "Write error" << std::endl;
       return false;
    } else {
       return true;
@@ -126,262 +406,415 @@ bool Image::save(const std::string& filename, bool flip) const {
 }
 
 Pixel Image::get(int row, int col) const {
-   int idx = ((row * this->_width) + col) * 3;
-   return Pixel{ this->_data[idx], this->_data[idx + 1], this->_data[idx + 2] };
+   return this->get((row * this->_width) + col);
 }
 
 Pixel Image::get(int i) const {
+   if (this->_layout == Layout::Planar) {
+      size_t planeSize = (size_t) this->_width * this->_height;
+      return Pixel{ this->_data[i], this->_data[planeSize + i], this->_data[2 * planeSize + i] };
+   }
    int idx = i * 3;
    return Pixel{ this->_data[idx], this->_data[idx + 1], this->_data[idx + 2] };
 }
 
 void Image::set(int row, int col, const Pixel& color) {
-   int idx = ((row * this->_width) + col) * 3;
-   this->_data[idx] = color.r;
-   this->_data[idx + 1] = color.g;
-   this->_data[idx + 2] = color.b;
+   this->set((row * this->_width) + col, color);
 }
 
 void Image::set(int i, const Pixel& c) {
+   if (this->_layout == Layout::Planar) {
+      size_t planeSize = (size_t) this->_width * this->_height;
+      this->_data[i] = c.r;
+      this->_data[planeSize + i] = c.g;
+      this->_data[2 * planeSize + i] = c.b;
+      return;
+   }
    int idx = i * 3;
    this->_data[idx] = c.r;
    this->_data[idx + 1] = c.g;
    this->_data[idx + 2] = c.b;
 }
 
-Image Image::resize(int w, int h) const {
-   std::cout << "Resizing to " << w << " by " << h << std::endl;
-   Image result(w, h);
-   for (int i2 = 0; i2 < result.height(); i2++) {
-      for (int j2 = 0; j2 < result.width(); j2++) {
-         int i1 = (int)((float) i2 / (result.height() - 1) * (this->_height - 1));
-         int j1 = (int)((float) j2 / (result.width() - 1) * (this->_width - 1));
-         Pixel px1 = this->get(i1, j1);
-         result.set(i2, j2, px1);
-      }
+Image Image::resize(int w, int h, const std::string& filter) const {
+   if (!resample::isFilter(filter)) {
+      std::cerr << "Invalid filter argument!" << std::endl;
+      exit(1);
+   }
+   if (this->_layout == Layout::Planar) {
+      return this->toLayout(Layout::Interleaved).resize(w, h, filter).toLayout(Layout::Planar);
    }
+   trace::Scope scope("resize", this->_width, this->_height);
+   scope.arg("width", w).arg("height", h).arg("filter", filter);
+   Image result(w, h, false);
+   resample::resize(this->_data, this->_width, this->_height, result._data, w, h, filter);
    return result;
 }
 
-Image Image::flipHorizontal() const {
-   std::cout << "Flipping horizontally" << std::endl;
+Image Image::flipHorizontal() const& {
    Image result(*this);
-   for (int i = 0; i < result.height() / 2; i++) {
-      for (int j = 0; j < result.width(); j++) {
-         int newI = result.height() - i - 1;
-         Pixel temp = this->get(newI, j);
-         result.set(newI, j, this->get(i, j));
-         result.set(i, j, temp);
-      }
-   }
+   result.flipHorizontalInPlace();
    return result;
 }
 
-Image Image::flipVertical() const {
-   std::cout << "Flipping vertically" << std::endl;
-   Image result(*this);
-   for (int i = 0; i < result.height(); i++) {
-      for (int j = 0; j < result.width() / 2; j++) {
-         int newJ = result.width() - j - 1;
-         Pixel temp = this->get(i, newJ);
-         result.set(i, newJ, this->get(i, j));
-         result.set(i, j, temp);
+Image Image::flipHorizontal() && {
+   this->flipHorizontalInPlace();
+   return std::move(*this);
+}
+
+Image& Image::flipHorizontalInPlace() {
+   trace::Scope scope("flipHorizontal", this->_width, this->_height);
+   // a planar image flips each of its planes
+   int numPlanes = this->_layout == Layout::Planar ? 3 : 1;
+   int rowSize = this->_width * 3 / numPlanes;
+   size_t planeSize = (size_t) rowSize * this->_height;
+   parallelFor(0, this->_height / 2, 1, [&](int first, int last) {
+      std::vector<unsigned char> temp(rowSize);
+      for (int i = first; i < last; i++) {
+         for (int p = 0; p < numPlanes; p++) {
+            unsigned char* top = this->_data + p * planeSize + i * rowSize;
+            unsigned char* bottom = this->_data + p * planeSize + (this->_height - i - 1) * rowSize;
+            memcpy(&temp[0], top, rowSize);
+            memcpy(top, bottom, rowSize);
+            memcpy(bottom, &temp[0], rowSize);
+         }
       }
-   }
+   });
+   return *this;
+}
+
+Image Image::flipVertical() const& {
+   Image result(*this);
+   result.flipVerticalInPlace();
    return result;
 }
 
+Image Image::flipVertical() && {
+   this->flipVerticalInPlace();
+   return std::move(*this);
+}
+
+Image& Image::flipVerticalInPlace() {
+   trace::Scope scope("flipVertical", this->_width, this->_height);
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int j = 0; j < this->_width / 2; j++) {
+            int newJ = this->_width - j - 1;
+            Pixel temp = this->get(i, newJ);
+            this->set(i, newJ, this->get(i, j));
+            this->set(i, j, temp);
+         }
+      }
+   });
+   return *this;
+}
+
 Image Image::rotate90() const {
-   std::cout << "Rotating 90 degrees" << std::endl;
-   Image result(*this);
-   for (int i = 0; i < result.height(); i++) {
-      for (int j = 0; j < result.width(); j++) {
-         Pixel px1 = this->get(i, j);
-         int newI = j;
-         int newJ = result.height() - i;
-         result.set(newI, newJ, px1);
+   trace::Scope scope("rotate90", this->_width, this->_height);
+   Image result(this->_height, this->_width, this->_layout, false);
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int j = 0; j < this->_width; j++) {
+            // clockwise: row i becomes column height - 1 - i
+            result.set(j, this->_height - 1 - i, this->get(i, j));
+         }
       }
-   }
+   });
    return result;
 }
 
 Image Image::subimage(int startx, int starty, int w, int h) const {
-   std::cout << "Creating " << w << " by " << h << " subimage starting from (" << startx << ", " << starty << ")" << std::endl;
-   Image sub(w, h);
-   for (int i = starty; i < starty + h; i++) {
-      for (int j = startx; j < startx + w; j++) { 
-         int subIdx = ((i - starty) * sub.width()) + (j - startx);
-         sub.set(subIdx, this->get(i, j));
+   trace::Scope scope("subimage", this->_width, this->_height);
+   scope.arg("x", startx).arg("y", starty).arg("width", w).arg("height", h);
+   Image sub(w, h, this->_layout);
+   parallelRows(h, w, [&](int firstRow, int lastRow) {
+      for (int i = starty + firstRow; i < starty + lastRow; i++) {
+         for (int j = startx; j < startx + w; j++) { 
+            int subIdx = ((i - starty) * sub.width()) + (j - startx);
+            sub.set(subIdx, this->get(i, j));
+         }
       }
-   }
+   });
    return sub;
 }
 
 void Image::replace(const Image& image, int startx, int starty) {
-   std::cout << "Replacing with " << image.width() << " by " << image.height() << " image starting from (" << startx << ", " << starty << ")" << std::endl;
+   trace::Scope scope("replace", this->_width, this->_height);
+   scope.arg("x", startx).arg("y", starty).arg("width", image.width()).arg("height", image.height());
    int height = std::min(image.height(), this->_height - starty);
    int width = std::min(image.width(), this->_width - startx);
-   for (int i = starty; i < starty + height; i++) {
-      for (int j = startx; j < startx + width; j++) {
-         Pixel px2 = image.get(i - starty, j - startx);
-         this->set(i, j, px2);
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      for (int i = starty + firstRow; i < starty + lastRow; i++) {
+         for (int j = startx; j < startx + width; j++) {
+            Pixel px2 = image.get(i - starty, j - startx);
+            this->set(i, j, px2);
+         }
       }
-   }
+   });
 }
 
-Image Image::swirl() const {
-   std::cout << "Swirling colors" << std::endl;
+Image Image::swirl() const& {
    Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px = this->get(idx);
-      unsigned char red = px.r;
-      px.r = px.g;
-      px.g = px.b;
-      px.b = red;
-      result.set(idx, px);
-   }
+   result.swirlInPlace();
    return result;
 }
 
-Image Image::add(const Image& other) const {
-   std::cout << "Adding" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::min(px1.r + px2.r, 255);
-      px1.g = std::min(px1.g + px2.g, 255);
-      px1.b = std::min(px1.b + px2.b, 255);
-      result.set(idx, px1);
+Image Image::swirl() && {
+   this->swirlInPlace();
+   return std::move(*this);
+}
+
+Image& Image::swirlInPlace() {
+   trace::Scope scope("swirl", this->_width, this->_height);
+   if (this->_layout == Layout::Planar) {
+      // rotating the channels rotates whole planes: r g b becomes g b r
+      size_t planeSize = (size_t) this->_width * this->_height;
+      unsigned char* red = BufferPool::shared().acquire(planeSize, false);
+      memcpy(red, this->_data, planeSize);
+      memmove(this->_data, this->_data + planeSize, 2 * planeSize);
+      memcpy(this->_data + 2 * planeSize, red, planeSize);
+      BufferPool::shared().release(red, planeSize);
+      return *this;
    }
+   pointops::parallelApply(*this, [](unsigned char* data, int first, int n) {
+      pointops::swirl(data, n);
+   });
+   return *this;
+}
+
+Image Image::add(const Image& other) const& {
+   trace::Scope scope("add", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::add);
    return result;
 }
 
-Image Image::subtract(const Image& other) const {
-   std::cout << "Subtracting" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::max(px1.r - px2.r, 0);
-      px1.g = std::max(px1.g - px2.g, 0);
-      px1.b = std::max(px1.b - px2.b, 0);
-      result.set(idx, px1);
-   }
+Image Image::add(const Image& other) && {
+   this->addInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::addInPlace(const Image& other) {
+   trace::Scope scope("add", this->_width, this->_height);
+   combine(*this, other, *this, simd::add);
+   return *this;
+}
+
+Image Image::subtract(const Image& other) const& {
+   trace::Scope scope("subtract", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::subtract);
    return result;
 }
 
-Image Image::multiply(const Image& other) const {
-   std::cout << "Multiplying" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::min(px1.r * px2.r, 255);
-      px1.g = std::min(px1.g * px2.g, 255);
-      px1.b = std::min(px1.b * px2.b, 255);
-      result.set(idx, px1);
-   }
+Image Image::subtract(const Image& other) && {
+   this->subtractInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::subtractInPlace(const Image& other) {
+   trace::Scope scope("subtract", this->_width, this->_height);
+   combine(*this, other, *this, simd::subtract);
+   return *this;
+}
+
+Image Image::multiply(const Image& other) const& {
+   trace::Scope scope("multiply", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::multiply);
    return result;
 }
 
-Image Image::difference(const Image& other) const {
-   std::cout << "Finding difference" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::abs(px1.r - px2.r);
-      px1.g = std::abs(px1.g - px2.g);
-      px1.b = std::abs(px1.b - px2.b);
-      result.set(idx, px1);
-   }
+Image Image::multiply(const Image& other) && {
+   this->multiplyInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::multiplyInPlace(const Image& other) {
+   trace::Scope scope("multiply", this->_width, this->_height);
+   combine(*this, other, *this, simd::multiply);
+   return *this;
+}
+
+Image Image::difference(const Image& other) const& {
+   trace::Scope scope("difference", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::difference);
    return result;
 }
 
-Image Image::lightest(const Image& other) const {
-   std::cout << "Finding lightest" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::max(px1.r, px2.r);
-      px1.g = std::max(px1.g, px2.g);
-      px1.b = std::max(px1.b, px2.b);
-      result.set(idx, px1);
-   }
+Image Image::difference(const Image& other) && {
+   this->differenceInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::differenceInPlace(const Image& other) {
+   trace::Scope scope("difference", this->_width, this->_height);
+   combine(*this, other, *this, simd::difference);
+   return *this;
+}
+
+Image Image::lightest(const Image& other) const& {
+   trace::Scope scope("lightest", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::lightest);
    return result;
 }
 
-Image Image::darkest(const Image& other) const {
-   std::cout << "Finding darkest" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = std::min(px1.r, px2.r);
-      px1.g = std::min(px1.g, px2.g);
-      px1.b = std::min(px1.b, px2.b);
-      result.set(idx, px1);
-   }
+Image Image::lightest(const Image& other) && {
+   this->lightestInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::lightestInPlace(const Image& other) {
+   trace::Scope scope("lightest", this->_width, this->_height);
+   combine(*this, other, *this, simd::lightest);
+   return *this;
+}
+
+Image Image::darkest(const Image& other) const& {
+   trace::Scope scope("darkest", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout, false);
+   combine(*this, other, result, simd::darkest);
    return result;
 }
 
-Image Image::gammaCorrect(float gamma) const {
-   std::cout << "Gamma correcting with gamma = " << gamma << std::endl;
+Image Image::darkest(const Image& other) && {
+   this->darkestInPlace(other);
+   return std::move(*this);
+}
+
+Image& Image::darkestInPlace(const Image& other) {
+   trace::Scope scope("darkest", this->_width, this->_height);
+   combine(*this, other, *this, simd::darkest);
+   return *this;
+}
+
+Image Image::gammaCorrect(float gamma) const& {
    Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px = result.get(idx);
-      px.r = pow(px.r / 255.0, 1 / gamma) * 255;
-      px.g = pow(px.g / 255.0, 1 / gamma) * 255;
-      px.b = pow(px.b / 255.0, 1 / gamma) * 255;
-      result.set(idx, px);
-   }
+   result.gammaCorrectInPlace(gamma);
    return result;
 }
 
-Image Image::alphaBlend(const Image& other, float alpha) const {
-   std::cout << "Blending with alpha = " << alpha << std::endl;
+Image Image::gammaCorrect(float gamma) && {
+   this->gammaCorrectInPlace(gamma);
+   return std::move(*this);
+}
+
+Image& Image::gammaCorrectInPlace(float gamma) {
+   trace::Scope scope("gammaCorrect", this->_width, this->_height);
+   scope.arg("gamma", gamma);
+   return this->applyInPlace(Lut::gammaCorrect(gamma));
+}
+
+Image Image::alphaBlend(const Image& other, float alpha) const& {
    Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px1 = this->get(idx);
-      Pixel px2 = other.get(idx);
-      px1.r = px1.r * (1 - alpha) + px2.r * alpha;
-      px1.g = px1.g * (1 - alpha) + px2.g * alpha;
-      px1.b = px1.b * (1 - alpha) + px2.b * alpha;
-      result.set(idx, px1);
-   }
+   result.alphaBlendInPlace(other, alpha);
    return result;
 }
 
-Image Image::invert() const {
-   std::cout << "Inverting" << std::endl;
+Image Image::alphaBlend(const Image& other, float alpha) && {
+   this->alphaBlendInPlace(other, alpha);
+   return std::move(*this);
+}
+
+Image& Image::alphaBlendInPlace(const Image& other, float alpha) {
+   trace::Scope scope("alphaBlend", this->_width, this->_height);
+   scope.arg("alpha", alpha);
+   Image converted;
+   const Image* blended = &other;
+   if (other.layout() != this->_layout) {
+      converted = other.toLayout(this->_layout);
+      blended = &converted;
+   }
+   // the blend is the same for every byte, so it runs on planes unchanged
+   pointops::parallelApply(*this, [blended, alpha](unsigned char* data, int first, int n) {
+      pointops::alphaBlend(data, n, *blended, first, alpha);
+   });
+   return *this;
+}
+
+Image Image::apply(const Lut& lut) const& {
    Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px = this->get(idx);
-      px.r = 255 - px.r;
-      px.g = 255 - px.g;
-      px.b = 255 - px.b;
-      result.set(idx, px);
+   result.applyInPlace(lut);
+   return result;
+}
+
+Image Image::apply(const Lut& lut) && {
+   this->applyInPlace(lut);
+   return std::move(*this);
+}
+
+Image& Image::applyInPlace(const Lut& lut) {
+   if (this->_layout == Layout::Planar) {
+      pointops::parallelApplyPlanes(*this, [&lut](unsigned char* r, unsigned char* g, unsigned char* b,
+         int first, int n) {
+         lut.applyPlanes(r, g, b, n);
+      });
+      return *this;
    }
+   pointops::parallelApply(*this, [&lut](unsigned char* data, int first, int n) {
+      lut.apply(data, n);
+   });
+   return *this;
+}
+
+Image Image::invert() const& {
+   Image result(*this);
+   result.invertInPlace();
    return result;
 }
 
-Image Image::grayscale() const {
-   std::cout << "Making grayscale" << std::endl;
+Image Image::invert() && {
+   this->invertInPlace();
+   return std::move(*this);
+}
+
+Image& Image::invertInPlace() {
+   trace::Scope scope("invert", this->_width, this->_height);
+   return this->applyInPlace(Lut::invert());
+}
+
+Image Image::grayscale() const& {
    Image result(*this);
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel px = this->get(idx);
-      float avg = ((0.3 * px.r) + (0.59 * px.g) + (0.11 * px.b)) / 3;
-      px.r = px.g = px.b = avg;
-      result.set(idx, px);
-   }
+   result.grayscaleInPlace();
    return result;
 }
 
-Image Image::colorJitter(int maxSize) const {
-   std::cout << "Jittering colors with max size = " << maxSize << std::endl;
+Image Image::grayscale() && {
+   this->grayscaleInPlace();
+   return std::move(*this);
+}
+
+Image& Image::grayscaleInPlace() {
+   trace::Scope scope("grayscale", this->_width, this->_height);
+   if (this->_layout == Layout::Planar) {
+      pointops::parallelApplyPlanes(*this, [](unsigned char* r, unsigned char* g, unsigned char* b,
+         int first, int n) {
+         pointops::grayscalePlanes(r, g, b, n);
+      });
+      return *this;
+   }
+   pointops::parallelApply(*this, [](unsigned char* data, int first, int n) {
+      pointops::grayscale(data, n);
+   });
+   return *this;
+}
+
+Image Image::colorJitter(int maxSize) const& {
    Image result(*this);
+   result.colorJitterInPlace(maxSize);
+   return result;
+}
+
+Image Image::colorJitter(int maxSize) && {
+   this->colorJitterInPlace(maxSize);
+   return std::move(*this);
+}
+
+Image& Image::colorJitterInPlace(int maxSize) {
+   trace::Scope scope("colorJitter", this->_width, this->_height);
+   scope.arg("maxSize", maxSize);
    int Rjitter, Gjitter, Bjitter, Rsign, Gsign, Bsign;
    for (int idx = 0; idx < this->_width * this->_height; idx++) {
       Pixel px = this->get(idx);
@@ -394,176 +827,248 @@ Image Image::colorJitter(int maxSize) const {
       Bsign = -1 * (rand() % 2); 
       Bjitter = Bsign * (rand() % maxSize);
       px.b = std::max(std::min(px.b + Bjitter, 255), 0);
-      result.set(idx, px);
+      this->set(idx, px);
    }
-   return result;
+   return *this;
 }
 
 Image Image::bitmap(int size) const {
-   Image result(*this);
-   std::cout << "Creating bitmap with size = " << size << std::endl;
-   int numPixels = size * size;
-   for (int i = 0; i < this->_height; i+=size) {
-      for (int j = 0; j < this->_width; j+=size) {
-         int sumRed, sumGreen, sumBlue;
-         sumRed = sumGreen = sumBlue = 0;
-         for (int k = i; k < i + size && k < this->_height; k++) {
-            for (int l = j; l < j + size && l < this->_width; l++) {
-               Pixel px = this->get(k, l);
-               sumRed += px.r;
-               sumGreen += px.g;
-               sumBlue += px.b;
+   if (this->_layout == Layout::Planar) {
+      return this->toLayout(Layout::Interleaved).bitmap(size).toLayout(Layout::Planar);
+   }
+   trace::Scope scope("bitmap", this->_width, this->_height);
+   scope.arg("size", size);
+   if (size <= 1) {
+      return Image(*this);
+   }
+   Image result(this->_width, this->_height, false);
+   int numBlockRows = (this->_height + size - 1) / size;
+   int numBlockCols = (this->_width + size - 1) / size;
+   // blocks on the right and bottom edges are clipped to the image but
+   // still divided by the full block area
+   uint64_t numPixels = (uint64_t) size * size;
+   // blocks don't overlap, so unlike boxBlur no summed-area table is
+   // needed: each row of blocks is summed in one pass, then filled
+   parallelFor(0, numBlockRows, 1, [&](int firstBlock, int lastBlock) {
+      std::vector<uint64_t> sums(numBlockCols * 3);
+      std::vector<unsigned char> colors(numBlockCols * 3);
+      for (int block = firstBlock; block < lastBlock; block++) {
+         int top = block * size;
+         int bottom = std::min(top + size, this->_height);
+         std::fill(sums.begin(), sums.end(), 0);
+         for (int i = top; i < bottom; i++) {
+            const unsigned char* px = this->_data + (size_t) i * this->_width * 3;
+            for (int j = 0; j < this->_width; j++) {
+               uint64_t* sum = &sums[(j / size) * 3];
+               sum[0] += px[j * 3];
+               sum[1] += px[j * 3 + 1];
+               sum[2] += px[j * 3 + 2];
             }
-         } 
-         unsigned char avgRed = sumRed / numPixels;
-         unsigned char avgGreen = sumGreen / numPixels;
-         unsigned char avgBlue = sumBlue / numPixels;
-         for (int k = i; k < i + size; k++) {
-            for (int l = j; l < j + size; l++) {
-               result.set(k, l, {avgRed, avgGreen, avgBlue});
+         }
+         for (size_t k = 0; k < colors.size(); k++) {
+            colors[k] = (unsigned char) (sums[k] / numPixels);
+         }
+         for (int i = top; i < bottom; i++) {
+            unsigned char* out = result.data() + (size_t) i * this->_width * 3;
+            for (int j = 0; j < this->_width; j++) {
+               memcpy(out + j * 3, &colors[(j / size) * 3], 3);
             }
          }
       }
-   }
+   });
    return result;
 }
 
-Image Image::fill(const Pixel& a, const Pixel& b) {
-   std::cout << "Filling color " << (int) a.r << " " << (int) a.g << " " << (int) a.b << " with color " << (int) b.r << " " << (int) b.g << " " << (int) b.b << std::endl;
+Image Image::fill(const Pixel& a, const Pixel& b) const& {
    Image result(*this);
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      int diffR = abs(a.r - px.r);
-      int diffG = abs(a.g - px.g);
-      int diffB = abs(a.b - px.b);
-      if (diffR < 100 && diffG < 100 && diffB < 100) {
-         px.r = b.r;
-         px.g = b.g;
-         px.b = b.b;
-      }
-      result.set(idx, px);
-   }
+   result.fillInPlace(a, b);
    return result;
 }
 
+Image Image::fill(const Pixel& a, const Pixel& b) && {
+   this->fillInPlace(a, b);
+   return std::move(*this);
+}
+
+Image& Image::fillInPlace(const Pixel& a, const Pixel& b) {
+   trace::Scope scope("fill", this->_width, this->_height);
+   scope.arg("from", colorName(a)).arg("to", colorName(b));
+   if (this->_layout == Layout::Planar) {
+      pointops::parallelApplyPlanes(*this, [a, b](unsigned char* red, unsigned char* green,
+         unsigned char* blue, int first, int n) {
+         pointops::fillPlanes(red, green, blue, n, a, b);
+      });
+      return *this;
+   }
+   pointops::parallelApply(*this, [a, b](unsigned char* data, int first, int n) {
+      pointops::fill(data, n, a, b);
+   });
+   return *this;
+}
+
 Image Image::blur(int iters) const {
-   std::cout << "Blurring" << std::endl;
-   Image result(*this);
-   int KERNEL_SIZE = 3;
-   int offset = KERNEL_SIZE / 2;
-   for (int iter = 0; iter < iters; iter++) {
-      for (int i = 0; i < this->_height; i++) {
+   trace::Scope scope("blur", this->_width, this->_height);
+   scope.arg("iterations", iters);
+   if (iters <= 0) {
+      return Image(*this);
+   }
+   Image result(this->_width, this->_height, this->_layout, false);
+   int rowSize = this->_width * 3;
+   size_t planeSize = (size_t) this->_width * this->_height;
+   // every iteration reads this image, so iters > 1 gives the same result
+   // as one; only that pass is run
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      if (this->_layout == Layout::Planar) {
+         for (int c = 0; c < 3; c++) {
+            stencil::box3Plane(this->_data + c * planeSize, 0, result.data() + c * planeSize + firstRow * this->_width,
+               this->_width, this->_height, firstRow, lastRow);
+         }
+         return;
+      }
+      stencil::box3(this->_data, 0, result.data() + firstRow * rowSize,
+         this->_width, this->_height, firstRow, lastRow);
+   });
+   return result;
+}
+
+Image Image::boxBlur(int radius) const {
+   trace::Scope scope("boxBlur", this->_width, this->_height);
+   scope.arg("radius", radius);
+   if (radius <= 0) {
+      return Image(*this);
+   }
+   Image result(this->_width, this->_height, this->_layout, false);
+   IntegralImage sums(*this);
+   // where channel c of pixel 0 goes, and the bytes from one pixel to the next
+   bool planar = this->_layout == Layout::Planar;
+   size_t planeSize = (size_t) this->_width * this->_height;
+   int step = planar ? 1 : 3;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         const uint64_t* above = sums.row(std::max(i - radius, 0));
+         const uint64_t* below = sums.row(std::min(i + radius + 1, this->_height));
+         uint64_t rows = std::min(i + radius + 1, this->_height) - std::max(i - radius, 0);
+         unsigned char* out[3];
+         for (int c = 0; c < 3; c++) {
+            out[c] = result.data() + (planar ? c * planeSize : c) + (size_t) i * this->_width * step;
+         }
          for (int j = 0; j < this->_width; j++) {
-            int sumNeighborsRed, sumNeighborsGreen, sumNeighborsBlue;
-            sumNeighborsRed = sumNeighborsGreen = sumNeighborsBlue = 0;
-            for (int k = i - offset; k <= i + offset; k++) {
-               for (int l = j - offset; l <= j + offset; l++) {
-                  Pixel px;
-                  if (0 <= k && k < this->_height && 0 <= l && l < this->_width) {
-                     px = this->get(k, l);
-                  } else {
-                     px = this->get(i, j);
-                  }
-                  sumNeighborsRed += px.r;
-                  sumNeighborsGreen += px.g;
-                  sumNeighborsBlue += px.b;
-               }
+            int left = std::max(j - radius, 0) * 3;
+            int right = std::min(j + radius + 1, this->_width) * 3;
+            uint64_t count = rows * (uint64_t) (right - left) / 3;
+            double inverse = 1.0 / count;
+            for (int c = 0; c < 3; c++) {
+               uint64_t total = below[right + c] - below[left + c] - above[right + c] + above[left + c];
+               out[c][j * step] = roundedMean(total, count, inverse);
             }
-            unsigned char avgNeighborsRed = sumNeighborsRed / (KERNEL_SIZE * KERNEL_SIZE); 
-            unsigned char avgNeighborsGreen = sumNeighborsGreen / (KERNEL_SIZE * KERNEL_SIZE); 
-            unsigned char avgNeighborsBlue = sumNeighborsBlue / (KERNEL_SIZE * KERNEL_SIZE);
-            result.set(i, j, {avgNeighborsRed, avgNeighborsGreen, avgNeighborsBlue});
          }
       }
-   }
+   });
    return result;
 }
 
-Image Image::blurGaussian() const {
-   std::cout << "Blurring with Gaussian blur" << std::endl;
-   Image result(*this);
-   int KERNEL_SIZE = 17;
-   float STD_DEV = 10.0;
-   float kernel[KERNEL_SIZE][KERNEL_SIZE];
-   int offset = KERNEL_SIZE / 2;
-   float kernelSum = 0.0;
-   // creating Gaussian kernel
-   for (int k = -offset; k <= offset; k++) {
-     for (int l = -offset; l <= offset; l++) {
-         float exponent = -(k * k + l * l) / (2 * STD_DEV * STD_DEV);
-         kernel[k + offset][l + offset] = (1 / (2 * M_PI * STD_DEV * STD_DEV)) * exp(exponent);
-         kernelSum += kernel[k + offset][l + offset];
-     }
-   }
-   // normalizing
-   for (int i = 0; i < KERNEL_SIZE; i++) {
-      for (int j = 0; j < KERNEL_SIZE; j++) {
-         kernel[i][j] /= kernelSum;
+IntegralImage Image::integral() const {
+   return IntegralImage(*this);
+}
+
+Image Image::blurGaussian(float sigma, const std::string& method) const {
+   trace::Scope scope("blurGaussian", this->_width, this->_height);
+   scope.arg("sigma", sigma).arg("method", method);
+   if (method != "auto" && method != "separable" && method != "recursive") {
+      std::cerr << "Invalid method argument!" << std::endl;
+      exit(1);
+   }
+   if (sigma <= 0.0f) {
+      return Image(*this);
+   }
+   Image result(this->_width, this->_height, this->_layout, false);
+   // the recursive filter costs the same for any sigma but is only
+   // accurate from 0.5 up; small kernels are cheaper to apply directly
+   bool recursive = method == "recursive" || (method == "auto" && sigma > 2.0f);
+   auto gaussian = recursive && sigma >= 0.5f ? blur::gaussianRecursive : blur::gaussianSeparable;
+   if (this->_layout == Layout::Planar) {
+      size_t planeSize = (size_t) this->_width * this->_height;
+      for (int c = 0; c < 3; c++) {
+         gaussian(this->_data + c * planeSize, result.data() + c * planeSize, this->_width, this->_height, sigma, 1);
       }
+   } else {
+      gaussian(this->_data, result.data(), this->_width, this->_height, sigma, 3);
    }
+   return result;
+}
 
-   int ITERS = 3;
-   for (int iter = 0; iter < ITERS; iter++) {
-      for (int i = 0; i < result.height(); i++) {
-         for (int j = 0; j < result.width(); j++) {
-            float avgNeighborsRed, avgNeighborsGreen, avgNeighborsBlue;
-            avgNeighborsRed = avgNeighborsGreen = avgNeighborsBlue = 0;
-            for (int k = i - offset; k <= i + offset; k++) {
-               for (int l = j - offset; l <= j + offset; l++) {
-                  Pixel px;
-                  if (0 <= k && k < result.height() && 0 <= l && l < result.width()) {
-                     px = result.get(k, l);
-                  } else {
-                     px = result.get(i, j);
-                  }
-                  avgNeighborsRed += px.r * kernel[k - (i - offset)][l - (j - offset)];
-                  avgNeighborsGreen += px.g * kernel[k - (i - offset)][l - (j - offset)];
-                  avgNeighborsBlue += px.b * kernel[k - (i - offset)][l - (j - offset)];
-               }
-            }
-            result.set(i, j, {(unsigned char) avgNeighborsRed, (unsigned char) avgNeighborsGreen, (unsigned char) avgNeighborsBlue});
-         }
-      }
+Image Image::convolve(const std::vector<float>& kernel, int kernelWidth, int kernelHeight,
+   const std::string& method, Border border) const {
+   trace::Scope scope("convolve", this->_width, this->_height);
+   scope.arg("kernel", std::to_string(kernelWidth) + "x" + std::to_string(kernelHeight))
+      .arg("method", method).arg("border", convolution::borderName(border));
+   if (method != "auto" && method != "direct" && method != "fft") {
+      std::cerr << "Invalid method argument!" << std::endl;
+      exit(1);
+   }
+   if (kernelWidth <= 0 || kernelHeight <= 0 || kernel.size() != (size_t) kernelWidth * kernelHeight) {
+      std::cerr << "Invalid kernel argument!" << std::endl;
+      exit(1);
+   }
+   // direct skips zero weights, while the transforms cost about the same
+   // for any kernel that fits a tile, so they win once enough are nonzero
+   int taps = (int) std::count_if(kernel.begin(), kernel.end(), [](float weight) { return weight != 0.0f; });
+   bool spectral = method == "fft" || (method == "auto" &&
+      convolution::preferSpectral(this->_width, this->_height, kernelWidth, kernelHeight, taps));
+   scope.arg("path", spectral ? "fft" : "direct");
+   auto apply = spectral ? convolution::spectral : convolution::direct;
+   Image result(this->_width, this->_height, this->_layout, false);
+   // where channel c of pixel 0 is, and the bytes from one pixel to the next
+   bool planar = this->_layout == Layout::Planar;
+   size_t planeSize = (size_t) this->_width * this->_height;
+   int step = planar ? 1 : 3;
+   for (int c = 0; c < 3; c++) {
+      size_t offset = planar ? c * planeSize : c;
+      apply(this->_data + offset, result.data() + offset, this->_width, this->_height, step,
+         kernel.data(), kernelWidth, kernelHeight, border, 0);
    }
    return result;
 }
 
 Image Image::glow() const {
-   std::cout << "Applying glow effect" << std::endl;
-   Image extractedWhite(*this);
+   trace::Scope scope("glow", this->_width, this->_height);
+   Image extractedWhite(this->_width, this->_height, false);
    Image white(this->_width, this->_height);
    Image result(*this);
    float threshold = 0.7;
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      unsigned char c = px.r * 0.3f + px.g * 0.59f + px.b * 0.11f;
-      float intensity = c / 255.0f;
-      if (intensity > threshold) { 
-         extractedWhite.set(idx, {255, 255, 255});
-      } else {
-         extractedWhite.set(idx, {0, 0, 0});
+   parallelFor(0, this->_width * this->_height, BLOCK_PIXELS, [&](int first, int last) {
+      for (int idx = first; idx < last; idx++) {
+         Pixel px = this->get(idx);
+         unsigned char c = px.r * 0.3f + px.g * 0.59f + px.b * 0.11f;
+         float intensity = c / 255.0f;
+         if (intensity > threshold) { 
+            extractedWhite.set(idx, {255, 255, 255});
+         } else {
+            extractedWhite.set(idx, {0, 0, 0});
+         }
+         white.set(idx, {255, 255, 255});
       }
-      white.set(idx, {255, 255, 255});
-   }
-   extractedWhite.save("../demo/white-extractedWhite.png");
+   });
    Image whiteBlurred = extractedWhite.blurGaussian();
-   whiteBlurred.save("../demo/white-blur.png");
-   for (int idx = 0; idx < result.width() * result.height(); idx++) {
-      Pixel alphaPx = whiteBlurred.get(idx);
-      unsigned char c = alphaPx.r * 0.3f + alphaPx.g * 0.59f + alphaPx.b * 0.11f;
-      float alpha = c / 255.0f;
-      Pixel px1 = this->get(idx);
-      Pixel px2 = white.get(idx);
-      px1.r = px1.r * (1 - alpha) + px2.r * alpha;
-      px1.g = px1.g * (1 - alpha) + px2.g * alpha;
-      px1.b = px1.b * (1 - alpha) + px2.b * alpha;
-      result.set(idx, px1);
-   }
+   parallelFor(0, result.width() * result.height(), BLOCK_PIXELS, [&](int first, int last) {
+      for (int idx = first; idx < last; idx++) {
+         Pixel alphaPx = whiteBlurred.get(idx);
+         unsigned char c = alphaPx.r * 0.3f + alphaPx.g * 0.59f + alphaPx.b * 0.11f;
+         float alpha = c / 255.0f;
+         Pixel px1 = this->get(idx);
+         Pixel px2 = white.get(idx);
+         px1.r = px1.r * (1 - alpha) + px2.r * alpha;
+         px1.g = px1.g * (1 - alpha) + px2.g * alpha;
+         px1.b = px1.b * (1 - alpha) + px2.b * alpha;
+         result.set(idx, px1);
+      }
+   });
    return result;
 }
 
 Image Image::border(const Pixel& c) const {
-   std::cout << "Drawing borders with color " << (int) c.r << " " << (int) c.g << " " << (int) c.b << std::endl;
+   trace::Scope scope("border", this->_width, this->_height);
+   scope.arg("color", colorName(c));
    Image result(*this);
    // top and bottom
    for (int j = 0; j < result.width(); j++) {
@@ -579,157 +1084,174 @@ Image Image::border(const Pixel& c) const {
 }
 
 Image Image::sobel() const {
-   std::cout << "Applying sobel operator" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      int avg = (px.r + px.g + px.b) / 3;
-      px.r = px.g = px.b = avg;
-      result.set(idx, px);
-   }
-   int Gx[3][3] = {{1, 0, -1}, {2, 0, -2}, {1, 0, -1}};
-   int Gy[3][3] = {{1, 2, 1}, {0, 0, 0}, {-1, -2, -1}};
-   for (int i = 0; i < this->_height; i++) {
-      for (int j = 0; j < this->_width; j++) {
-         int sumNeighborsRedX, sumNeighborsGreenX, sumNeighborsBlueX, sumNeighborsRedY, sumNeighborsGreenY, sumNeighborsBlueY;
-         sumNeighborsRedX = sumNeighborsGreenX = sumNeighborsBlueX = sumNeighborsRedY = sumNeighborsGreenY = sumNeighborsBlueY = 0;
-         for (int k = i - 1; k <= i + 1; k++) {
-            if (0 <= k && k < this->_height) {
-               for (int l = j - 1; l <= j + 1; l++) {
-                  if (0 <= l && l < this->_width) {
-                     Pixel px = this->get(k, l);
-                     sumNeighborsRedX += px.r * Gx[k - (i - 1)][l - (j - 1)];
-                     sumNeighborsGreenX += px.g * Gx[k - (i - 1)][l - (j - 1)];
-                     sumNeighborsBlueX += px.b * Gx[k - (i - 1)][l - (j - 1)];
-                     sumNeighborsRedY += px.r * Gy[k - (i - 1)][l - (j - 1)];
-                     sumNeighborsGreenY += px.g * Gy[k - (i - 1)][l - (j - 1)];
-                     sumNeighborsBlueY += px.b * Gy[k - (i - 1)][l - (j - 1)];
-                  } 
-               }
-            }
+   return this->sobel("exact");
+}
+
+Image Image::sobel(const std::string& magnitude, std::vector<float>* direction) const {
+   if (magnitude != "exact" && magnitude != "fast") {
+      std::cerr << "Invalid magnitude argument!" << std::endl;
+      exit(1);
+   }
+   // the direction compares channels of one pixel, so it needs them together
+   if (this->_layout == Layout::Planar && direction) {
+      return this->toLayout(Layout::Interleaved).sobel(magnitude, direction).toLayout(Layout::Planar);
+   }
+   trace::Scope scope("sobel", this->_width, this->_height);
+   scope.arg("magnitude", magnitude);
+   bool fast = magnitude == "fast";
+   Image result(this->_width, this->_height, this->_layout, false);
+   if (direction) {
+      direction->resize((size_t) this->_width * this->_height);
+   }
+   int rowSize = this->_width * 3;
+   size_t planeSize = (size_t) this->_width * this->_height;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      if (this->_layout == Layout::Planar) {
+         for (int c = 0; c < 3; c++) {
+            (fast ? stencil::sobelFastPlane : stencil::sobelPlane)(this->_data + c * planeSize, 0,
+               result.data() + c * planeSize + firstRow * this->_width, this->_width, this->_height, firstRow, lastRow);
          }
-         unsigned char GRed = std::min((int) sqrt(pow(sumNeighborsRedX, 2) + pow(sumNeighborsRedY, 2)), 255);
-         unsigned char GGreen = std::min((int) sqrt(pow(sumNeighborsGreenX, 2) + pow(sumNeighborsGreenY, 2)), 255);
-         unsigned char GBlue = std::min((int) sqrt(pow(sumNeighborsBlueX, 2) + pow(sumNeighborsBlueY, 2)), 255);
-         result.set(i, j, {GRed, GGreen, GBlue});
+         return;
       }
-   }
+      (fast ? stencil::sobelFast : stencil::sobel)(this->_data, 0,
+         result.data() + firstRow * rowSize, this->_width, this->_height, firstRow, lastRow);
+      if (direction) {
+         stencil::sobelDirection(this->_data, 0, direction->data() + (size_t) firstRow * this->_width,
+            this->_width, this->_height, firstRow, lastRow);
+      }
+   });
    return result;
 }
 
 Image Image::glitch() const {
-   std::cout << "Applying glitch effect" << std::endl;
-   Image result(this->_width, this->_height);
+   trace::Scope scope("glitch", this->_width, this->_height);
+   Image result(this->_width, this->_height, this->_layout);
    int offset = this->_width / 10;
-   for (int i = 0; i < this->_height; i++) {
-      for (int j = 0; j < this->_width; j++) {
-         int newJ = j + (pow(-1, i % 2) * offset);
-         if (newJ >= 0 && newJ < this->_width) {
-            result.set(i, newJ, this->get(i, j));
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int j = 0; j < this->_width; j++) {
+            int newJ = j + (pow(-1, i % 2) * offset);
+            if (newJ >= 0 && newJ < this->_width) {
+               result.set(i, newJ, this->get(i, j));
+            }
          }
       }
-   }
+   });
    return result;
 }
 
 Image Image::painterly() const {
-   std::cout << "Applying painterly effect" << std::endl;
-  return (((this->blur()).sobel()).alphaBlend(*this, 0.2)).brighten(20);
+   trace::Scope scope("painterly", this->_width, this->_height);
+   // the blend and brighten steps are fused into one pass over the edges;
+   // both work on each byte alone, so planar images run them in place
+   Image edges = (this->blur()).sobel();
+   if (this->_layout == Layout::Planar) {
+      return std::move(edges.alphaBlendInPlace(*this, 0.2).brightenInPlace(20));
+   }
+   return Pipeline(edges).alphaBlend(*this, 0.2).brighten(20).run();
 }
 
 Image Image::distort(const std::string& orientation) const {
-   std::cout << "Applying " << orientation << " distortion effect" << std::endl;
+   trace::Scope scope("distort", this->_width, this->_height);
+   scope.arg("orientation", orientation);
    Image result(*this);
    if (orientation != "vertical" && orientation != "horizontal") {
       std::cerr << "Invalid orientation argument!" << std::endl;
       exit(1);
    }
-   for (int i = 0; i < this->_height; i++) {
-      for (int j = 0; j < this->_width; j++) {
-         int newI = i; int newJ = j;
-         if (orientation == "vertical") {
-            newI = (i + (int)(sin(((float) j / this->_width) * 8 * M_PI) * 20) + this->_height) % this->_height;
-         } else if (orientation == "horizontal") {
-            newJ = (j + (int)(cos(((float) i / this->_height) * 8 * M_PI) * 20) + this->_width) % this->_width;
-         } 
-         result.set(newI, newJ, this->get(i, j));
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int j = 0; j < this->_width; j++) {
+            int newI = i; int newJ = j;
+            if (orientation == "vertical") {
+               newI = (i + (int)(sin(((float) j / this->_width) * 8 * M_PI) * 20) + this->_height) % this->_height;
+            } else if (orientation == "horizontal") {
+               newJ = (j + (int)(cos(((float) i / this->_height) * 8 * M_PI) * 20) + this->_width) % this->_width;
+            } 
+            result.set(newI, newJ, this->get(i, j));
+         }
       }
-   }
+   });
    return result;
 }
 
 Image Image::gradient(const std::string& orientation, const Pixel& px) const {
-   std::cout << "Applying " << orientation << " color gradient with color " << (int) px.r << " " << (int) px.g << " " << (int) px.b << std::endl;
-   Image filter(*this);
+   trace::Scope scope("gradient", this->_width, this->_height);
+   scope.arg("orientation", orientation).arg("color", colorName(px));
+   Image filter(this->_width, this->_height, this->_layout, false);
    if (orientation != "vertical" && orientation != "horizontal") {
       std::cerr << "Invalid orientation argument!" << std::endl;
       exit(1);
    }
-   float progress;
-   for (int i = 0; i < this->_height; i++) {
-      if (orientation == "vertical") {
-         progress = (float) i / this->_height;
-      }
-      for (int j = 0; j < this->_width; j++) {
-         if (orientation == "horizontal") {
-            progress = (float) j / this->_width;
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      float progress;
+      for (int i = firstRow; i < lastRow; i++) {
+         if (orientation == "vertical") {
+            progress = (float) i / this->_height;
+         }
+         for (int j = 0; j < this->_width; j++) {
+            if (orientation == "horizontal") {
+               progress = (float) j / this->_width;
+            }
+            unsigned char r = (unsigned char) (px.r * progress);
+            unsigned char g = (unsigned char) (px.g * progress);
+            unsigned char b = (unsigned char) (px.b * progress);
+            filter.set(i, j, {r, g, b});
          }
-         unsigned char r = (unsigned char) (px.r * progress);
-         unsigned char g = (unsigned char) (px.g * progress);
-         unsigned char b = (unsigned char) (px.b * progress);
-         filter.set(i, j, {r, g, b});
       }
-   }
+   });
    return this->alphaBlend(filter, 0.5);
 }
 
 Image Image::sharpen() const {
-   std::cout << "Sharpening" << std::endl;
-   return this->add(this->subtract(this->blur()));
+   trace::Scope scope("sharpen", this->_width, this->_height);
+   // this + (this - blur), adding in place into the difference image
+   Image result = this->subtract(this->blur());
+   result.addInPlace(*this);
+   return result;
 }
 
-Image Image::brighten(int percentage) const {
-   std::cout << "Brightening by " << percentage << " percent" << std::endl;
+Image Image::brighten(int percentage) const& {
    Image result(*this);
-   float factor = (100.0f + percentage) / 100.0f;
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      px.r = std::min((int) (px.r * factor), 255);
-      px.g = std::min((int) (px.g * factor), 255);
-      px.b = std::min((int) (px.b * factor), 255);
-      result.set(idx, px);
-   }
+   result.brightenInPlace(percentage);
    return result;
 }
 
-Image Image::dim(int percentage) const {
-   std::cout << "Dimming by " << percentage << " percent" << std::endl;
+Image Image::brighten(int percentage) && {
+   this->brightenInPlace(percentage);
+   return std::move(*this);
+}
+
+Image& Image::brightenInPlace(int percentage) {
+   trace::Scope scope("brighten", this->_width, this->_height);
+   scope.arg("percentage", percentage);
+   return this->applyInPlace(Lut::brighten(percentage));
+}
+
+Image Image::dim(int percentage) const& {
    Image result(*this);
-   float factor = (100.0f - percentage) / 100.0f;
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      px.r = (int) (px.r * factor);
-      px.g = (int) (px.g  * factor);
-      px.b = (int) (px.b  * factor);
-      result.set(idx, px);
-   }
+   result.dimInPlace(percentage);
    return result;
 }
 
+Image Image::dim(int percentage) && {
+   this->dimInPlace(percentage);
+   return std::move(*this);
+}
+
+Image& Image::dimInPlace(int percentage) {
+   trace::Scope scope("dim", this->_width, this->_height);
+   scope.arg("percentage", percentage);
+   return this->applyInPlace(Lut::dim(percentage));
+}
+
 Image Image::deepFry() const {
-   std::cout << "Applying deep fried effect" << std::endl;
-   Image result(*this);
-   for (int idx = 0; idx < this->_width * this->_height; idx++) {
-      Pixel px = this->get(idx);
-      px.r = std::min(px.r * 2, 255);
-      px.r = (int) (pow(px.r / 255.0, 15) * 255);
-      px.g = std::min(px.g * 2, 255);
-      px.g = (int) (pow(px.g / 255.0, 15) * 255);
-      px.b = std::min(px.b * 2, 255);
-      px.b = (int) (pow(px.b / 255.0, 15) * 255);
-      result.set(idx, px);
-   }
-   return result.sharpen().colorJitter(100);
+   trace::Scope scope("deepFry", this->_width, this->_height);
+   Lut saturate = Lut::fromFunction([](unsigned char x) -> unsigned char {
+      int doubled = std::min(x * 2, 255);
+      return (int) (pow(doubled / 255.0, 15) * 255);
+   });
+   return this->apply(saturate).sharpen().colorJitter(100);
 }
 
 }  // namespace agl
@@ -16,6 +16,10 @@
 
 namespace agl {
 
+class IntegralImage;
+class Lut;
+class MappedFile;
+
 /**
  * @brief Holder for a RGB color
  */
@@ -25,15 +29,53 @@ struct Pixel {
     unsigned char b;
 };
 
+/**
+ * @brief How an Image stores its pixels
+ *
+ * Interleaved images store r, g, b for each pixel in turn. Planar images
+ * store every red value, then every green value, then every blue value,
+ * so kernels that treat the channels alike see contiguous bytes of one
+ * channel. Operators without a planar implementation convert to
+ * interleaved and back.
+ */
+enum class Layout {
+  Interleaved,
+  Planar
+};
+
+/**
+ * @brief What a convolution reads for pixels outside the image, shown
+ * for a row abcd
+ */
+enum class Border {
+  Clamp,     // aa|abcd|dd, repeat the edge pixel
+  Mirror,    // cb|abcd|cb, reflect about the edge pixel
+  Wrap,      // cd|abcd|ab, continue from the opposite edge
+  Constant   // a fixed value for every channel
+};
+
 /**
  * @brief Implements loading, modifying, and saving RGB images
  */
 class Image {
  public:
   Image();
-  Image(int width, int height);
+
+  /**
+   * @brief Create a width by height image
+   * @param zero Whether to clear the pixels to black; operators that
+   * overwrite every pixel pass false to skip the clearing
+   */
+  Image(int width, int height, bool zero = true);
+
+  /**
+   * @brief Create a width by height image stored in the given layout
+   */
+  Image(int width, int height, Layout layout, bool zero = true);
   Image(const Image& orig);
+  Image(Image&& orig) noexcept;
   Image& operator=(const Image& orig);
+  Image& operator=(Image&& orig) noexcept;
   friend std::ostream& operator<<(std::ostream& os, const Image& image);
 
   virtual ~Image();
@@ -42,13 +84,21 @@ class Image {
    * @brief Load the given filename 
    * @param filename The file to load, relative to the running directory
    * @param flip Whether the file should flipped vertally when loaded
+   *
+   * Binary .ppm and .pam files are mapped into memory and used in place
+   * without copying; pages are copied by the OS only when modified, and
+   * the file itself is never changed. A planar image stays planar, and
+   * converts the decoded pixels.
    * 
    * @verbinclude sprites.cpp
    */
   bool load(const std::string& filename, bool flip = false);
 
   /** 
-   * @brief Save the image to the given filename (.png)
+   * @brief Save the image to the given filename: .png (compressed in
+   * parallel at png::level()), lossless and fast .qoi, or uncompressed
+   * binary .ppm or .pam, written through a memory mapping. Files are
+   * always interleaved, so a planar image is converted first.
    * @param filename The file to load, relative to the running directory
    * @param flip Whether the file should flipped vertally before being saved
    */
@@ -65,17 +115,30 @@ class Image {
   /** 
    * @brief Return the RGB data
    *
-   * Data will have size width * height * 4 (RGB)
+   * Data will have size width * height * 3 (RGB), interleaved or as three
+   * planes depending on layout()
    */
   unsigned char* data() const;
 
+  /** @brief Return how the pixels are stored
+   */
+  Layout layout() const;
+
+  // Convert the pixels to the given layout; converting to the current
+  // layout is a copy (or nothing, in place)
+  Image toLayout(Layout layout) const&;
+  Image toLayout(Layout layout) &&;
+  Image& toLayoutInPlace(Layout layout);
+
   /**
    * @brief Replace image RGB data
    * @param width The new image width
    * @param height The new image height
    *
    * This call will replace the old data with the new data. Data should 
-   * match the size width * height * 3
+   * match the size width * height * 3, in this image's layout. The image
+   * takes ownership of data, which must have been allocated with malloc,
+   * and frees the old data.
    */
   void set(int width, int height, unsigned char* data);
 
@@ -114,14 +177,24 @@ class Image {
   void set(int i, const Pixel& c);
 
 
-  // resize the image
-  Image resize(int width, int height) const;
+  // Operators return a new image and leave this one unchanged. Those with
+  // an *InPlace variant modify this image instead, and when called on a
+  // temporary (e.g. image.blur().invert()) they reuse its pixels rather
+  // than copying them.
+
+  // resize the image with a filter from resample.h: "auto", "nearest",
+  // "area", "bilinear", "bicubic" or "lanczos"
+  Image resize(int width, int height, const std::string& filter = "auto") const;
 
   // flip around the horizontal midline
-  Image flipHorizontal() const;
+  Image flipHorizontal() const&;
+  Image flipHorizontal() &&;
+  Image& flipHorizontalInPlace();
 
   // flip around the vertical midline
-  Image flipVertical() const;
+  Image flipVertical() const&;
+  Image flipVertical() &&;
+  Image& flipVerticalInPlace();
 
   // rotate the Image 90 degrees
   Image rotate90() const;
@@ -134,73 +207,127 @@ class Image {
   void replace(const Image& image, int x, int y);
 
   // swirl the colors 
-  Image swirl() const;
+  Image swirl() const&;
+  Image swirl() &&;
+  Image& swirlInPlace();
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = this.pixel + other.pixel
   // Assumes that the two images are the same size
-  Image add(const Image& other) const;
+  Image add(const Image& other) const&;
+  Image add(const Image& other) &&;
+  Image& addInPlace(const Image& other);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = this.pixel - other.pixel
   // Assumes that the two images are the same size
-  Image subtract(const Image& other) const;
+  Image subtract(const Image& other) const&;
+  Image subtract(const Image& other) &&;
+  Image& subtractInPlace(const Image& other);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = this.pixel * other.pixel
   // Assumes that the two images are the same size
-  Image multiply(const Image& other) const;
+  Image multiply(const Image& other) const&;
+  Image multiply(const Image& other) &&;
+  Image& multiplyInPlace(const Image& other);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = abs(this.pixel - other.pixel)
   // Assumes that the two images are the same size
-  Image difference(const Image& other) const;
+  Image difference(const Image& other) const&;
+  Image difference(const Image& other) &&;
+  Image& differenceInPlace(const Image& other);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = max(this.pixel, other.pixel)
   // Assumes that the two images are the same size
-  Image lightest(const Image& other) const;
+  Image lightest(const Image& other) const&;
+  Image lightest(const Image& other) &&;
+  Image& lightestInPlace(const Image& other);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    result.pixel = min(this.pixel, other.pixel)
   // Assumes that the two images are the same size
-  Image darkest(const Image& other) const;
+  Image darkest(const Image& other) const&;
+  Image darkest(const Image& other) &&;
+  Image& darkestInPlace(const Image& other);
 
   // Apply gamma correction
-  Image gammaCorrect(float gamma) const;
+  Image gammaCorrect(float gamma) const&;
+  Image gammaCorrect(float gamma) &&;
+  Image& gammaCorrectInPlace(float gamma);
 
   // Apply the following calculation to the pixels in 
   // our image and the given image:
   //    this.pixels = this.pixels * (1-alpha) + other.pixel * alpha
   // Assumes that the two images are the same size
-  Image alphaBlend(const Image& other, float amount) const;
+  Image alphaBlend(const Image& other, float amount) const&;
+  Image alphaBlend(const Image& other, float amount) &&;
+  Image& alphaBlendInPlace(const Image& other, float amount);
+
+  // Map each channel value through the given lookup table
+  Image apply(const Lut& lut) const&;
+  Image apply(const Lut& lut) &&;
+  Image& applyInPlace(const Lut& lut);
 
   // Replace each pixel value "x" with 255-x
-  Image invert() const;
+  Image invert() const&;
+  Image invert() &&;
+  Image& invertInPlace();
 
   // Convert the image to grayscale
-  Image grayscale() const;
+  Image grayscale() const&;
+  Image grayscale() &&;
+  Image& grayscaleInPlace();
 
   // Randomly tweak pixel values with tweak value < maxSize
-  Image colorJitter(int maxSize) const;
+  Image colorJitter(int maxSize) const&;
+  Image colorJitter(int maxSize) &&;
+  Image& colorJitterInPlace(int maxSize);
 
   // return a bitmap version of this image
   Image bitmap(int size) const;
 
   // Fill pixels of certain color with another color
-  Image fill(const Pixel& a, const Pixel& b);
+  Image fill(const Pixel& a, const Pixel& b) const&;
+  Image fill(const Pixel& a, const Pixel& b) &&;
+  Image& fillInPlace(const Pixel& a, const Pixel& b);
 
   // Apply simple box blur to image 
   Image blur(int iters = 1) const;
 
-  // Apply gaussian blur to image 
-  Image blurGaussian() const;
+  // Average each pixel over the (2 * radius + 1) square around it, clipped
+  // to the image; the cost per pixel does not depend on radius
+  Image boxBlur(int radius) const;
+
+  // Build the summed-area table of this image (see integral.h)
+  IntegralImage integral() const;
+
+  // Apply gaussian blur with standard deviation sigma (in pixels). The 
+  // method is "separable" (two 1D kernel passes), "recursive" (IIR filter 
+  // whose cost does not depend on sigma) or "auto" to pick by sigma
+  Image blurGaussian(float sigma = 8.0f, const std::string& method = "auto") const;
+
+  /**
+   * @brief Convolve each channel with a kernel of any size, such as a
+   * bokeh disk
+   *
+   * kernel holds kernelWidth * kernelHeight weights row by row, used as
+   * given, so they should sum to 1 to keep brightness; its center, (
+   * kernelWidth / 2, kernelHeight / 2), sits on each pixel. The method is
+   * "direct" (sum every tap), "fft" (multiply transforms of tiles,
+   * possibly 1 off direct) or "auto" to pick the faster for the size.
+   * Border::Constant reads black.
+   */
+  Image convolve(const std::vector<float>& kernel, int kernelWidth, int kernelHeight,
+    const std::string& method = "auto", Border border = Border::Clamp) const;
 
   // Apply glowing texture to image
   Image glow() const;
@@ -211,6 +338,11 @@ class Image {
   // Accentuate edges in image
   Image sobel() const;
 
+  // Sobel edges with the "exact" magnitude sqrt(gx^2 + gy^2) or the "fast"
+  // |gx| + |gy|. If direction is not null, it receives width * height
+  // gradient directions in radians (see stencil::sobelDirection)
+  Image sobel(const std::string& magnitude, std::vector<float>* direction = NULL) const;
+
   // Generate corrupted version of image
   Image glitch() const;
 
@@ -227,21 +359,39 @@ class Image {
   Image sharpen() const;
 
   // Increase all pixel values by fixed percentage
-  Image brighten(int percentage) const;
+  Image brighten(int percentage) const&;
+  Image brighten(int percentage) &&;
+  Image& brightenInPlace(int percentage);
 
   // Decrease all pixel values by fixed percentage
-  Image dim(int percentage) const;
+  Image dim(int percentage) const&;
+  Image dim(int percentage) &&;
+  Image& dimInPlace(int percentage);
 
   // Apply excessive saturation, sharpening, and grainy texture
   Image deepFry() const;
 
  private:
+   // return the pixel buffer to the pool, or unmap it if it was loaded
+   // from a mapped file
+   void releaseData();
+
+   // decode a file into interleaved pixels for load()
+   bool decode(const std::string& filename, bool flip);
+
+   // map a .ppm or .pam file for load()
+   bool loadMapped(const std::string& filename);
+
    // char array for storing pixel data
    unsigned char* _data;
+   // file _data points into, or NULL if _data is from the buffer pool
+   MappedFile* _mapped;
    // number of pixels in the image's x dimension
    int _width;
    // number of pixels in the image's y dimension
    int _height;
+   // interleaved or planar
+   Layout _layout;
 };
 }  // namespace agl
 #endif  // AGL_IMAGE_H_
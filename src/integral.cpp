@@ -0,0 +1,88 @@
+/**
+ * Implementation of the summed-area table
+ *
+ * @file integral.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "integral.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "bufferpool.h"
+#include "threadpool.h"
+
+namespace agl {
+
+// columns of sums per task in the vertical pass
+static const int COLUMN_BLOCK = 1024;
+
+IntegralImage::IntegralImage(const Image& image) {
+   this->_width = image.width();
+   this->_height = image.height();
+   size_t stride = (size_t) (this->_width + 1) * 3;
+   size_t bytes = stride * (this->_height + 1) * sizeof(uint64_t);
+   // pool buffers come from malloc, so they are aligned for uint64_t
+   this->_sums = std::unique_ptr<uint64_t[], Release>(
+      (uint64_t*) BufferPool::shared().acquire(bytes, false), Release{bytes});
+   uint64_t* sums = this->_sums.get();
+   memset(sums, 0, stride * sizeof(uint64_t));
+   // red, green and blue of pixel 0, and the bytes from one pixel to the next
+   bool planar = image.layout() == Layout::Planar;
+   size_t planeSize = (size_t) this->_width * this->_height;
+   const unsigned char* channels[3] = {image.data(), image.data() + (planar ? planeSize : 1),
+      image.data() + (planar ? 2 * planeSize : 2)};
+   int step = planar ? 1 : 3;
+
+   // running sums along each row, independent per row
+   parallelRows(this->_height, this->_width, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         size_t offset = (size_t) i * this->_width * step;
+         const unsigned char* red = channels[0] + offset;
+         const unsigned char* green = channels[1] + offset;
+         const unsigned char* blue = channels[2] + offset;
+         uint64_t* out = sums + (i + 1) * stride;
+         uint64_t r = 0, g = 0, b = 0;
+         out[0] = out[1] = out[2] = 0;
+         for (int j = 0; j < this->_width; j++) {
+            r += red[j * step];
+            g += green[j * step];
+            b += blue[j * step];
+            out[(j + 1) * 3] = r;
+            out[(j + 1) * 3 + 1] = g;
+            out[(j + 1) * 3 + 2] = b;
+         }
+      }
+   });
+
+   // then down each column; a task takes a block of columns through every
+   // row, so it reads both rows sequentially
+   int numColumns = (int) stride;
+   parallelFor(0, (numColumns + COLUMN_BLOCK - 1) / COLUMN_BLOCK, 1, [&](int firstBlock, int lastBlock) {
+      int first = firstBlock * COLUMN_BLOCK;
+      int last = std::min(lastBlock * COLUMN_BLOCK, numColumns);
+      for (int i = 2; i <= this->_height; i++) {
+         const uint64_t* above = sums + (i - 1) * stride;
+         uint64_t* out = sums + i * stride;
+         for (int k = first; k < last; k++) {
+            out[k] += above[k];
+         }
+      }
+   });
+}
+
+void IntegralImage::Release::operator()(uint64_t* sums) const {
+   BufferPool::shared().release((unsigned char*) sums, this->bytes);
+}
+
+int IntegralImage::width() const {
+   return this->_width;
+}
+
+int IntegralImage::height() const {
+   return this->_height;
+}
+
+}  // namespace agl
@@ -0,0 +1,70 @@
+/**
+ * Summed-area table of an image, for sums over any rectangle in constant
+ * time
+ *
+ * @file integral.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_INTEGRAL_H_
+#define AGL_INTEGRAL_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "image.h"
+
+namespace agl {
+
+/**
+ * @brief Per channel sums of all pixels above and to the left of each
+ * position
+ *
+ * Entry (i, j) holds the sums over rows [0, i) and columns [0, j), so a
+ * rectangle's sum is four lookups whatever its size. Sums are 64 bits,
+ * so they cannot overflow for any image that fits in memory; the table
+ * takes 24 bytes per pixel, from the BufferPool.
+ */
+class IntegralImage {
+ public:
+  explicit IntegralImage(const Image& image);
+
+  int width() const;
+  int height() const;
+
+  /**
+   * @brief Return the width + 1 entries of row i, from 0 to height, as
+   * r, g, b sums per entry
+   */
+  const uint64_t* row(int i) const {
+     return this->_sums.get() + (size_t) i * (this->_width + 1) * 3;
+  }
+
+  /**
+   * @brief Add up each channel over rows [top, bottom) and columns
+   * [left, right), which must lie within the image
+   */
+  void sum(int top, int left, int bottom, int right, uint64_t sums[3]) const {
+     const uint64_t* above = this->row(top);
+     const uint64_t* below = this->row(bottom);
+     for (int c = 0; c < 3; c++) {
+        sums[c] = below[right * 3 + c] - below[left * 3 + c] -
+           above[right * 3 + c] + above[left * 3 + c];
+     }
+  }
+
+ private:
+  // returns the table to the pool
+  struct Release {
+    size_t bytes;
+    void operator()(uint64_t* sums) const;
+  };
+
+  int _width;
+  int _height;
+  // (height + 1) * (width + 1) * 3 sums; row 0 and column 0 are zero
+  std::unique_ptr<uint64_t[], Release> _sums;
+};
+}  // namespace agl
+#endif  // AGL_INTEGRAL_H_
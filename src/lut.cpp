@@ -0,0 +1,96 @@
+/**
+ * Implementation of the per-channel lookup tables
+ *
+ * @file lut.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "lut.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace agl {
+
+Lut::Lut() {
+   for (int x = 0; x < 256; x++) {
+      this->_table[0][x] = this->_table[1][x] = this->_table[2][x] = x;
+   }
+}
+
+Lut Lut::fromFunction(const std::function<unsigned char(unsigned char)>& fn) {
+   Lut lut;
+   for (int x = 0; x < 256; x++) {
+      lut._table[0][x] = lut._table[1][x] = lut._table[2][x] = fn(x);
+   }
+   return lut;
+}
+
+Lut Lut::gammaCorrect(float gamma) {
+   return Lut::fromFunction([gamma](unsigned char x) -> unsigned char {
+      return pow(x / 255.0, 1 / gamma) * 255;
+   });
+}
+
+Lut Lut::brighten(int percentage) {
+   float factor = (100.0f + percentage) / 100.0f;
+   return Lut::fromFunction([factor](unsigned char x) -> unsigned char {
+      return std::min((int) (x * factor), 255);
+   });
+}
+
+Lut Lut::dim(int percentage) {
+   float factor = (100.0f - percentage) / 100.0f;
+   return Lut::fromFunction([factor](unsigned char x) -> unsigned char {
+      return (int) (x * factor);
+   });
+}
+
+Lut Lut::invert() {
+   return Lut::fromFunction([](unsigned char x) -> unsigned char {
+      return 255 - x;
+   });
+}
+
+Lut Lut::then(const Lut& next) const {
+   Lut result;
+   for (int c = 0; c < 3; c++) {
+      for (int x = 0; x < 256; x++) {
+         result._table[c][x] = next._table[c][this->_table[c][x]];
+      }
+   }
+   return result;
+}
+
+unsigned char Lut::get(int channel, unsigned char value) const {
+   return this->_table[channel][value];
+}
+
+void Lut::set(int channel, unsigned char value, unsigned char result) {
+   this->_table[channel][value] = result;
+}
+
+void Lut::apply(unsigned char* data, int numPixels) const {
+   const unsigned char* red = this->_table[0];
+   const unsigned char* green = this->_table[1];
+   const unsigned char* blue = this->_table[2];
+   for (int idx = 0; idx < numPixels * 3; idx += 3) {
+      data[idx] = red[data[idx]];
+      data[idx + 1] = green[data[idx + 1]];
+      data[idx + 2] = blue[data[idx + 2]];
+   }
+}
+
+void Lut::applyPlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels) const {
+   unsigned char* planes[3] = {r, g, b};
+   for (int c = 0; c < 3; c++) {
+      const unsigned char* table = this->_table[c];
+      unsigned char* plane = planes[c];
+      for (int idx = 0; idx < numPixels; idx++) {
+         plane[idx] = table[plane[idx]];
+      }
+   }
+}
+
+}  // namespace agl
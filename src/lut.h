@@ -0,0 +1,78 @@
+/**
+ * Per-channel lookup tables for tone operators
+ *
+ * @file lut.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_LUT_H_
+#define AGL_LUT_H_
+
+#include <functional>
+
+namespace agl {
+
+/**
+ * @brief Maps each channel value through its own 256-entry table
+ *
+ * Any operator that sets each channel to a fixed function of that
+ * channel's old value is a Lut. Chains of them compose with then() into a
+ * single table, so the pixels are only looked up once however long the
+ * chain is.
+ */
+class Lut {
+ public:
+  /** @brief Create the identity table
+   */
+  Lut();
+
+  /**
+   * @brief Create a table from a function applied to every channel
+   */
+  static Lut fromFunction(const std::function<unsigned char(unsigned char)>& fn);
+
+  // x = 255 * (x / 255)^(1 / gamma)
+  static Lut gammaCorrect(float gamma);
+
+  // x = min(x * (100 + percentage) / 100, 255)
+  static Lut brighten(int percentage);
+
+  // x = x * (100 - percentage) / 100
+  static Lut dim(int percentage);
+
+  // x = 255 - x
+  static Lut invert();
+
+  /**
+   * @brief Return the table that applies this table and then next
+   */
+  Lut then(const Lut& next) const;
+
+  /**
+   * @brief Return the table entry for a channel (0 red, 1 green, 2 blue)
+   */
+  unsigned char get(int channel, unsigned char value) const;
+
+  /**
+   * @brief Set the table entry for a channel (0 red, 1 green, 2 blue)
+   */
+  void set(int channel, unsigned char value, unsigned char result);
+
+  /**
+   * @brief Map numPixels RGB pixels starting at data, in place
+   */
+  void apply(unsigned char* data, int numPixels) const;
+
+  /**
+   * @brief Map numPixels pixels of a planar image in place, each plane
+   * through the table of its channel
+   */
+  void applyPlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels) const;
+
+ private:
+  // one table per channel, indexed by the old channel value
+  unsigned char _table[3][256];
+};
+}  // namespace agl
+#endif  // AGL_LUT_H_
@@ -0,0 +1,208 @@
+/**
+ * Implementation of the memory-mapped files
+ *
+ * @file mappedfile.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "mappedfile.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace agl {
+
+MappedFile::MappedFile(unsigned char* data, size_t size) {
+   this->_data = data;
+   this->_size = size;
+}
+
+unsigned char* MappedFile::data() const {
+   return this->_data;
+}
+
+size_t MappedFile::size() const {
+   return this->_size;
+}
+
+MappedFile::~MappedFile() {
+   this->unmap();
+   if (!this->_temporary.empty()) {
+      std::remove(this->_temporary.c_str());
+   }
+}
+
+bool MappedFile::commit() {
+   return this->commit(this->_size);
+}
+
+// a name in the directory of filename that no other writer, in this
+// process or another, picks at the same time
+static std::string temporaryName(const std::string& filename) {
+   static std::atomic<int> numTemporaries(0);
+#ifdef _WIN32
+   int pid = _getpid();
+#else
+   int pid = (int) getpid();
+#endif
+   return filename + "." + std::to_string(pid) + "-" + std::to_string(numTemporaries++) + ".tmp";
+}
+
+#ifdef _WIN32
+
+// map size bytes of file with the given protection and view access
+static unsigned char* mapView(HANDLE file, size_t size, DWORD protect, DWORD access) {
+   HANDLE mapping = CreateFileMappingA(file, NULL, protect,
+      (DWORD) ((unsigned long long) size >> 32), (DWORD) size, NULL);
+   if (!mapping) {
+      return NULL;
+   }
+   void* view = MapViewOfFile(mapping, access, 0, 0, size);
+   // the view keeps the mapping alive
+   CloseHandle(mapping);
+   return (unsigned char*) view;
+}
+
+void MappedFile::unmap() {
+   if (this->_data) {
+      UnmapViewOfFile(this->_data);
+      this->_data = NULL;
+   }
+}
+
+MappedFile* MappedFile::openPrivate(const std::string& filename) {
+   HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE) {
+      return NULL;
+   }
+   LARGE_INTEGER size;
+   unsigned char* data = NULL;
+   if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      data = mapView(file, (size_t) size.QuadPart, PAGE_WRITECOPY, FILE_MAP_COPY);
+   }
+   CloseHandle(file);
+   return data ? new MappedFile(data, (size_t) size.QuadPart) : NULL;
+}
+
+MappedFile* MappedFile::create(const std::string& filename, size_t size) {
+   std::string temporary = temporaryName(filename);
+   HANDLE file = CreateFileA(temporary.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+      CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE) {
+      return NULL;
+   }
+   // mapping a file with a size extends it
+   unsigned char* data = size > 0 ? mapView(file, size, PAGE_READWRITE, FILE_MAP_WRITE) : NULL;
+   CloseHandle(file);
+   if (!data) {
+      std::remove(temporary.c_str());
+      return NULL;
+   }
+   MappedFile* mapped = new MappedFile(data, size);
+   mapped->_filename = filename;
+   mapped->_temporary = temporary;
+   return mapped;
+}
+
+bool MappedFile::commit(size_t size) {
+   this->unmap();
+   if (this->_temporary.empty()) {
+      return false;
+   }
+   if (size < this->_size) {
+      HANDLE file = CreateFileA(this->_temporary.c_str(), GENERIC_WRITE, 0, NULL,
+         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (file == INVALID_HANDLE_VALUE) {
+         return false;
+      }
+      LARGE_INTEGER end;
+      end.QuadPart = (LONGLONG) size;
+      bool cut = SetFilePointerEx(file, end, NULL, FILE_BEGIN) && SetEndOfFile(file);
+      CloseHandle(file);
+      if (!cut) {
+         return false;
+      }
+   }
+   if (!MoveFileExA(this->_temporary.c_str(), this->_filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+      return false;
+   }
+   this->_temporary.clear();
+   return true;
+}
+
+#else
+
+void MappedFile::unmap() {
+   if (this->_data) {
+      munmap(this->_data, this->_size);
+      this->_data = NULL;
+   }
+}
+
+MappedFile* MappedFile::openPrivate(const std::string& filename) {
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0) {
+      return NULL;
+   }
+   struct stat info;
+   void* data = MAP_FAILED;
+   if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   }
+   // the mapping stays valid after the descriptor is closed
+   close(fd);
+   if (data == MAP_FAILED) {
+      return NULL;
+   }
+   return new MappedFile((unsigned char*) data, info.st_size);
+}
+
+MappedFile* MappedFile::create(const std::string& filename, size_t size) {
+   // a new inode, so truncating it cannot reach the pages of a private
+   // mapping of filename, such as an Image loaded from it
+   std::string temporary = temporaryName(filename);
+   int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+   if (fd < 0) {
+      return NULL;
+   }
+   void* data = MAP_FAILED;
+   if (size > 0 && ftruncate(fd, size) == 0) {
+      data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   }
+   close(fd);
+   if (data == MAP_FAILED) {
+      std::remove(temporary.c_str());
+      return NULL;
+   }
+   MappedFile* mapped = new MappedFile((unsigned char*) data, size);
+   mapped->_filename = filename;
+   mapped->_temporary = temporary;
+   return mapped;
+}
+
+bool MappedFile::commit(size_t size) {
+   this->unmap();
+   if (this->_temporary.empty() ||
+      (size < this->_size && truncate(this->_temporary.c_str(), size) != 0) ||
+      std::rename(this->_temporary.c_str(), this->_filename.c_str()) != 0) {
+      return false;
+   }
+   this->_temporary.clear();
+   return true;
+}
+
+#endif
+
+}  // namespace agl
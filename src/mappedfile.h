@@ -0,0 +1,77 @@
+/**
+ * Files mapped into memory
+ *
+ * @file mappedfile.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_MAPPEDFILE_H_
+#define AGL_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace agl {
+
+/**
+ * @brief A file mapped into memory, unmapped when destroyed
+ */
+class MappedFile {
+ public:
+  ~MappedFile();
+
+  /**
+   * @brief Map filename copy-on-write: the bytes can be modified, but
+   * changes stay private to this process and never reach the file
+   * @return The mapping, or NULL if the file cannot be mapped
+   */
+  static MappedFile* openPrivate(const std::string& filename);
+
+  /**
+   * @brief Map a new file of the given size for writing, to become
+   * filename on commit()
+   *
+   * The bytes go to a temporary file in the same directory, so an
+   * existing filename, and any mapping of it, is untouched until commit
+   * moves the new file into its place. Destroying the mapping without
+   * committing removes the temporary file.
+   * @return The mapping, or NULL if the file cannot be created
+   */
+  static MappedFile* create(const std::string& filename, size_t size);
+
+  /**
+   * @brief Unmap a file made by create and rename it to its filename
+   * @return Whether the file is now in place
+   */
+  bool commit();
+
+  /**
+   * @brief Commit only the first size bytes, for writers that map the
+   * most they might write
+   */
+  bool commit(size_t size);
+
+  /** @brief Return the mapped bytes
+   */
+  unsigned char* data() const;
+
+  /** @brief Return the number of mapped bytes
+   */
+  size_t size() const;
+
+ private:
+  MappedFile(unsigned char* data, size_t size);
+  void unmap();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  unsigned char* _data;
+  size_t _size;
+  // for files made by create: where commit moves the file, and where it
+  // is until then
+  std::string _filename;
+  std::string _temporary;
+};
+}  // namespace agl
+#endif  // AGL_MAPPEDFILE_H_
@@ -0,0 +1,237 @@
+/**
+ * Implementation of the lazy operator pipeline
+ *
+ * @file pipeline.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "pipeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include "pointops.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace agl {
+
+// pixels per block streamed through a fused group (48 KB, fits in L2)
+static const int BLOCK_PIXELS = 16384;
+
+// name a stage after its operator and parameters, e.g. "brighten 20"
+template <typename T>
+static std::string describe(const std::string& name, const T& value) {
+   std::ostringstream text;
+   text << name << " " << value;
+   return text.str();
+}
+
+static std::string describe(const std::string& name, const Pixel& a, const Pixel& b) {
+   std::ostringstream text;
+   text << name << " " << (int) a.r << "," << (int) a.g << "," << (int) a.b << " "
+      << (int) b.r << "," << (int) b.g << "," << (int) b.b;
+   return text.str();
+}
+
+Pipeline::Pipeline(const Image& source) {
+   this->_source = &source;
+   this->_cache = NULL;
+}
+
+Pipeline& Pipeline::swirl() {
+   return this->map("swirl", [](unsigned char* data, size_t first, int n) {
+      pointops::swirl(data, n);
+   });
+}
+
+Pipeline& Pipeline::invert() {
+   return this->lut("invert", Lut::invert());
+}
+
+Pipeline& Pipeline::grayscale() {
+   return this->map("grayscale", [](unsigned char* data, size_t first, int n) {
+      pointops::grayscale(data, n);
+   });
+}
+
+Pipeline& Pipeline::gammaCorrect(float gamma) {
+   return this->lut(describe("gammaCorrect", gamma), Lut::gammaCorrect(gamma));
+}
+
+Pipeline& Pipeline::brighten(int percentage) {
+   return this->lut(describe("brighten", percentage), Lut::brighten(percentage));
+}
+
+Pipeline& Pipeline::dim(int percentage) {
+   return this->lut(describe("dim", percentage), Lut::dim(percentage));
+}
+
+Pipeline& Pipeline::fill(const Pixel& a, const Pixel& b) {
+   return this->map(describe("fill", a, b), [a, b](unsigned char* data, size_t first, int n) {
+      pointops::fill(data, n, a, b);
+   });
+}
+
+Pipeline& Pipeline::alphaBlend(const Image& other, float alpha) {
+   const Image* src = &other;
+   // the kernels read interleaved pixels, so the stage keeps its own
+   // interleaved copy of a planar image
+   std::shared_ptr<Image> converted;
+   if (other.layout() == Layout::Planar) {
+      converted = std::make_shared<Image>(other.toLayout(Layout::Interleaved));
+      src = converted.get();
+   }
+   this->map(describe("alphaBlend", alpha), [src, alpha, converted](unsigned char* data, size_t first, int n) {
+      pointops::alphaBlend(data, n, *src, first, alpha);
+   });
+   this->_stages.back().other = src;
+   return *this;
+}
+
+Pipeline& Pipeline::map(const std::string& name, const PointOp& op) {
+   this->_stages.push_back(Stage{name, op, nullptr, false, Lut(), NULL});
+   return *this;
+}
+
+Pipeline& Pipeline::lut(const std::string& name, const Lut& table) {
+   if (!this->_stages.empty() && this->_stages.back().isLut) {
+      Stage& last = this->_stages.back();
+      last.name += "+" + name;
+      last.table = last.table.then(table);
+      return *this;
+   }
+   this->_stages.push_back(Stage{name, nullptr, nullptr, true, table, NULL});
+   return *this;
+}
+
+Pipeline& Pipeline::apply(const std::string& name, const ImageOp& op) {
+   this->_stages.push_back(Stage{name, nullptr, op, false, Lut(), NULL});
+   return *this;
+}
+
+Pipeline& Pipeline::cache(ResultCache& cache) {
+   this->_cache = &cache;
+   return *this;
+}
+
+int Pipeline::size() const {
+   return (int) this->_stages.size();
+}
+
+Image Pipeline::run() const {
+   if (this->_source->layout() == Layout::Planar) {
+      // the kernels work on interleaved pixels, so convert at the edges
+      Image source = this->_source->toLayout(Layout::Interleaved);
+      Pipeline interleaved(*this);
+      interleaved._source = &source;
+      return interleaved.run().toLayout(Layout::Planar);
+   }
+   trace::Scope scope("pipeline", this->_source->width(), this->_source->height());
+   scope.arg("stages", this->_stages.size());
+   Image current;
+   const Image* input = this->_source;
+   int numStages = (int) this->_stages.size();
+   int idx = 0;
+   std::vector<uint64_t> keys;
+   if (this->_cache && this->_cache->enabled()) {
+      keys = this->cacheKeys();
+      idx = this->resume(keys, current);
+      if (idx > 0) {
+         input = &current;
+      }
+      scope.arg("cachedStages", idx);
+   }
+   while (idx < numStages) {
+      int end = this->groupEnd(idx);
+      if (this->_stages[idx].image) {
+         current = this->_stages[idx].image(*input);
+      } else {
+         // intermediates are ours to overwrite; the source is copied once
+         if (input != &current) {
+            current = Image(input->width(), input->height(), false);
+         }
+         this->fuse(*input, current, idx, end);
+      }
+      idx = end;
+      input = &current;
+      if (!keys.empty()) {
+         this->_cache->store(keys[idx - 1], current);
+      }
+   }
+   if (input == this->_source) {
+      return Image(*this->_source);
+   }
+   return current;
+}
+
+int Pipeline::groupEnd(int begin) const {
+   if (this->_stages[begin].image) {
+      return begin + 1;
+   }
+   int end = begin;
+   while (end < (int) this->_stages.size() && !this->_stages[end].image) {
+      end++;
+   }
+   return end;
+}
+
+std::vector<uint64_t> Pipeline::cacheKeys() const {
+   std::vector<uint64_t> keys;
+   uint64_t key = ResultCache::hash(*this->_source);
+   for (const Stage& stage : this->_stages) {
+      key = ResultCache::hash(key, stage.name);
+      if (stage.other) {
+         key = ResultCache::hash(key, std::to_string(ResultCache::hash(*stage.other)));
+      }
+      keys.push_back(key);
+   }
+   return keys;
+}
+
+int Pipeline::resume(const std::vector<uint64_t>& keys, Image& result) const {
+   std::vector<int> ends;
+   for (int idx = 0; idx < (int) this->_stages.size(); idx = ends.back()) {
+      ends.push_back(this->groupEnd(idx));
+   }
+   for (int g = (int) ends.size() - 1; g >= 0; g--) {
+      if (this->_cache->load(keys[ends[g] - 1], result)) {
+         return ends[g];
+      }
+   }
+   return 0;
+}
+
+void Pipeline::fuse(const Image& input, Image& result, int begin, int end) const {
+   trace::Scope scope("fused", input.width(), input.height());
+   if (scope.active()) {
+      std::string names;
+      for (int s = begin; s < end; s++) {
+         names += (s > begin ? ", " : "") + this->_stages[s].name;
+      }
+      scope.arg("operators", names);
+   }
+   int numPixels = input.width() * input.height();
+   parallelFor(0, numPixels, BLOCK_PIXELS, [&](int firstPixel, int lastPixel) {
+      for (int first = firstPixel; first < lastPixel; first += BLOCK_PIXELS) {
+         int n = std::min(BLOCK_PIXELS, lastPixel - first);
+         unsigned char* block = result.data() + (size_t) first * 3;
+         if (&input != &result) {
+            memcpy(block, input.data() + (size_t) first * 3, n * 3);
+         }
+         for (int s = begin; s < end; s++) {
+            const Stage& stage = this->_stages[s];
+            if (stage.isLut) {
+               stage.table.apply(block, n);
+            } else {
+               stage.point(block, first, n);
+            }
+         }
+      }
+   });
+}
+
+}  // namespace agl
@@ -0,0 +1,150 @@
+/**
+ * Lazy chain of image operators that fuses point-wise steps into a single
+ * pass over the pixels
+ *
+ * @file pipeline.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_PIPELINE_H_
+#define AGL_PIPELINE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "image.h"
+#include "lut.h"
+
+namespace agl {
+
+/**
+ * @brief Records operators on an image and applies them when run
+ *
+ * Consecutive point-wise operators are fused: run() streams the image
+ * through them in cache-sized blocks, so a chain of N point-wise steps
+ * reads and writes the pixels once instead of N times. Operators that
+ * need the whole image (e.g. sobel) are recorded with apply() and act as
+ * barriers between fused groups.
+ *
+ * Consecutive lookup table operators (gammaCorrect, brighten, dim, invert,
+ * lut) are composed into one table as they are recorded, so such a chain
+ * costs one lookup per byte.
+ *
+ * With a ResultCache, run() stores the image after each fused group and
+ * each full-image operator, and starts from the last one already stored,
+ * so a rerun skips to the first step that changed. Keys are made from the
+ * stage names, which for the built-in operators include their parameters;
+ * the names given to map(), lut() and apply() must do the same.
+ *
+ * The source image is not copied and must outlive the pipeline.
+ */
+class Pipeline {
+ public:
+  /**
+   * @brief Point-wise kernel over a block of pixels
+   * @param data The first RGB pixel of the block, updated in place
+   * @param first The index of the first pixel of the block in the image,
+   * which may pass 2^31 in a streamed image
+   * @param numPixels The number of pixels in the block
+   */
+  typedef std::function<void(unsigned char* data, size_t first, int numPixels)> PointOp;
+
+  /**
+   * @brief Full-image operator, e.g. [](const Image& im) { return im.sobel(); }
+   */
+  typedef std::function<Image(const Image&)> ImageOp;
+
+  explicit Pipeline(const Image& source);
+
+  // swirl the colors
+  Pipeline& swirl();
+
+  // Replace each pixel value "x" with 255-x
+  Pipeline& invert();
+
+  // Convert the image to grayscale
+  Pipeline& grayscale();
+
+  // Apply gamma correction
+  Pipeline& gammaCorrect(float gamma);
+
+  // Increase all pixel values by fixed percentage
+  Pipeline& brighten(int percentage);
+
+  // Decrease all pixel values by fixed percentage
+  Pipeline& dim(int percentage);
+
+  // Fill pixels of certain color with another color
+  Pipeline& fill(const Pixel& a, const Pixel& b);
+
+  // Blend with the given image, which must be the same size as the image
+  // reaching this step and must outlive the pipeline
+  Pipeline& alphaBlend(const Image& other, float alpha);
+
+  // Record a custom point-wise operator
+  Pipeline& map(const std::string& name, const PointOp& op);
+
+  // Record a lookup table operator; merges with a lookup table recorded
+  // just before it
+  Pipeline& lut(const std::string& name, const Lut& table);
+
+  // Record a full-image operator; ends the current fused group
+  Pipeline& apply(const std::string& name, const ImageOp& op);
+
+  // Look up and store intermediate results in cache, which must outlive
+  // the pipeline
+  Pipeline& cache(ResultCache& cache);
+
+  /**
+   * @brief Return the number of recorded operators
+   */
+  int size() const;
+
+  /**
+   * @brief Apply the recorded operators and return the result
+   *
+   * The pipeline can be run more than once; the source is never modified.
+   * A planar source is run as interleaved pixels, and the result is
+   * converted back to planar.
+   */
+  Image run() const;
+
+ private:
+  struct Stage {
+    std::string name;
+    PointOp point;
+    ImageOp image;
+    // set for lookup table stages, which apply table instead of point
+    bool isLut;
+    Lut table;
+    // a second image the stage reads, part of its cache key
+    const Image* other;
+  };
+
+  // return the end of the fused group or full-image stage at begin
+  int groupEnd(int begin) const;
+
+  // return the cache key of the result of each stage
+  std::vector<uint64_t> cacheKeys() const;
+
+  // load the latest result in the cache into result and return the index
+  // of the stage after it, or 0 if there is none
+  int resume(const std::vector<uint64_t>& keys, Image& result) const;
+
+  // run a group of point-wise stages [begin, end) over input, writing to
+  // result, which is the same size and may be input itself
+  void fuse(const Image& input, Image& result, int begin, int end) const;
+
+  // image the operators are applied to
+  const Image* _source;
+  // operators in the order they were recorded
+  std::vector<Stage> _stages;
+  // null unless results are cached
+  ResultCache* _cache;
+};
+}  // namespace agl
+#endif  // AGL_PIPELINE_H_
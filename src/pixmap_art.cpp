@@ -5,76 +5,68 @@
  */
 
 #include <iostream>
+#include "async.h"
 #include "image.h"
+#include "pipeline.h"
 using namespace std;
 using namespace agl;
 
 int main(int argc, char** argv)
 {  
-   Image earth;
-   earth.load("../images/earth.png");
-   Image rose;
-   rose.load("../images/rose.jpg");
-   Image roseSmall = rose.resize(200, 200);
-
-   Image art1 = earth.deepFry().distort("horizontal").painterly();
-   art1.replace(roseSmall.sobel().sharpen().glow(), (earth.width() - roseSmall.width()) / 2, (earth.height() - roseSmall.height()) / 2);
-   art1.save("../art/art-1.png");
-
-   Image art2 = rose.gammaCorrect(0.8).colorJitter(100).distort("vertical").sobel();
-   art2.save("../art/art-2.png");
-
-   Image bricks;
-   bricks.load("../images/bricks.png");
-
-   Image art3 = bricks.glitch().bitmap(10).distort("horizontal").distort("vertical").resize(400, 400);
-   art3.save("../art/art-3.png");
-
-   Image abstract;
-   abstract.load("../images/abstract.jpg");
-
-   Image art4 = abstract.swirl().sobel().invert();
-   art4.save("../art/art-4.png");
-
-   Image cat;
-   cat.load("../images/cat.jpg");
-
-   Image art5 = cat.resize(756, 1008).sharpen().sobel().glow();
-   art5.save("../art/art-5.png");
-
-   Image springPink;
-   springPink.load("../images/spring-pink.jpg");
-
-   Image art6 = springPink.resize(756, 1008).swirl().painterly();
-   art6.save("../art/art-6.png");
-
-   Image lake;
-   lake.load("../images/lake.jpg");
-
-   Image art7 = lake.painterly().sharpen().brighten(30);
-   art7.save("../art/art-7.png");
-
-   Image forest;
-   forest.load("../images/forest.png");
-   Image droplets;
-   droplets.load("../images/droplets.png");
-   Image sunset;
-   sunset.load("../images/sunset.jpg");
-
-   Image art8 = forest.add(droplets).deepFry().alphaBlend(sunset.resize(360, 678), 0.25);
-   art8.save("../art/art-8.png");
-
-   Image pebbles;
-   pebbles.load("../images/pebbles.png");
-   Image space;
-   space.load("../images/space.png");
-
-   Image art9 = pebbles.add(space).sobel().glow();
-   art9.save("../art/art-9.png");
-
-   Image art10 = earth.glitch().fill({255, 255, 255}, {255, 128, 64}).invert().sobel();
-   art10.save("../art/art-10.png");
-
-   return 0;
+   // each artwork is decoded while the one before it is processed, and
+   // encoded while the one after it is
+   AsyncPipeline jobs;
+
+   jobs.submit({"../images/earth.png", "../images/rose.jpg"}, "../art/art-1.png", [](vector<Image>& in) {
+      const Image& earth = in[0];
+      Image roseSmall = in[1].resize(200, 200);
+      Image art1 = earth.deepFry().distort("horizontal").painterly();
+      art1.replace(roseSmall.sobel().sharpen().glow(), (earth.width() - roseSmall.width()) / 2, (earth.height() - roseSmall.height()) / 2);
+      return art1;
+   });
+
+   jobs.submit({"../images/rose.jpg"}, "../art/art-2.png", [](vector<Image>& in) {
+      return in[0].gammaCorrect(0.8).colorJitter(100).distort("vertical").sobel();
+   });
+
+   jobs.submit({"../images/bricks.png"}, "../art/art-3.png", [](vector<Image>& in) {
+      return in[0].glitch().bitmap(10).distort("horizontal").distort("vertical").resize(400, 400);
+   });
+
+   jobs.submit({"../images/abstract.jpg"}, "../art/art-4.png", [](vector<Image>& in) {
+      return in[0].swirl().sobel().invert();
+   });
+
+   jobs.submit({"../images/cat.jpg"}, "../art/art-5.png", [](vector<Image>& in) {
+      return in[0].resize(756, 1008).sharpen().sobel().glow();
+   });
+
+   jobs.submit({"../images/spring-pink.jpg"}, "../art/art-6.png", [](vector<Image>& in) {
+      return in[0].resize(756, 1008).swirl().painterly();
+   });
+
+   jobs.submit({"../images/lake.jpg"}, "../art/art-7.png", [](vector<Image>& in) {
+      return in[0].painterly().sharpen().brighten(30);
+   });
+
+   jobs.submit({"../images/forest.png", "../images/droplets.png", "../images/sunset.jpg"}, "../art/art-8.png", [](vector<Image>& in) {
+      return in[0].add(in[1]).deepFry().alphaBlend(in[2].resize(360, 678), 0.25);
+   });
+
+   jobs.submit({"../images/pebbles.png", "../images/space.png"}, "../art/art-9.png", [](vector<Image>& in) {
+      return in[0].add(in[1]).sobel().glow();
+   });
+
+   // fill and invert run as a single fused pass between glitch and sobel;
+   // with AGL_CACHE_DIR set, reruns load the stored steps instead
+   jobs.submit({"../images/earth.png"}, "../art/art-10.png", [](vector<Image>& in) {
+      return Pipeline(in[0])
+         .cache(ResultCache::shared())
+         .apply("glitch", [](const Image& im) { return im.glitch(); })
+         .fill({255, 255, 255}, {255, 128, 64}).invert()
+         .apply("sobel", [](const Image& im) { return im.sobel(); })
+         .run();
+   });
+
+   return jobs.finish() == 0 ? 0 : 1;
 }
-
@@ -0,0 +1,362 @@
+/**
+ * Processes the images listed in a manifest in parallel and reports the
+ * throughput
+ *
+ * Each manifest line names an input file, an output file and the
+ * operators to apply, in order, with their arguments:
+ *
+ *    ../images/earth.png ../out/earth.png blur 2 sobel brighten 20
+ *    ../images/forest.png ../out/forest.png add ../images/droplets.png
+ *
+ * Colors are written r,g,b. Blank lines and lines starting with # are
+ * skipped. Run as pixmap_batch <manifest>, or with - to read stdin.
+ *
+ * @file pixmap_batch.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "image.h"
+#include "resample.h"
+#include "threadpool.h"
+using namespace std;
+using namespace agl;
+
+// replaces image with the result of one operator; false on failure
+typedef function<bool(Image& image)> Step;
+
+struct Job {
+   string input;
+   string output;
+   vector<Step> steps;
+};
+
+static void fail(int line, const string& message)
+{
+   cerr << "manifest line " << line << ": " << message << endl;
+   exit(1);
+}
+
+// pulls the whitespace-separated tokens of one manifest line
+class Tokens {
+ public:
+   Tokens(const string& text, int line) : _stream(text), _line(line) {}
+
+   bool done() {
+      this->_stream >> ws;
+      return this->_stream.eof();
+   }
+
+   string next(const string& what) {
+      string token;
+      if (!(this->_stream >> token)) {
+         fail(this->_line, "missing " + what);
+      }
+      return token;
+   }
+
+   int nextInt(const string& what) {
+      string token = this->next(what);
+      char* end = NULL;
+      long value = strtol(token.c_str(), &end, 10);
+      if (*end != '\0' || value < INT_MIN || value > INT_MAX) {
+         fail(this->_line, what + " must be an integer, not " + token);
+      }
+      return (int) value;
+   }
+
+   int nextAtLeast(const string& what, int least) {
+      int value = this->nextInt(what);
+      if (value < least) {
+         fail(this->_line, what + " must be at least " + to_string(least) + ", not " + to_string(value));
+      }
+      return value;
+   }
+
+   float nextFloat(const string& what) {
+      string token = this->next(what);
+      char* end = NULL;
+      float value = strtof(token.c_str(), &end);
+      if (*end != '\0') {
+         fail(this->_line, what + " must be a number, not " + token);
+      }
+      return value;
+   }
+
+   Pixel nextPixel(const string& what) {
+      string token = this->next(what);
+      int r, g, b;
+      char extra;
+      if (sscanf(token.c_str(), "%d,%d,%d%c", &r, &g, &b, &extra) != 3 ||
+         r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) {
+         fail(this->_line, what + " must be r,g,b from 0 to 255, not " + token);
+      }
+      return Pixel{(unsigned char) r, (unsigned char) g, (unsigned char) b};
+   }
+
+   string nextOrientation() {
+      string orientation = this->next("orientation");
+      if (orientation != "horizontal" && orientation != "vertical") {
+         fail(this->_line, "orientation must be horizontal or vertical, not " + orientation);
+      }
+      return orientation;
+   }
+
+   int line() const {
+      return this->_line;
+   }
+
+ private:
+   istringstream _stream;
+   int _line;
+};
+
+// wrap an operator taking a second image, loaded when the step runs; it
+// must be the size of the job's image, or only that job fails
+static Step withImage(const string& filename, const function<Image(Image&&, const Image&)>& op)
+{
+   return [filename, op](Image& image) {
+      Image other;
+      if (!other.load(filename)) {
+         cerr << "Cannot load " << filename << endl;
+         return false;
+      }
+      if (other.width() != image.width() || other.height() != image.height()) {
+         cerr << filename << " is " << other.width() << "x" << other.height() << ", not "
+            << image.width() << "x" << image.height() << endl;
+         return false;
+      }
+      image = op(std::move(image), other);
+      return true;
+   };
+}
+
+static Step parseStep(const string& name, Tokens& tokens)
+{
+   // each lambda takes image by value, so operators with an rvalue
+   // overload reuse its buffer
+   typedef function<Image(Image)> Op;
+   Op op;
+   if (name == "resize") {
+      int w = tokens.nextAtLeast("width", 1);
+      int h = tokens.nextAtLeast("height", 1);
+      op = [w, h](Image im) { return im.resize(w, h); };
+   } else if (name == "resizeFilter") {
+      int w = tokens.nextAtLeast("width", 1);
+      int h = tokens.nextAtLeast("height", 1);
+      string filter = tokens.next("filter");
+      if (!resample::isFilter(filter)) {
+         fail(tokens.line(), "unknown filter " + filter);
+      }
+      op = [w, h, filter](Image im) { return im.resize(w, h, filter); };
+   } else if (name == "flipHorizontal") {
+      op = [](Image im) { return std::move(im).flipHorizontal(); };
+   } else if (name == "flipVertical") {
+      op = [](Image im) { return std::move(im).flipVertical(); };
+   } else if (name == "rotate90") {
+      op = [](Image im) { return im.rotate90(); };
+   } else if (name == "subimage") {
+      int x = tokens.nextAtLeast("x", 0);
+      int y = tokens.nextAtLeast("y", 0);
+      int w = tokens.nextAtLeast("width", 1);
+      int h = tokens.nextAtLeast("height", 1);
+      // the image size is known only once it is loaded
+      int line = tokens.line();
+      return [x, y, w, h, line](Image& image) {
+         if ((long long) x + w > image.width() || (long long) y + h > image.height()) {
+            cerr << "manifest line " << line << ": subimage " << w << "x" << h << " at " << x << "," << y
+               << " is outside the " << image.width() << "x" << image.height() << " image" << endl;
+            return false;
+         }
+         image = image.subimage(x, y, w, h);
+         return true;
+      };
+   } else if (name == "swirl") {
+      op = [](Image im) { return std::move(im).swirl(); };
+   } else if (name == "add") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).add(b); });
+   } else if (name == "subtract") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).subtract(b); });
+   } else if (name == "multiply") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).multiply(b); });
+   } else if (name == "difference") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).difference(b); });
+   } else if (name == "lightest") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).lightest(b); });
+   } else if (name == "darkest") {
+      return withImage(tokens.next("image"), [](Image&& a, const Image& b) { return std::move(a).darkest(b); });
+   } else if (name == "alphaBlend") {
+      string other = tokens.next("image");
+      float amount = tokens.nextFloat("amount");
+      return withImage(other, [amount](Image&& a, const Image& b) { return std::move(a).alphaBlend(b, amount); });
+   } else if (name == "gammaCorrect") {
+      float gamma = tokens.nextFloat("gamma");
+      op = [gamma](Image im) { return std::move(im).gammaCorrect(gamma); };
+   } else if (name == "invert") {
+      op = [](Image im) { return std::move(im).invert(); };
+   } else if (name == "grayscale") {
+      op = [](Image im) { return std::move(im).grayscale(); };
+   } else if (name == "colorJitter") {
+      int size = tokens.nextAtLeast("size", 1);
+      op = [size](Image im) { return std::move(im).colorJitter(size); };
+   } else if (name == "bitmap") {
+      int size = tokens.nextAtLeast("size", 1);
+      op = [size](Image im) { return im.bitmap(size); };
+   } else if (name == "fill") {
+      Pixel a = tokens.nextPixel("color");
+      Pixel b = tokens.nextPixel("color");
+      op = [a, b](Image im) { return std::move(im).fill(a, b); };
+   } else if (name == "blur") {
+      int iters = tokens.nextInt("iterations");
+      op = [iters](Image im) { return im.blur(iters); };
+   } else if (name == "boxBlur") {
+      int radius = tokens.nextInt("radius");
+      op = [radius](Image im) { return im.boxBlur(radius); };
+   } else if (name == "blurGaussian") {
+      float sigma = tokens.nextFloat("sigma");
+      op = [sigma](Image im) { return im.blurGaussian(sigma); };
+   } else if (name == "glow") {
+      op = [](Image im) { return im.glow(); };
+   } else if (name == "border") {
+      Pixel color = tokens.nextPixel("color");
+      op = [color](Image im) { return im.border(color); };
+   } else if (name == "sobel") {
+      op = [](Image im) { return im.sobel(); };
+   } else if (name == "sobelFast") {
+      op = [](Image im) { return im.sobel("fast"); };
+   } else if (name == "glitch") {
+      op = [](Image im) { return im.glitch(); };
+   } else if (name == "painterly") {
+      op = [](Image im) { return im.painterly(); };
+   } else if (name == "distort") {
+      string orientation = tokens.nextOrientation();
+      op = [orientation](Image im) { return im.distort(orientation); };
+   } else if (name == "gradient") {
+      string orientation = tokens.nextOrientation();
+      Pixel color = tokens.nextPixel("color");
+      op = [orientation, color](Image im) { return im.gradient(orientation, color); };
+   } else if (name == "sharpen") {
+      op = [](Image im) { return im.sharpen(); };
+   } else if (name == "brighten") {
+      int percentage = tokens.nextInt("percentage");
+      op = [percentage](Image im) { return std::move(im).brighten(percentage); };
+   } else if (name == "dim") {
+      int percentage = tokens.nextInt("percentage");
+      op = [percentage](Image im) { return std::move(im).dim(percentage); };
+   } else if (name == "deepFry") {
+      op = [](Image im) { return im.deepFry(); };
+   } else {
+      fail(tokens.line(), "unknown operator " + name);
+   }
+   return [op](Image& image) {
+      image = op(std::move(image));
+      return true;
+   };
+}
+
+static vector<Job> parseManifest(istream& in)
+{
+   vector<Job> jobs;
+   string text;
+   int line = 0;
+   while (getline(in, text)) {
+      line++;
+      Tokens tokens(text, line);
+      if (tokens.done()) {
+         continue;
+      }
+      Job job;
+      job.input = tokens.next("input");
+      if (job.input[0] == '#') {
+         continue;
+      }
+      job.output = tokens.next("output");
+      while (!tokens.done()) {
+         string name = tokens.next("operator");
+         job.steps.push_back(parseStep(name, tokens));
+      }
+      jobs.push_back(job);
+   }
+   return jobs;
+}
+
+// latency below which the given fraction of jobs finished
+static double percentile(const vector<double>& sorted, double fraction)
+{
+   if (sorted.empty()) {
+      return 0;
+   }
+   size_t rank = (size_t) (fraction * sorted.size() + 0.999999);
+   return sorted[max(rank, (size_t) 1) - 1];
+}
+
+int main(int argc, char** argv)
+{
+   if (argc != 2) {
+      cerr << "usage: " << argv[0] << " <manifest | ->" << endl;
+      return 1;
+   }
+   vector<Job> jobs;
+   if (string(argv[1]) == "-") {
+      jobs = parseManifest(cin);
+   } else {
+      ifstream manifest(argv[1]);
+      if (!manifest) {
+         cerr << "Cannot open " << argv[1] << endl;
+         return 1;
+      }
+      jobs = parseManifest(manifest);
+   }
+
+   typedef chrono::steady_clock Clock;
+   vector<double> latencies(jobs.size());
+   vector<double> megapixels(jobs.size());
+   vector<char> ok(jobs.size());
+   Clock::time_point start = Clock::now();
+   // one task per job, so idle threads steal whole jobs; each operator
+   // also splits its rows over the pool
+   ThreadPool::shared().run((int) jobs.size(), [&](int j) {
+      Clock::time_point jobStart = Clock::now();
+      Image image;
+      bool success = image.load(jobs[j].input);
+      if (!success) {
+         cerr << "Cannot load " << jobs[j].input << endl;
+      }
+      megapixels[j] = image.width() * (double) image.height() / 1e6;
+      for (size_t s = 0; s < jobs[j].steps.size() && success; s++) {
+         success = jobs[j].steps[s](image);
+      }
+      if (success && !image.save(jobs[j].output)) {
+         cerr << "Cannot save " << jobs[j].output << endl;
+         success = false;
+      }
+      ok[j] = success;
+      latencies[j] = chrono::duration<double, milli>(Clock::now() - jobStart).count();
+   });
+   double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+   int failed = 0;
+   double totalMegapixels = 0;
+   for (size_t j = 0; j < jobs.size(); j++) {
+      failed += !ok[j];
+      totalMegapixels += ok[j] ? megapixels[j] : 0;
+   }
+   sort(latencies.begin(), latencies.end());
+   int done = (int) jobs.size() - failed;
+   cout << "Processed " << done << " images (" << failed << " failed) in "
+      << seconds << " s on " << numThreads() << " threads: "
+      << done / seconds << " images/s, " << totalMegapixels / seconds << " MP/s" << endl;
+   cout << "Latency per job: p50 " << percentile(latencies, 0.5) << " ms, p99 "
+      << percentile(latencies, 0.99) << " ms" << endl;
+   return failed == 0 ? 0 : 1;
+}
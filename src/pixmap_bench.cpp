@@ -0,0 +1,334 @@
+/**
+ * Times every Image operator on synthetic images of several sizes
+ *
+ * Each operator runs a few untimed warmup calls and then the timed
+ * repetitions. The table gives the median time, its spread, and the
+ * throughput in megapixels and bytes (read plus written) per second.
+ *
+ *    pixmap_bench [--sizes 256x256,1920x1080] [--reps 5] [--warmup 1]
+ *                 [--filter blur] [--json results.json | --json -]
+ *
+ * With --json -, the JSON goes to stdout instead of the table.
+ *
+ * @file pixmap_bench.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "basicimage.h"
+#include "convolve.h"
+#include "image.h"
+#include "pyramid.h"
+#include "simd.h"
+#include "threadpool.h"
+using namespace std;
+using namespace agl;
+
+struct Benchmark {
+   string name;
+   // second is an image of the same size, for the blending operators
+   function<Image(const Image& first, const Image& second)> run;
+   int numInputs;
+   // layout of the inputs, converted before timing
+   Layout layout = Layout::Interleaved;
+};
+
+struct Result {
+   string name;
+   int width;
+   int height;
+   double minMs;
+   double medianMs;
+   double meanMs;
+   double stddevMs;
+   double megapixelsPerSecond;
+   double bytesPerSecond;
+};
+
+// a normalized disk of the given diameter, as a bokeh blur uses
+static vector<float> disk(int diameter)
+{
+   vector<float> kernel(diameter * diameter, 0.0f);
+   float radius = diameter / 2.0f;
+   float total = 0.0f;
+   for (int i = 0; i < diameter; i++) {
+      for (int j = 0; j < diameter; j++) {
+         float dy = i + 0.5f - radius;
+         float dx = j + 0.5f - radius;
+         if (dx * dx + dy * dy <= radius * radius) {
+            kernel[i * diameter + j] = 1.0f;
+            total += 1.0f;
+         }
+      }
+   }
+   for (float& weight : kernel) {
+      weight /= total;
+   }
+   return kernel;
+}
+
+static vector<Benchmark> benchmarks()
+{
+   const Pixel white = {255, 255, 255};
+   const Pixel orange = {255, 128, 64};
+   return {
+      {"resize", [](const Image& a, const Image&) { return a.resize(a.width() / 2, a.height() / 2); }, 1},
+      {"resize-quarter", [](const Image& a, const Image&) { return a.resize(a.width() / 4, a.height() / 4); }, 1},
+      {"resize-bicubic", [](const Image& a, const Image&) {
+         return a.resize(a.width() / 2, a.height() / 2, "bicubic"); }, 1},
+      {"resize-lanczos", [](const Image& a, const Image&) {
+         return a.resize(a.width() / 2, a.height() / 2, "lanczos"); }, 1},
+      {"pyramid-thumbnail", [](const Image& a, const Image&) {
+         return ImagePyramid(a).resize(a.width() / 8, a.height() / 8); }, 1},
+      {"flipHorizontal", [](const Image& a, const Image&) { return a.flipHorizontal(); }, 1},
+      {"flipVertical", [](const Image& a, const Image&) { return a.flipVertical(); }, 1},
+      {"rotate90", [](const Image& a, const Image&) { return a.rotate90(); }, 1},
+      {"subimage", [](const Image& a, const Image&) { return a.subimage(a.width() / 4, a.height() / 4, a.width() / 2, a.height() / 2); }, 1},
+      {"swirl", [](const Image& a, const Image&) { return a.swirl(); }, 1},
+      {"add", [](const Image& a, const Image& b) { return a.add(b); }, 2},
+      {"subtract", [](const Image& a, const Image& b) { return a.subtract(b); }, 2},
+      {"multiply", [](const Image& a, const Image& b) { return a.multiply(b); }, 2},
+      {"difference", [](const Image& a, const Image& b) { return a.difference(b); }, 2},
+      {"lightest", [](const Image& a, const Image& b) { return a.lightest(b); }, 2},
+      {"darkest", [](const Image& a, const Image& b) { return a.darkest(b); }, 2},
+      {"alphaBlend", [](const Image& a, const Image& b) { return a.alphaBlend(b, 0.25f); }, 2},
+      {"gammaCorrect", [](const Image& a, const Image&) { return a.gammaCorrect(0.8f); }, 1},
+      {"invert", [](const Image& a, const Image&) { return a.invert(); }, 1},
+      {"grayscale", [](const Image& a, const Image&) { return a.grayscale(); }, 1},
+      {"colorJitter", [](const Image& a, const Image&) { return a.colorJitter(100); }, 1},
+      {"bitmap", [](const Image& a, const Image&) { return a.bitmap(10); }, 1},
+      {"fill", [white, orange](const Image& a, const Image&) { return a.fill(white, orange); }, 1},
+      {"blur", [](const Image& a, const Image&) { return a.blur(); }, 1},
+      {"boxBlur", [](const Image& a, const Image&) { return a.boxBlur(16); }, 1},
+      {"blurGaussian", [](const Image& a, const Image&) { return a.blurGaussian(); }, 1},
+      {"blurGaussian-separable", [](const Image& a, const Image&) { return a.blurGaussian(2.0f, "separable"); }, 1},
+      {"glow", [](const Image& a, const Image&) { return a.glow(); }, 1},
+      {"border", [orange](const Image& a, const Image&) { return a.border(orange); }, 1},
+      {"sobel", [](const Image& a, const Image&) { return a.sobel(); }, 1},
+      {"sobel-fast", [](const Image& a, const Image&) { return a.sobel("fast"); }, 1},
+      {"glitch", [](const Image& a, const Image&) { return a.glitch(); }, 1},
+      {"painterly", [](const Image& a, const Image&) { return a.painterly(); }, 1},
+      {"distort", [](const Image& a, const Image&) { return a.distort("horizontal"); }, 1},
+      {"gradient", [orange](const Image& a, const Image&) { return a.gradient("vertical", orange); }, 1},
+      {"sharpen", [](const Image& a, const Image&) { return a.sharpen(); }, 1},
+      {"brighten", [](const Image& a, const Image&) { return a.brighten(20); }, 1},
+      {"dim", [](const Image& a, const Image&) { return a.dim(20); }, 1},
+      {"toPlanar", [](const Image& a, const Image&) { return a.toLayout(Layout::Planar); }, 1},
+      {"toInterleaved", [](const Image& a, const Image&) {
+         return a.toLayout(Layout::Interleaved); }, 1, Layout::Planar},
+      {"swirl-planar", [](const Image& a, const Image&) { return a.swirl(); }, 1, Layout::Planar},
+      {"blur-planar", [](const Image& a, const Image&) { return a.blur(); }, 1, Layout::Planar},
+      {"blurGaussian-planar", [](const Image& a, const Image&) { return a.blurGaussian(); }, 1, Layout::Planar},
+      {"blurGaussian-separable-planar", [](const Image& a, const Image&) {
+         return a.blurGaussian(2.0f, "separable"); }, 1, Layout::Planar},
+      {"sobel-planar", [](const Image& a, const Image&) { return a.sobel(); }, 1, Layout::Planar},
+      {"sobel-gray8", [](const Image& a, const Image&) { return BasicImage<Gray8>(a).sobel().toImage(); }, 1},
+      {"blurGaussian-rgb16", [](const Image& a, const Image&) {
+         return BasicImage<RGB16>(a).blurGaussian().toImage(); }, 1},
+      {"glow-float32x3", [](const Image& a, const Image&) { return BasicImage<Float32x3>(a).glow().toImage(); }, 1},
+      {"convolve-box3", [](const Image& a, const Image&) { return convolve<kernels::Box3>(a); }, 1},
+      {"convolve-gaussian5", [](const Image& a, const Image&) {
+         return convolve<kernels::Gaussian5>(a, Border::Mirror); }, 1},
+      {"convolve-sobel", [](const Image& a, const Image&) {
+         return convolveMagnitude<kernels::SobelX, kernels::SobelY>(a, Border::Constant, 0); }, 1},
+      {"convolve-disk9-direct", [](const Image& a, const Image&) {
+         return a.convolve(disk(9), 9, 9, "direct"); }, 1},
+      {"convolve-disk9-fft", [](const Image& a, const Image&) { return a.convolve(disk(9), 9, 9, "fft"); }, 1},
+      {"convolve-disk65", [](const Image& a, const Image&) { return a.convolve(disk(65), 65, 65); }, 1},
+      {"deepFry", [](const Image& a, const Image&) { return a.deepFry(); }, 1},
+   };
+}
+
+// smooth gradients with some noise, so that edge and blur operators see
+// both flat areas and detail; seed varies the pattern
+static Image synthetic(int width, int height, unsigned int seed)
+{
+   Image image(width, height, false);
+   unsigned char* data = image.data();
+   unsigned int state = seed * 2654435761u + 1;
+   for (int i = 0; i < height; i++) {
+      for (int j = 0; j < width; j++) {
+         state = state * 1664525u + 1013904223u;
+         int noise = (state >> 24) & 31;
+         unsigned char* px = data + ((size_t) i * width + j) * 3;
+         px[0] = (unsigned char) (j * 255 / max(width - 1, 1) * 7 / 8 + noise);
+         px[1] = (unsigned char) (i * 255 / max(height - 1, 1) * 7 / 8 + noise);
+         px[2] = (unsigned char) (((i / 32 + j / 32) % 2) * 200 + noise);
+      }
+   }
+   return image;
+}
+
+static Result measure(const Benchmark& benchmark, const Image& first, const Image& second,
+   int warmup, int reps)
+{
+   typedef chrono::steady_clock Clock;
+   for (int r = 0; r < warmup; r++) {
+      benchmark.run(first, second);
+   }
+   vector<double> times;
+   double outputBytes = 0;
+   for (int r = 0; r < reps; r++) {
+      Clock::time_point start = Clock::now();
+      Image output = benchmark.run(first, second);
+      times.push_back(chrono::duration<double, milli>(Clock::now() - start).count());
+      outputBytes = 3.0 * output.width() * output.height();
+   }
+
+   Result result;
+   result.name = benchmark.name;
+   result.width = first.width();
+   result.height = first.height();
+   sort(times.begin(), times.end());
+   result.minMs = times[0];
+   result.medianMs = reps % 2 ? times[reps / 2] : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+   double sum = 0;
+   for (double t : times) {
+      sum += t;
+   }
+   result.meanMs = sum / reps;
+   double squares = 0;
+   for (double t : times) {
+      squares += (t - result.meanMs) * (t - result.meanMs);
+   }
+   result.stddevMs = reps > 1 ? sqrt(squares / (reps - 1)) : 0;
+   double seconds = max(result.medianMs, 1e-6) / 1000;
+   double pixels = (double) first.width() * first.height();
+   result.megapixelsPerSecond = pixels / 1e6 / seconds;
+   result.bytesPerSecond = (3.0 * pixels * benchmark.numInputs + outputBytes) / seconds;
+   return result;
+}
+
+static void printTable(const vector<Result>& results)
+{
+   cout << left << setw(24) << "operator" << setw(12) << "size" << right
+      << setw(12) << "median ms" << setw(10) << "+/- ms" << setw(10) << "MP/s"
+      << setw(10) << "MB/s" << endl;
+   for (const Result& r : results) {
+      ostringstream size;
+      size << r.width << "x" << r.height;
+      cout << left << setw(24) << r.name << setw(12) << size.str() << right << fixed
+         << setprecision(3) << setw(12) << r.medianMs << setw(10) << r.stddevMs
+         << setprecision(1) << setw(10) << r.megapixelsPerSecond
+         << setw(10) << r.bytesPerSecond / 1e6 << endl;
+      cout.unsetf(ios::fixed);
+   }
+}
+
+static void writeJson(ostream& out, const vector<Result>& results, int warmup, int reps)
+{
+   out << "{\n"
+      << "  \"threads\": " << numThreads() << ",\n"
+      << "  \"isa\": \"" << simd::isa() << "\",\n"
+      << "  \"warmup\": " << warmup << ",\n"
+      << "  \"repetitions\": " << reps << ",\n"
+      << "  \"results\": [";
+   out << setprecision(6);
+   for (size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      out << (i ? ",\n" : "\n")
+         << "    {\"operator\": \"" << r.name << "\", \"width\": " << r.width
+         << ", \"height\": " << r.height << ", \"min_ms\": " << r.minMs
+         << ", \"median_ms\": " << r.medianMs << ", \"mean_ms\": " << r.meanMs
+         << ", \"stddev_ms\": " << r.stddevMs
+         << ", \"megapixels_per_s\": " << r.megapixelsPerSecond
+         << ", \"bytes_per_s\": " << r.bytesPerSecond << "}";
+   }
+   out << "\n  ]\n}\n";
+}
+
+static void usage(const char* program)
+{
+   cerr << "usage: " << program << " [--sizes WxH,...] [--reps n] [--warmup n]"
+      << " [--filter name] [--json file | --json -]" << endl;
+   exit(1);
+}
+
+int main(int argc, char** argv)
+{
+   vector<pair<int, int>> sizes = {{256, 256}, {1024, 1024}, {1920, 1080}};
+   int reps = 5;
+   int warmup = 1;
+   string filter;
+   string jsonFile;
+   for (int i = 1; i < argc; i++) {
+      string option = argv[i];
+      if (i + 1 >= argc) {
+         usage(argv[0]);
+      }
+      string value = argv[++i];
+      if (option == "--sizes") {
+         sizes.clear();
+         istringstream list(value);
+         string item;
+         while (getline(list, item, ',')) {
+            int w = 0, h = 0;
+            char extra;
+            if (sscanf(item.c_str(), "%dx%d%c", &w, &h, &extra) != 2 || w <= 0 || h <= 0) {
+               cerr << "Invalid size " << item << "; expected WxH" << endl;
+               exit(1);
+            }
+            sizes.push_back({w, h});
+         }
+      } else if (option == "--reps") {
+         reps = atoi(value.c_str());
+      } else if (option == "--warmup") {
+         warmup = atoi(value.c_str());
+      } else if (option == "--filter") {
+         filter = value;
+      } else if (option == "--json") {
+         jsonFile = value;
+      } else {
+         usage(argv[0]);
+      }
+   }
+   if (reps < 1 || warmup < 0 || sizes.empty()) {
+      usage(argv[0]);
+   }
+
+   vector<Result> results;
+   for (const auto& size : sizes) {
+      Image first = synthetic(size.first, size.second, 1);
+      Image second = synthetic(size.first, size.second, 2);
+      Image firstPlanar = first.toLayout(Layout::Planar);
+      Image secondPlanar = second.toLayout(Layout::Planar);
+      for (const Benchmark& benchmark : benchmarks()) {
+         if (benchmark.name.find(filter) == string::npos) {
+            continue;
+         }
+         bool planar = benchmark.layout == Layout::Planar;
+         results.push_back(measure(benchmark, planar ? firstPlanar : first,
+            planar ? secondPlanar : second, warmup, reps));
+         if (jsonFile != "-") {
+            cerr << "." << flush;
+         }
+      }
+   }
+   if (jsonFile != "-") {
+      cerr << endl;
+      printTable(results);
+   }
+
+   if (jsonFile == "-") {
+      writeJson(cout, results, warmup, reps);
+   } else if (!jsonFile.empty()) {
+      ofstream out(jsonFile);
+      writeJson(out, results, warmup, reps);
+      if (!out) {
+         cerr << "Cannot write " << jsonFile << endl;
+         return 1;
+      }
+   }
+   return 0;
+}
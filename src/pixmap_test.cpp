@@ -113,6 +113,10 @@ int main(int argc, char** argv)
    Image blurGaussian = image.blurGaussian();
    blurGaussian.save("../demo/earth-blurGaussian.png"); 
 
+   // box blur of any radius
+   Image boxBlur = image.boxBlur(8);
+   boxBlur.save("../demo/earth-boxBlur.png"); 
+
    // glow
    Image glow = image.glow();
    glow.save("../demo/earth-glow.png"); 
@@ -232,5 +236,25 @@ int main(int argc, char** argv)
    meme.load("../images/meme.jpg");
    Image memeDeepFried = meme.deepFry();
    memeDeepFried.save("../demo/meme-deepfried.png");
+
+   // test: saving over the file an image is mapped from keeps both intact
+   Image feep;
+   feep.load("../images/feep.png");
+   feep.save("../demo/feep-test-overwrite.ppm");
+   Image mapped;
+   mapped.load("../demo/feep-test-overwrite.ppm");
+   mapped.swirlInPlace();
+   mapped.save("../demo/feep-test-overwrite.ppm");
+   Image reloaded;
+   reloaded.load("../demo/feep-test-overwrite.ppm");
+   Image expected = feep.swirl();
+   bool intact = reloaded.width() == expected.width() && reloaded.height() == expected.height();
+   for (int i = 0; intact && i < expected.height(); i++) {
+      for (int j = 0; j < expected.width(); j++) {
+         Pixel a = expected.get(i, j), b = mapped.get(i, j), c = reloaded.get(i, j);
+         intact = intact && a.r == b.r && a.g == b.g && a.b == b.b && a.r == c.r && a.g == c.g && a.b == c.b;
+      }
+   }
+   cout << "save over source: " << (intact ? "ok" : "FAILED") << endl;
 }
 
@@ -0,0 +1,207 @@
+/**
+ * Implementation of the parallel PNG encoder
+ *
+ * @file png.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "png.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "bufferpool.h"
+#include "deflate.h"
+#include "threadpool.h"
+
+namespace agl {
+namespace png {
+
+// filtered bytes per deflate chunk; smaller chunks spread better over
+// threads but each one restarts the Huffman statistics
+static const size_t CHUNK_BYTES = 256 * 1024;
+
+static const int DEFAULT_LEVEL = 6;
+
+static int defaultLevel() {
+   const char* env = getenv("AGL_PNG_LEVEL");
+   if (env && *env >= '0' && *env <= '9') {
+      return atoi(env);
+   }
+   return DEFAULT_LEVEL;
+}
+
+static std::atomic<int>& activeLevel() {
+   static std::atomic<int> current(defaultLevel());
+   return current;
+}
+
+int level() {
+   return activeLevel().load();
+}
+
+void setLevel(int level) {
+   activeLevel() = std::max(0, std::min(level, 9));
+}
+
+static int paeth(int a, int b, int c) {
+   int p = a + b - c;
+   int pa = abs(p - a);
+   int pb = abs(p - b);
+   int pc = abs(p - c);
+   if (pa <= pb && pa <= pc) {
+      return a;
+   }
+   return pb <= pc ? b : c;
+}
+
+// filter row (with prior, the row above, or NULL for the first row) into
+// out, which receives the filter type byte then rowSize filtered bytes.
+// Tries each filter and keeps the one with the smallest sum of absolute
+// values, the usual heuristic for picking the most compressible one.
+static void filterRow(const unsigned char* row, const unsigned char* prior,
+   int rowSize, bool adaptive, unsigned char* out, std::vector<unsigned char>& scratch) {
+   out[0] = 0;
+   memcpy(out + 1, row, rowSize);
+   if (!adaptive) {
+      return;
+   }
+   scratch.resize(rowSize);
+   long bestCost = 0;
+   for (int i = 0; i < rowSize; i++) {
+      bestCost += abs((signed char) row[i]);
+   }
+   for (int type = 1; type <= 4; type++) {
+      long cost = 0;
+      for (int i = 0; i < rowSize; i++) {
+         int a = i >= 3 ? row[i - 3] : 0;
+         int b = prior ? prior[i] : 0;
+         int c = prior && i >= 3 ? prior[i - 3] : 0;
+         int predicted = 0;
+         switch (type) {
+            case 1: predicted = a; break;
+            case 2: predicted = b; break;
+            case 3: predicted = (a + b) >> 1; break;
+            case 4: predicted = paeth(a, b, c); break;
+         }
+         scratch[i] = (unsigned char) (row[i] - predicted);
+         cost += abs((signed char) scratch[i]);
+      }
+      if (cost < bestCost) {
+         bestCost = cost;
+         out[0] = type;
+         memcpy(out + 1, &scratch[0], rowSize);
+      }
+   }
+}
+
+static void put32(unsigned char* bytes, unsigned int value) {
+   bytes[0] = value >> 24;
+   bytes[1] = value >> 16;
+   bytes[2] = value >> 8;
+   bytes[3] = value;
+}
+
+// write a chunk whose data is the concatenation of the given pieces
+static bool writeChunk(FILE* file, const char* type,
+   const std::vector<std::pair<const unsigned char*, size_t>>& pieces) {
+   size_t length = 0;
+   for (const auto& piece : pieces) {
+      length += piece.second;
+   }
+   unsigned char head[8];
+   put32(head, (unsigned int) length);
+   memcpy(head + 4, type, 4);
+   unsigned int crc = deflate::crc32(head + 4, 4);
+   bool ok = fwrite(head, 1, 8, file) == 8;
+   for (const auto& piece : pieces) {
+      crc = deflate::crc32(piece.first, piece.second, crc);
+      ok = ok && fwrite(piece.first, 1, piece.second, file) == piece.second;
+   }
+   unsigned char tail[4];
+   put32(tail, crc);
+   return ok && fwrite(tail, 1, 4, file) == 4;
+}
+
+bool write(const std::string& filename, int width, int height, const unsigned char* data) {
+   if (width <= 0 || height <= 0) {
+      return false;
+   }
+   int compression = level();
+   int rowSize = width * 3;
+   size_t stride = (size_t) rowSize + 1;
+   PoolVector<unsigned char> filtered(stride * height);
+   parallelRows(height, width, [&](int firstRow, int lastRow) {
+      std::vector<unsigned char> scratch;
+      for (int i = firstRow; i < lastRow; i++) {
+         const unsigned char* row = data + (size_t) i * rowSize;
+         const unsigned char* prior = i > 0 ? row - rowSize : NULL;
+         filterRow(row, prior, rowSize, compression > 0, &filtered[i * stride], scratch);
+      }
+   });
+
+   // deflate the chunks independently, each with its own checksum
+   size_t total = filtered.size();
+   int numChunks = (int) ((total + CHUNK_BYTES - 1) / CHUNK_BYTES);
+   std::vector<std::vector<unsigned char>> chunks(numChunks);
+   std::vector<unsigned int> adlers(numChunks);
+   parallelFor(0, numChunks, 1, [&](int first, int last) {
+      for (int c = first; c < last; c++) {
+         size_t start = c * CHUNK_BYTES;
+         size_t size = std::min(CHUNK_BYTES, total - start);
+         deflate::compress(&filtered[start], size, start, compression,
+            c == numChunks - 1, chunks[c]);
+         adlers[c] = deflate::adler32(&filtered[start], size);
+      }
+   });
+   unsigned int adler = adlers[0];
+   for (int c = 1; c < numChunks; c++) {
+      size_t size = std::min(CHUNK_BYTES, total - c * CHUNK_BYTES);
+      adler = deflate::adler32Combine(adler, adlers[c], size);
+   }
+
+   FILE* file = fopen(filename.c_str(), "wb");
+   if (!file) {
+      std::cerr << "Cannot create " << filename << std::endl;
+      return false;
+   }
+   static const unsigned char SIGNATURE[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+   unsigned char header[13];
+   put32(header, width);
+   put32(header + 4, height);
+   // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace
+   header[8] = 8;
+   header[9] = 2;
+   header[10] = header[11] = header[12] = 0;
+   // zlib header: deflate with a 32 KB window, FLEVEL hinting the level
+   unsigned char zlibHeader[2] = {0x78, compression <= 1 ? (unsigned char) 0x01 :
+      compression <= 5 ? (unsigned char) 0x5e : compression == 6 ? (unsigned char) 0x9c : (unsigned char) 0xda};
+   unsigned char trailer[4];
+   put32(trailer, adler);
+
+   bool ok = fwrite(SIGNATURE, 1, 8, file) == 8 &&
+      writeChunk(file, "IHDR", {{header, 13}});
+   // one IDAT per chunk, so no CRC has to span threads
+   for (int c = 0; c < numChunks && ok; c++) {
+      std::vector<std::pair<const unsigned char*, size_t>> pieces;
+      if (c == 0) {
+         pieces.push_back({zlibHeader, 2});
+      }
+      pieces.push_back({chunks[c].data(), chunks[c].size()});
+      if (c == numChunks - 1) {
+         pieces.push_back({trailer, 4});
+      }
+      ok = writeChunk(file, "IDAT", pieces);
+   }
+   ok = ok && writeChunk(file, "IEND", {});
+   return fclose(file) == 0 && ok;
+}
+
+}  // namespace png
+}  // namespace agl
@@ -0,0 +1,43 @@
+/**
+ * PNG encoder that filters and compresses bands of rows on the thread
+ * pool and joins them into a single zlib stream
+ *
+ * @file png.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_PNG_H_
+#define AGL_PNG_H_
+
+#include <string>
+
+namespace agl {
+namespace png {
+
+/**
+ * @brief Return the compression level used by write(), from 0 (no
+ * compression, fastest) to 9 (smallest files, slowest)
+ *
+ * The default is 6, unless the AGL_PNG_LEVEL environment variable gives
+ * another level.
+ */
+int level();
+
+/**
+ * @brief Set the compression level used by write(), clamped to 0 to 9
+ */
+void setLevel(int level);
+
+/**
+ * @brief Write width * height RGB pixels to filename as a PNG file
+ *
+ * Rows are filtered, and the filtered bytes are deflated in chunks, in
+ * parallel. Each chunk may refer back into the end of the one before it,
+ * so the files are barely larger than those of a serial encoder.
+ */
+bool write(const std::string& filename, int width, int height, const unsigned char* data);
+
+}  // namespace png
+}  // namespace agl
+#endif  // AGL_PNG_H_
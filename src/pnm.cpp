@@ -0,0 +1,129 @@
+/**
+ * Implementation of the PPM and PAM headers
+ *
+ * @file pnm.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "pnm.h"
+
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace agl {
+namespace pnm {
+
+// read a non-negative decimal, skipping whitespace and # comments; the
+// single whitespace character after the number is consumed. Values past
+// INT_MAX fail.
+static bool readInt(const std::function<int()>& next, int& value) {
+   int c = next();
+   while (c != EOF && (isspace(c) || c == '#')) {
+      if (c == '#') {
+         while (c != EOF && c != '\n') {
+            c = next();
+         }
+      }
+      c = next();
+   }
+   if (c == EOF || !isdigit(c)) {
+      return false;
+   }
+   value = 0;
+   while (c != EOF && isdigit(c)) {
+      if (value > (INT_MAX - (c - '0')) / 10) {
+         return false;
+      }
+      value = value * 10 + (c - '0');
+      c = next();
+   }
+   return c != EOF && isspace(c);
+}
+
+// read the next line, without the newline; false at the end of the file
+static bool readLine(const std::function<int()>& next, std::string& line) {
+   line.clear();
+   int c = next();
+   while (c != EOF && c != '\n') {
+      line += (char) c;
+      c = next();
+   }
+   return c != EOF;
+}
+
+// parse the "TOKEN value" lines of a PAM header, up to ENDHDR
+static bool parsePam(const std::function<int()>& next, Header& header) {
+   int maxValue = 0;
+   std::string line;
+   while (readLine(next, line)) {
+      std::istringstream fields(line);
+      std::string token;
+      if (!(fields >> token) || token[0] == '#') {
+         continue;
+      }
+      if (token == "ENDHDR") {
+         return header.width > 0 && header.height > 0 && maxValue == 255 &&
+            (header.depth == 3 || header.depth == 4);
+      }
+      // a value that is missing or past INT_MAX fails the header
+      bool read = true;
+      if (token == "WIDTH") {
+         read = (bool) (fields >> header.width);
+      } else if (token == "HEIGHT") {
+         read = (bool) (fields >> header.height);
+      } else if (token == "DEPTH") {
+         read = (bool) (fields >> header.depth);
+      } else if (token == "MAXVAL") {
+         read = (bool) (fields >> maxValue);
+      }
+      if (!read) {
+         return false;
+      }
+   }
+   return false;
+}
+
+bool parseHeader(const std::function<int()>& next, Header& header) {
+   size_t consumed = 0;
+   std::function<int()> counted = [&]() {
+      int c = next();
+      if (c != EOF) {
+         consumed++;
+      }
+      return c;
+   };
+   header.width = header.height = header.depth = 0;
+   if (counted() != 'P') {
+      return false;
+   }
+   int kind = counted();
+   bool ok = false;
+   if (kind == '6') {
+      int maxValue = 0;
+      header.depth = 3;
+      ok = readInt(counted, header.width) && readInt(counted, header.height) &&
+         readInt(counted, maxValue) && maxValue == 255 && header.width > 0 && header.height > 0;
+   } else if (kind == '7') {
+      ok = counted() == '\n' && parsePam(counted, header);
+   }
+   header.dataOffset = consumed;
+   return ok;
+}
+
+std::string header(int width, int height, bool pam) {
+   std::ostringstream out;
+   if (pam) {
+      out << "P7\nWIDTH " << width << "\nHEIGHT " << height
+          << "\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n";
+   } else {
+      out << "P6\n" << width << " " << height << "\n255\n";
+   }
+   return out.str();
+}
+
+}  // namespace pnm
+}  // namespace agl
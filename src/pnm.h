@@ -0,0 +1,45 @@
+/**
+ * Headers of the binary PPM (P6) and PAM (P7) formats
+ *
+ * @file pnm.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_PNM_H_
+#define AGL_PNM_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace agl {
+namespace pnm {
+
+/**
+ * @brief Size and layout of an 8-bit PPM or PAM image
+ */
+struct Header {
+    int width;
+    int height;
+    // channels per pixel: 3 for PPM and RGB PAM, 4 for RGB_ALPHA PAM
+    int depth;
+    // bytes before the first pixel
+    size_t dataOffset;
+};
+
+/**
+ * @brief Parse a P6 or P7 header with a maximum value of 255
+ * @param next Returns the next byte of the file, or EOF at the end
+ */
+bool parseHeader(const std::function<int()>& next, Header& header);
+
+/**
+ * @brief Return the header of a width by height RGB image; PAM if pam
+ * is set, otherwise PPM
+ */
+std::string header(int width, int height, bool pam);
+
+}  // namespace pnm
+}  // namespace agl
+#endif  // AGL_PNM_H_
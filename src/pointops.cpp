@@ -0,0 +1,93 @@
+/**
+ * Implementation of the point-wise pixel kernels
+ *
+ * @file pointops.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "pointops.h"
+
+#include "simd.h"
+#include "threadpool.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+namespace agl {
+namespace pointops {
+
+// pixels per block handed to a thread
+static const int BLOCK_PIXELS = 16384;
+
+void parallelApply(Image& image,
+      const std::function<void(unsigned char* data, int first, int numPixels)>& kernel) {
+   unsigned char* data = image.data();
+   parallelFor(0, image.width() * image.height(), BLOCK_PIXELS, [&](int first, int last) {
+      kernel(data + first * 3, first, last - first);
+   });
+}
+
+void parallelApplyPlanes(Image& image, const std::function<void(unsigned char* r,
+      unsigned char* g, unsigned char* b, int first, int numPixels)>& kernel) {
+   size_t planeSize = (size_t) image.width() * image.height();
+   unsigned char* data = image.data();
+   parallelFor(0, image.width() * image.height(), BLOCK_PIXELS, [&](int first, int last) {
+      kernel(data + first, data + planeSize + first, data + 2 * planeSize + first, first, last - first);
+   });
+}
+
+void swirl(unsigned char* data, int numPixels) {
+   for (int idx = 0; idx < numPixels * 3; idx += 3) {
+      unsigned char red = data[idx];
+      data[idx] = data[idx + 1];
+      data[idx + 1] = data[idx + 2];
+      data[idx + 2] = red;
+   }
+}
+
+void grayscale(unsigned char* data, int numPixels) {
+   for (int idx = 0; idx < numPixels * 3; idx += 3) {
+      float avg = ((0.3 * data[idx]) + (0.59 * data[idx + 1]) + (0.11 * data[idx + 2])) / 3;
+      data[idx] = data[idx + 1] = data[idx + 2] = avg;
+   }
+}
+
+void grayscalePlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels) {
+   for (int idx = 0; idx < numPixels; idx++) {
+      float avg = ((0.3 * r[idx]) + (0.59 * g[idx]) + (0.11 * b[idx])) / 3;
+      r[idx] = g[idx] = b[idx] = avg;
+   }
+}
+
+void fill(unsigned char* data, int numPixels, const Pixel& a, const Pixel& b) {
+   for (int idx = 0; idx < numPixels * 3; idx += 3) {
+      int diffR = abs(a.r - data[idx]);
+      int diffG = abs(a.g - data[idx + 1]);
+      int diffB = abs(a.b - data[idx + 2]);
+      if (diffR < 100 && diffG < 100 && diffB < 100) {
+         data[idx] = b.r;
+         data[idx + 1] = b.g;
+         data[idx + 2] = b.b;
+      }
+   }
+}
+
+void fillPlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels,
+      const Pixel& a, const Pixel& c) {
+   for (int idx = 0; idx < numPixels; idx++) {
+      if (abs(a.r - r[idx]) < 100 && abs(a.g - g[idx]) < 100 && abs(a.b - b[idx]) < 100) {
+         r[idx] = c.r;
+         g[idx] = c.g;
+         b[idx] = c.b;
+      }
+   }
+}
+
+void alphaBlend(unsigned char* data, int numPixels,
+      const Image& other, size_t first, float alpha) {
+   simd::alphaBlend(data, other.data() + first * 3, data, numPixels * 3, simd::blendWeight(alpha));
+}
+
+}  // namespace pointops
+}  // namespace agl
@@ -0,0 +1,53 @@
+/**
+ * Point-wise pixel kernels shared by Image and Pipeline
+ *
+ * Each kernel updates numPixels RGB pixels in place, starting at data.
+ * Operators that map each channel on its own are Luts instead (lut.h).
+ * Kernels that combine two images read the matching pixels of the other
+ * image starting at pixel index first. The *Planes kernels take the
+ * planes of a planar image instead.
+ *
+ * @file pointops.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_POINTOPS_H_
+#define AGL_POINTOPS_H_
+
+#include <functional>
+
+#include "image.h"
+
+namespace agl {
+namespace pointops {
+
+// Call kernel(data, first, numPixels) on blocks covering every pixel of
+// image, in parallel; data points at pixel first of image
+void parallelApply(Image& image,
+   const std::function<void(unsigned char* data, int first, int numPixels)>& kernel);
+
+// Call kernel(r, g, b, first, numPixels) on blocks covering every pixel of
+// a planar image, in parallel; r, g and b point at pixel first of each plane
+void parallelApplyPlanes(Image& image, const std::function<void(unsigned char* r,
+   unsigned char* g, unsigned char* b, int first, int numPixels)>& kernel);
+
+// rotate the channels: r <- g, g <- b, b <- r
+void swirl(unsigned char* data, int numPixels);
+
+// replace each pixel with its weighted luminance
+void grayscale(unsigned char* data, int numPixels);
+void grayscalePlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels);
+
+// replace pixels close to color a with color b
+void fill(unsigned char* data, int numPixels, const Pixel& a, const Pixel& b);
+void fillPlanes(unsigned char* r, unsigned char* g, unsigned char* b, int numPixels,
+   const Pixel& a, const Pixel& c);
+
+// x = x * (1 - alpha) + other.x * alpha, rounded to the nearest 1/256 of alpha
+void alphaBlend(unsigned char* data, int numPixels,
+   const Image& other, size_t first, float alpha);
+
+}  // namespace pointops
+}  // namespace agl
+#endif  // AGL_POINTOPS_H_
@@ -0,0 +1,83 @@
+/**
+ * Implementation of the image pyramid
+ *
+ * @file pyramid.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "pyramid.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "trace.h"
+
+namespace agl {
+
+ImagePyramid::ImagePyramid(const Image& image) {
+   this->_levels.emplace_back(new Image(image));
+   this->init();
+}
+
+ImagePyramid::ImagePyramid(Image&& image) {
+   this->_levels.emplace_back(new Image(std::move(image)));
+   this->init();
+}
+
+void ImagePyramid::init() {
+   int w = this->_levels[0]->width();
+   int h = this->_levels[0]->height();
+   this->_widths.push_back(w);
+   this->_heights.push_back(h);
+   while (w > 1 || h > 1) {
+      w = std::max(w / 2, 1);
+      h = std::max(h / 2, 1);
+      this->_widths.push_back(w);
+      this->_heights.push_back(h);
+   }
+   this->_levels.resize(this->_widths.size());
+}
+
+int ImagePyramid::numLevels() const {
+   return (int) this->_widths.size();
+}
+
+int ImagePyramid::width(int i) const {
+   return this->_widths[i];
+}
+
+int ImagePyramid::height(int i) const {
+   return this->_heights[i];
+}
+
+const Image& ImagePyramid::level(int i) const {
+   assert(i >= 0 && i < this->numLevels());
+   std::lock_guard<std::mutex> lock(this->_mutex);
+   int built = i;
+   while (!this->_levels[built]) {
+      built--;
+   }
+   for (built++; built <= i; built++) {
+      trace::Scope scope("pyramidLevel", this->_widths[built], this->_heights[built]);
+      scope.arg("level", built);
+      this->_levels[built].reset(new Image(this->_levels[built - 1]->resize(
+         this->_widths[built], this->_heights[built], "area")));
+   }
+   return *this->_levels[i];
+}
+
+int ImagePyramid::levelFor(int width, int height) const {
+   int i = 0;
+   while (i + 1 < this->numLevels() && this->_widths[i + 1] >= width &&
+      this->_heights[i + 1] >= height) {
+      i++;
+   }
+   return i;
+}
+
+Image ImagePyramid::resize(int width, int height, const std::string& filter) const {
+   return this->level(this->levelFor(width, height)).resize(width, height, filter);
+}
+
+}  // namespace agl
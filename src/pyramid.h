@@ -0,0 +1,85 @@
+/**
+ * Image pyramid of successively halved levels, for repeated downscales of
+ * one image
+ *
+ * @file pyramid.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_PYRAMID_H_
+#define AGL_PYRAMID_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+namespace agl {
+
+/**
+ * @brief An image and its halvings, each made from the one before on
+ * first use
+ *
+ * Level 0 is the image; level i + 1 averages 2x2 blocks of level i, with
+ * sides rounded down, and the last level has both sides 1. A resize
+ * starts from the smallest level that is still at least the requested
+ * size, so after the first few levels are built, a thumbnail costs about
+ * its own size rather than the source's.
+ *
+ * Levels are built under a lock, so one pyramid can be used from several
+ * threads. References to levels stay valid for the pyramid's lifetime.
+ *
+ * @verbatim
+ * ImagePyramid pyramid(photo);
+ * Image preview = pyramid.resize(800, 600);
+ * Image thumbnail = pyramid.resize(160, 120);
+ * @endverbatim
+ */
+class ImagePyramid {
+ public:
+  explicit ImagePyramid(const Image& image);
+  explicit ImagePyramid(Image&& image);
+
+  // return the number of levels, at least 1
+  int numLevels() const;
+
+  // return the size of level i, whether or not it is built yet
+  int width(int i) const;
+  int height(int i) const;
+
+  /**
+   * @brief Return level i, building it and the levels above it if needed
+   */
+  const Image& level(int i) const;
+
+  /**
+   * @brief Return the smallest level with both sides at least width x
+   * height, or 0 if the image itself is smaller
+   */
+  int levelFor(int width, int height) const;
+
+  /**
+   * @brief Resize to width x height with a filter of Image::resize,
+   * starting from levelFor(width, height)
+   */
+  Image resize(int width, int height, const std::string& filter = "auto") const;
+
+ private:
+  ImagePyramid(const ImagePyramid&) = delete;
+  ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+  // compute the size of every level
+  void init();
+
+  std::vector<int> _widths;
+  std::vector<int> _heights;
+  // built levels; the rest are null
+  mutable std::vector<std::unique_ptr<Image>> _levels;
+  mutable std::mutex _mutex;
+};
+
+}  // namespace agl
+#endif  // AGL_PYRAMID_H_
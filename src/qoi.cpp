@@ -0,0 +1,296 @@
+/**
+ * Implementation of the QOI encoder and decoder
+ *
+ * @file qoi.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "qoi.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace agl {
+
+static const unsigned char OP_INDEX = 0x00;
+static const unsigned char OP_DIFF = 0x40;
+static const unsigned char OP_LUMA = 0x80;
+static const unsigned char OP_RUN = 0xc0;
+static const unsigned char OP_RGB = 0xfe;
+static const unsigned char OP_RGBA = 0xff;
+static const unsigned char OP_MASK = 0xc0;
+
+static const int HEADER_SIZE = 14;
+static const unsigned char END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+// longest run a single OP_RUN can encode
+static const int MAX_RUN = 62;
+
+// bytes buffered between file reads or writes
+static const size_t BUFFER_SIZE = 1 << 16;
+
+// slot of a pixel in the index of recently seen pixels
+static inline int hash(int r, int g, int b, int a) {
+   return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+}
+
+// read a big-endian 32 bit value
+static unsigned int read32(const unsigned char* bytes) {
+   return ((unsigned int) bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+// write a big-endian 32 bit value
+static void write32(unsigned char* bytes, unsigned int value) {
+   bytes[0] = value >> 24;
+   bytes[1] = value >> 16;
+   bytes[2] = value >> 8;
+   bytes[3] = value;
+}
+
+QoiReader::QoiReader() {
+   this->_file = NULL;
+   this->_width = 0;
+   this->_height = 0;
+   this->_row = 0;
+   this->_run = 0;
+   this->_pos = 0;
+   this->_end = 0;
+}
+
+QoiReader::~QoiReader() {
+   if (this->_file) {
+      fclose(this->_file);
+   }
+}
+
+bool QoiReader::open(const std::string& filename) {
+   this->_file = fopen(filename.c_str(), "rb");
+   if (!this->_file) {
+      std::cerr << "Cannot open " << filename << std::endl;
+      return false;
+   }
+   unsigned char header[HEADER_SIZE];
+   if (fread(header, 1, HEADER_SIZE, this->_file) != HEADER_SIZE ||
+       memcmp(header, "qoif", 4) != 0 || (header[12] != 3 && header[12] != 4)) {
+      std::cerr << filename << " is not a QOI file" << std::endl;
+      return false;
+   }
+   unsigned int width = read32(header + 4);
+   unsigned int height = read32(header + 8);
+   if (width == 0 || height == 0 || width > 0x7fffffff / 3 / height) {
+      std::cerr << filename << " has invalid dimensions" << std::endl;
+      return false;
+   }
+   this->_width = width;
+   this->_height = height;
+   this->_row = 0;
+   memset(this->_index, 0, sizeof(this->_index));
+   this->_prev[0] = this->_prev[1] = this->_prev[2] = 0;
+   this->_prev[3] = 255;
+   this->_run = 0;
+   this->_buffer.resize(BUFFER_SIZE);
+   this->_pos = this->_end = 0;
+   return true;
+}
+
+int QoiReader::width() const {
+   return this->_width;
+}
+
+int QoiReader::height() const {
+   return this->_height;
+}
+
+int QoiReader::next() {
+   if (this->_pos == this->_end) {
+      this->_pos = 0;
+      this->_end = fread(&this->_buffer[0], 1, this->_buffer.size(), this->_file);
+      if (this->_end == 0) {
+         return -1;
+      }
+   }
+   return this->_buffer[this->_pos++];
+}
+
+bool QoiReader::read(unsigned char* rows, int numRows) {
+   if (!this->_file || this->_row + numRows > this->_height) {
+      return false;
+   }
+   unsigned char* px = this->_prev;
+   int numPixels = numRows * this->_width;
+   auto truncated = [this]() {
+      std::cerr << "Unexpected end of QOI data at row " << this->_row << std::endl;
+      return false;
+   };
+   for (int idx = 0; idx < numPixels; idx++) {
+      if (this->_run > 0) {
+         this->_run--;
+      } else {
+         int b1 = this->next();
+         if (b1 < 0) {
+            return truncated();
+         }
+         if (b1 == OP_RGB || b1 == OP_RGBA) {
+            int channels = b1 == OP_RGB ? 3 : 4;
+            for (int c = 0; c < channels; c++) {
+               int value = this->next();
+               if (value < 0) {
+                  return truncated();
+               }
+               px[c] = value;
+            }
+         } else if ((b1 & OP_MASK) == OP_INDEX) {
+            memcpy(px, this->_index[b1], 4);
+         } else if ((b1 & OP_MASK) == OP_DIFF) {
+            px[0] += ((b1 >> 4) & 0x03) - 2;
+            px[1] += ((b1 >> 2) & 0x03) - 2;
+            px[2] += (b1 & 0x03) - 2;
+         } else if ((b1 & OP_MASK) == OP_LUMA) {
+            int b2 = this->next();
+            if (b2 < 0) {
+               return truncated();
+            }
+            int dg = (b1 & 0x3f) - 32;
+            px[0] += dg - 8 + ((b2 >> 4) & 0x0f);
+            px[1] += dg;
+            px[2] += dg - 8 + (b2 & 0x0f);
+         } else {
+            this->_run = b1 & 0x3f;
+         }
+         memcpy(this->_index[hash(px[0], px[1], px[2], px[3])], px, 4);
+      }
+      memcpy(rows + idx * 3, px, 3);
+   }
+   this->_row += numRows;
+   // the end marker must follow the last row, or bytes are missing
+   if (this->_row == this->_height) {
+      for (int k = 0; k < (int) sizeof(END_MARKER); k++) {
+         if (this->next() != END_MARKER[k]) {
+            return truncated();
+         }
+      }
+   }
+   return true;
+}
+
+QoiWriter::QoiWriter() {
+   this->_file = NULL;
+   this->_pos = 0;
+   this->_width = 0;
+   this->_run = 0;
+}
+
+QoiWriter::~QoiWriter() {
+   // removes the temporary file if finish was not reached
+   delete this->_file;
+}
+
+bool QoiWriter::open(const std::string& filename, int width, int height) {
+   // no pixel takes more than an OP_RGB, four bytes
+   size_t most = HEADER_SIZE + (size_t) width * height * 4 + sizeof(END_MARKER);
+   this->_file = MappedFile::create(filename, most);
+   this->_pos = 0;
+   if (!this->_file) {
+      std::cerr << "Cannot create " << filename << std::endl;
+      return false;
+   }
+   this->_width = width;
+   memset(this->_index, 0, sizeof(this->_index));
+   this->_prev[0] = this->_prev[1] = this->_prev[2] = 0;
+   this->_run = 0;
+   this->_buffer.reserve(BUFFER_SIZE + 16);
+   unsigned char header[HEADER_SIZE] = {'q', 'o', 'i', 'f'};
+   write32(header + 4, width);
+   write32(header + 8, height);
+   header[12] = 3;
+   header[13] = 0;
+   this->_buffer.assign(header, header + HEADER_SIZE);
+   return true;
+}
+
+bool QoiWriter::write(const unsigned char* rows, int numRows) {
+   if (!this->_file) {
+      return false;
+   }
+   std::vector<unsigned char>& out = this->_buffer;
+   unsigned char* prev = this->_prev;
+   int numPixels = numRows * this->_width;
+   for (int idx = 0; idx < numPixels; idx++) {
+      const unsigned char* px = rows + idx * 3;
+      if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+         this->_run++;
+         if (this->_run == MAX_RUN) {
+            out.push_back(OP_RUN | (this->_run - 1));
+            this->_run = 0;
+         }
+         continue;
+      }
+      if (this->_run > 0) {
+         out.push_back(OP_RUN | (this->_run - 1));
+         this->_run = 0;
+      }
+      // every pixel we write is opaque
+      int slot = hash(px[0], px[1], px[2], 255);
+      unsigned char* seen = this->_index[slot];
+      if (seen[0] == px[0] && seen[1] == px[1] && seen[2] == px[2] && seen[3] == 255) {
+         out.push_back(OP_INDEX | slot);
+      } else {
+         seen[0] = px[0];
+         seen[1] = px[1];
+         seen[2] = px[2];
+         seen[3] = 255;
+         signed char dr = px[0] - prev[0];
+         signed char dg = px[1] - prev[1];
+         signed char db = px[2] - prev[2];
+         signed char drg = dr - dg;
+         signed char dbg = db - dg;
+         if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+            out.push_back(OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+         } else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7) {
+            out.push_back(OP_LUMA | (dg + 32));
+            out.push_back((drg + 8) << 4 | (dbg + 8));
+         } else {
+            out.push_back(OP_RGB);
+            out.push_back(px[0]);
+            out.push_back(px[1]);
+            out.push_back(px[2]);
+         }
+      }
+      prev[0] = px[0];
+      prev[1] = px[1];
+      prev[2] = px[2];
+      if (out.size() >= BUFFER_SIZE && !this->flush()) {
+         return false;
+      }
+   }
+   return true;
+}
+
+bool QoiWriter::flush() {
+   size_t size = this->_buffer.size();
+   bool ok = size <= this->_file->size() - this->_pos;
+   if (ok && size > 0) {
+      memcpy(this->_file->data() + this->_pos, &this->_buffer[0], size);
+      this->_pos += size;
+   }
+   this->_buffer.clear();
+   return ok;
+}
+
+bool QoiWriter::finish() {
+   if (!this->_file) {
+      return false;
+   }
+   if (this->_run > 0) {
+      this->_buffer.push_back(OP_RUN | (this->_run - 1));
+      this->_run = 0;
+   }
+   this->_buffer.insert(this->_buffer.end(), END_MARKER, END_MARKER + 8);
+   bool ok = this->flush() && this->_file->commit(this->_pos);
+   delete this->_file;
+   this->_file = NULL;
+   return ok;
+}
+
+}  // namespace agl
@@ -0,0 +1,97 @@
+/**
+ * Streaming encoder and decoder for the QOI (Quite OK Image) format
+ *
+ * QOI is lossless and encodes each pixel from the previous one with a
+ * handful of byte-aligned operations, so it is many times faster than PNG.
+ * See https://qoiformat.org/qoi-specification.pdf
+ *
+ * @file qoi.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_QOI_H_
+#define AGL_QOI_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rowio.h"
+
+namespace agl {
+
+/**
+ * @brief Reads RGB or RGBA QOI files; alpha is dropped
+ */
+class QoiReader : public RowReader {
+ public:
+  QoiReader();
+  virtual ~QoiReader();
+
+  /**
+   * @brief Open filename and read its header
+   */
+  bool open(const std::string& filename);
+
+  virtual int width() const;
+  virtual int height() const;
+  virtual bool read(unsigned char* rows, int numRows);
+
+ private:
+  // return the next byte of the file, or -1 at the end
+  int next();
+
+  FILE* _file;
+  int _width;
+  int _height;
+  // rows read so far
+  int _row;
+  // decoder state: recently seen pixels, previous pixel and pending run
+  unsigned char _index[64][4];
+  unsigned char _prev[4];
+  int _run;
+  // buffered file bytes [_pos, _end)
+  std::vector<unsigned char> _buffer;
+  size_t _pos;
+  size_t _end;
+};
+
+/**
+ * @brief Writes RGB QOI files
+ *
+ * As PpmWriter, the bytes go to a temporary file that replaces filename
+ * on finish.
+ */
+class QoiWriter : public RowWriter {
+ public:
+  QoiWriter();
+  virtual ~QoiWriter();
+
+  /**
+   * @brief Start filename and write the header of a width by height image
+   */
+  bool open(const std::string& filename, int width, int height);
+
+  virtual bool write(const unsigned char* rows, int numRows);
+  virtual bool finish();
+
+ private:
+  // write out the buffered bytes
+  bool flush();
+
+  // mapped at the largest size the image can encode to, and cut to the
+  // bytes written on finish
+  MappedFile* _file;
+  // bytes of _file written so far
+  size_t _pos;
+  int _width;
+  // encoder state: recently seen pixels, previous pixel and pending run
+  unsigned char _index[64][4];
+  unsigned char _prev[3];
+  int _run;
+  // bytes not yet written to the file
+  std::vector<unsigned char> _buffer;
+};
+}  // namespace agl
+#endif  // AGL_QOI_H_
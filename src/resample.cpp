@@ -0,0 +1,290 @@
+/**
+ * Implementation of separable resampling
+ *
+ * @file resample.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "resample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "bufferpool.h"
+#include "simd.h"
+#include "threadpool.h"
+
+namespace agl {
+namespace resample {
+
+static const double PI = 3.14159265358979323846;
+
+// shrinking an axis by at least this much makes auto use area averaging
+static const double AREA_SCALE = 2.0;
+
+struct Filter {
+   const char* name;
+   // the kernel is zero outside [-support, support]
+   double support;
+   double (*kernel)(double x);
+};
+
+static double triangle(double x) {
+   x = std::fabs(x);
+   return x < 1 ? 1 - x : 0;
+}
+
+static double cubic(double x) {
+   const double a = -0.5;
+   x = std::fabs(x);
+   if (x < 1) {
+      return ((a + 2) * x - (a + 3)) * x * x + 1;
+   }
+   if (x < 2) {
+      return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a;
+   }
+   return 0;
+}
+
+static double sinc(double x) {
+   if (x == 0) {
+      return 1;
+   }
+   x *= PI;
+   return std::sin(x) / x;
+}
+
+static double lanczos(double x) {
+   return std::fabs(x) < 3 ? sinc(x) * sinc(x / 3) : 0;
+}
+
+static const Filter FILTERS[] = {
+   {"bilinear", 1, triangle},
+   {"bicubic", 2, cubic},
+   {"lanczos", 3, lanczos},
+};
+
+bool isFilter(const std::string& name) {
+   if (name == "nearest" || name == "area" || name == "auto") {
+      return true;
+   }
+   for (const Filter& filter : FILTERS) {
+      if (name == filter.name) {
+         return true;
+      }
+   }
+   return false;
+}
+
+// Float weights of every output, each window within [0, srcSize)
+struct Windows {
+   std::vector<int> first;
+   std::vector<std::vector<double>> weights;
+};
+
+// the source pixel whose center is nearest each output pixel's center
+static void nearestWindows(int srcSize, int dstSize, Windows& windows) {
+   double scale = (double) srcSize / dstSize;
+   for (int i = 0; i < dstSize; i++) {
+      windows.first[i] = std::min((int) ((i + 0.5) * scale), srcSize - 1);
+      windows.weights[i].assign(1, 1.0);
+   }
+}
+
+// output i covers source span [i * scale, (i + 1) * scale); each source
+// pixel is weighted by how much of it lies in the span
+static void areaWindows(int srcSize, int dstSize, Windows& windows) {
+   double scale = (double) srcSize / dstSize;
+   for (int i = 0; i < dstSize; i++) {
+      double left = i * scale;
+      double right = std::min((i + 1) * scale, (double) srcSize);
+      int first = std::min((int) left, srcSize - 1);
+      int last = std::max(std::min((int) std::ceil(right), srcSize), first + 1);
+      windows.first[i] = first;
+      windows.weights[i].clear();
+      for (int k = first; k < last; k++) {
+         windows.weights[i].push_back(std::max(std::min(k + 1.0, right) - std::max((double) k, left), 0.0));
+      }
+   }
+}
+
+// the kernel centered on each output pixel, stretched by the scale when
+// shrinking and cut off at the edges
+static void kernelWindows(int srcSize, int dstSize, const Filter& filter, Windows& windows) {
+   double scale = (double) srcSize / dstSize;
+   double stretch = std::max(scale, 1.0);
+   double support = filter.support * stretch;
+   for (int i = 0; i < dstSize; i++) {
+      double center = (i + 0.5) * scale;
+      int first = std::max((int) std::floor(center - support + 0.5), 0);
+      int last = std::min((int) std::floor(center + support + 0.5), srcSize);
+      if (last <= first) {
+         first = std::min(std::max((int) center, 0), srcSize - 1);
+         last = first + 1;
+      }
+      windows.first[i] = first;
+      windows.weights[i].clear();
+      for (int k = first; k < last; k++) {
+         windows.weights[i].push_back(filter.kernel((k + 0.5 - center) / stretch));
+      }
+   }
+}
+
+Coefficients coefficients(int srcSize, int dstSize, const std::string& filter) {
+   Coefficients c;
+   c.taps = 0;
+   if (srcSize <= 0 || dstSize <= 0) {
+      return c;
+   }
+   std::string name = filter;
+   if (name == "auto") {
+      name = srcSize >= AREA_SCALE * dstSize ? "area" : "bilinear";
+   }
+   Windows windows;
+   windows.first.resize(dstSize);
+   windows.weights.resize(dstSize);
+   if (name == "nearest") {
+      nearestWindows(srcSize, dstSize, windows);
+   } else if (name == "area") {
+      areaWindows(srcSize, dstSize, windows);
+   } else {
+      const Filter* chosen = &FILTERS[0];
+      for (const Filter& f : FILTERS) {
+         if (name == f.name) {
+            chosen = &f;
+         }
+      }
+      kernelWindows(srcSize, dstSize, *chosen, windows);
+   }
+
+   for (const std::vector<double>& w : windows.weights) {
+      c.taps = std::max(c.taps, (int) w.size());
+   }
+   c.first.resize(dstSize);
+   c.weights.assign((size_t) dstSize * c.taps, 0);
+   const int one = 1 << simd::FILTER_BITS;
+   for (int i = 0; i < dstSize; i++) {
+      const std::vector<double>& w = windows.weights[i];
+      double total = 0;
+      for (double x : w) {
+         total += x;
+      }
+      if (total == 0) {
+         total = 1;
+      }
+      // windows near the end are moved back so all taps are in the image,
+      // and padded with zero weights in front
+      int first = std::min(windows.first[i], srcSize - c.taps);
+      int offset = windows.first[i] - first;
+      short* out = &c.weights[(size_t) i * c.taps + offset];
+      // each weight is the step between rounded running totals, so the
+      // rounding error is spread over the window instead of piling up on
+      // one tap, which for thousands of taps drove it far negative. The
+      // weights sum to one and are each within one unit of exact.
+      double running = 0;
+      int previous = 0;
+      for (int t = 0; t < (int) w.size(); t++) {
+         running += w[t];
+         int next = (int) lround(running / total * one);
+         out[t] = (short) (next - previous);
+         previous = next;
+      }
+      // only short of one when every weight was zero
+      out[w.size() - 1] += one - previous;
+      c.first[i] = first;
+   }
+   return c;
+}
+
+// resample numRows rows of src horizontally; output row i is made from
+// source row sourceRows[i], or row i if sourceRows is null
+static void filterColumns(const unsigned char* src, int srcWidth, unsigned char* dst, int dstWidth,
+   int numRows, const int* sourceRows, const Coefficients& c) {
+   parallelRows(numRows, dstWidth, [&](int firstRow, int lastRow) {
+      for (int i = firstRow; i < lastRow; i++) {
+         int row = sourceRows ? sourceRows[i] : i;
+         const unsigned char* in = src + (size_t) row * srcWidth * 3;
+         unsigned char* out = dst + (size_t) i * dstWidth * 3;
+         if (c.taps == 1) {
+            for (int j = 0; j < dstWidth; j++) {
+               memcpy(out + j * 3, in + c.first[j] * 3, 3);
+            }
+         } else {
+            simd::filterPixels(in, srcWidth, &c.first[0], &c.weights[0], c.taps, out, dstWidth);
+         }
+      }
+   });
+}
+
+// resample src vertically, a whole row of width pixels at a time
+static void filterRows(const unsigned char* src, unsigned char* dst, int width, int dstHeight,
+   const Coefficients& c) {
+   size_t rowSize = (size_t) width * 3;
+   parallelRows(dstHeight, width, [&](int firstRow, int lastRow) {
+      std::vector<const unsigned char*> rows(c.taps);
+      for (int i = firstRow; i < lastRow; i++) {
+         for (int t = 0; t < c.taps; t++) {
+            rows[t] = src + (c.first[i] + t) * rowSize;
+         }
+         simd::filterRows(&rows[0], &c.weights[(size_t) i * c.taps], c.taps,
+            dst + i * rowSize, (int) rowSize);
+      }
+   });
+}
+
+void resize(const unsigned char* src, int srcWidth, int srcHeight,
+   unsigned char* dst, int dstWidth, int dstHeight, const std::string& filter) {
+   if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+      return;
+   }
+   bool horizontal = srcWidth != dstWidth;
+   bool vertical = srcHeight != dstHeight;
+   if (!horizontal && !vertical) {
+      memcpy(dst, src, (size_t) srcWidth * srcHeight * 3);
+      return;
+   }
+   Coefficients columns, rows;
+   if (horizontal) {
+      columns = coefficients(srcWidth, dstWidth, filter);
+   }
+   if (vertical) {
+      rows = coefficients(srcHeight, dstHeight, filter);
+   }
+   if (!horizontal) {
+      filterRows(src, dst, srcWidth, dstHeight, rows);
+      return;
+   }
+   if (!vertical) {
+      filterColumns(src, srcWidth, dst, dstWidth, srcHeight, NULL, columns);
+      return;
+   }
+   // a single tap has weight one, so the vertical pass only picks rows
+   if (rows.taps == 1) {
+      filterColumns(src, srcWidth, dst, dstWidth, dstHeight, &rows.first[0], columns);
+      return;
+   }
+
+   // both passes are vectorized, but the horizontal one gathers each
+   // output pixel's taps separately while the vertical one streams whole
+   // rows, so the horizontal pass runs on whichever of the heights is
+   // smaller
+   BufferPool& pool = BufferPool::shared();
+   if (dstHeight < srcHeight) {
+      size_t bytes = (size_t) srcWidth * dstHeight * 3;
+      unsigned char* temp = pool.acquire(bytes, false);
+      filterRows(src, temp, srcWidth, dstHeight, rows);
+      filterColumns(temp, srcWidth, dst, dstWidth, dstHeight, NULL, columns);
+      pool.release(temp, bytes);
+   } else {
+      size_t bytes = (size_t) dstWidth * srcHeight * 3;
+      unsigned char* temp = pool.acquire(bytes, false);
+      filterColumns(src, srcWidth, temp, dstWidth, srcHeight, NULL, columns);
+      filterRows(temp, dst, dstWidth, dstHeight, rows);
+      pool.release(temp, bytes);
+   }
+}
+
+}  // namespace resample
+}  // namespace agl
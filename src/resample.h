@@ -0,0 +1,58 @@
+/**
+ * Separable resampling with precomputed per-axis filter weights
+ *
+ * @file resample.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_RESAMPLE_H_
+#define AGL_RESAMPLE_H_
+
+#include <string>
+#include <vector>
+
+namespace agl {
+namespace resample {
+
+/**
+ * @brief Return whether name is a resampling filter
+ *
+ * The filters are "nearest", "area" (the average of the source pixels
+ * each output pixel covers), "bilinear", "bicubic" (Keys, a = -0.5),
+ * "lanczos" (3 lobes) and "auto", which picks area for an axis shrunk by
+ * 2 or more and bilinear otherwise. Except for nearest, filters are
+ * widened by the scale when shrinking, so every source pixel contributes.
+ */
+bool isFilter(const std::string& name);
+
+/**
+ * @brief Weights taking srcSize samples to dstSize along one axis
+ *
+ * Output i is the sum over t < taps of weights[i * taps + t] times source
+ * sample first[i] + t. Weights are simd::FILTER_BITS fixed point and sum
+ * to exactly 1, so flat regions come out unchanged.
+ */
+struct Coefficients {
+  int taps;
+  std::vector<int> first;
+  std::vector<short> weights;
+};
+
+/** @brief Compute the weights of filter along one axis
+ */
+Coefficients coefficients(int srcSize, int dstSize, const std::string& filter);
+
+/**
+ * @brief Resample an RGB image of srcWidth x srcHeight into dst, of
+ * dstWidth x dstHeight
+ *
+ * Runs one pass per axis whose size changes, the vertical one first when
+ * it shrinks the image, so the other pass sees fewer rows.
+ */
+void resize(const unsigned char* src, int srcWidth, int srcHeight,
+   unsigned char* dst, int dstWidth, int dstHeight, const std::string& filter);
+
+}  // namespace resample
+}  // namespace agl
+#endif  // AGL_RESAMPLE_H_
@@ -0,0 +1,158 @@
+/**
+ * Implementation of the row-at-a-time image readers and writers
+ *
+ * @file rowio.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "rowio.h"
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#include "pnm.h"
+#include "qoi.h"
+
+namespace agl {
+
+PpmReader::PpmReader() {
+   this->_file = NULL;
+   this->_width = 0;
+   this->_height = 0;
+   this->_row = 0;
+}
+
+PpmReader::~PpmReader() {
+   if (this->_file) {
+      fclose(this->_file);
+   }
+}
+
+bool PpmReader::open(const std::string& filename) {
+   this->_file = fopen(filename.c_str(), "rb");
+   if (!this->_file) {
+      std::cerr << "Cannot open " << filename << std::endl;
+      return false;
+   }
+   FILE* file = this->_file;
+   pnm::Header header;
+   if (!pnm::parseHeader([file]() { return fgetc(file); }, header) || header.depth != 3) {
+      std::cerr << filename << " is not an 8-bit RGB PPM (P6) or PAM (P7) file" << std::endl;
+      return false;
+   }
+   this->_width = header.width;
+   this->_height = header.height;
+   this->_row = 0;
+   return true;
+}
+
+int PpmReader::width() const {
+   return this->_width;
+}
+
+int PpmReader::height() const {
+   return this->_height;
+}
+
+bool PpmReader::read(unsigned char* rows, int numRows) {
+   if (!this->_file || this->_row + numRows > this->_height) {
+      return false;
+   }
+   size_t rowSize = (size_t) this->_width * 3;
+   if (fread(rows, rowSize, numRows, this->_file) != (size_t) numRows) {
+      std::cerr << "Unexpected end of PPM data at row " << this->_row << std::endl;
+      return false;
+   }
+   this->_row += numRows;
+   return true;
+}
+
+PpmWriter::PpmWriter() {
+   this->_file = NULL;
+   this->_width = 0;
+   this->_pos = 0;
+}
+
+PpmWriter::~PpmWriter() {
+   // removes the temporary file if finish was not reached
+   delete this->_file;
+}
+
+bool PpmWriter::open(const std::string& filename, int width, int height) {
+   std::string header = pnm::header(width, height, false);
+   this->_file = MappedFile::create(filename, header.size() + (size_t) width * height * 3);
+   if (!this->_file) {
+      std::cerr << "Cannot create " << filename << std::endl;
+      return false;
+   }
+   this->_width = width;
+   memcpy(this->_file->data(), header.data(), header.size());
+   this->_pos = header.size();
+   return true;
+}
+
+bool PpmWriter::write(const unsigned char* rows, int numRows) {
+   size_t bytes = (size_t) this->_width * 3 * numRows;
+   if (!this->_file || bytes > this->_file->size() - this->_pos) {
+      return false;
+   }
+   memcpy(this->_file->data() + this->_pos, rows, bytes);
+   this->_pos += bytes;
+   return true;
+}
+
+bool PpmWriter::finish() {
+   if (!this->_file) {
+      return false;
+   }
+   bool ok = this->_pos == this->_file->size() && this->_file->commit();
+   delete this->_file;
+   this->_file = NULL;
+   return ok;
+}
+
+bool hasExtension(const std::string& filename, const std::string& ext) {
+   if (filename.size() < ext.size()) {
+      return false;
+   }
+   for (size_t i = 0; i < ext.size(); i++) {
+      if (tolower(filename[filename.size() - ext.size() + i]) != tolower(ext[i])) {
+         return false;
+      }
+   }
+   return true;
+}
+
+std::unique_ptr<RowReader> openReader(const std::string& filename) {
+   if (hasExtension(filename, ".qoi")) {
+      std::unique_ptr<QoiReader> reader(new QoiReader());
+      if (reader->open(filename)) {
+         return std::move(reader);
+      }
+   } else {
+      std::unique_ptr<PpmReader> reader(new PpmReader());
+      if (reader->open(filename)) {
+         return std::move(reader);
+      }
+   }
+   return nullptr;
+}
+
+std::unique_ptr<RowWriter> openWriter(const std::string& filename, int width, int height) {
+   if (hasExtension(filename, ".qoi")) {
+      std::unique_ptr<QoiWriter> writer(new QoiWriter());
+      if (writer->open(filename, width, height)) {
+         return std::move(writer);
+      }
+   } else {
+      std::unique_ptr<PpmWriter> writer(new PpmWriter());
+      if (writer->open(filename, width, height)) {
+         return std::move(writer);
+      }
+   }
+   return nullptr;
+}
+
+}  // namespace agl
@@ -0,0 +1,133 @@
+/**
+ * Row-at-a-time image readers and writers, for images too large to hold
+ * in memory at once
+ *
+ * @file rowio.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_ROWIO_H_
+#define AGL_ROWIO_H_
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "mappedfile.h"
+
+namespace agl {
+
+/**
+ * @brief Decodes an RGB image from the top row down
+ */
+class RowReader {
+ public:
+  virtual ~RowReader() {}
+
+  /** @brief Return the image width in pixels
+   */
+  virtual int width() const = 0;
+
+  /** @brief Return the image height in pixels
+   */
+  virtual int height() const = 0;
+
+  /**
+   * @brief Read the next numRows rows into rows (numRows * width * 3 bytes)
+   * @return false on a read error or when past the last row
+   */
+  virtual bool read(unsigned char* rows, int numRows) = 0;
+};
+
+/**
+ * @brief Encodes an RGB image from the top row down
+ */
+class RowWriter {
+ public:
+  virtual ~RowWriter() {}
+
+  /**
+   * @brief Write the next numRows rows (numRows * width * 3 bytes)
+   */
+  virtual bool write(const unsigned char* rows, int numRows) = 0;
+
+  /**
+   * @brief Flush and close the file once every row is written
+   */
+  virtual bool finish() = 0;
+};
+
+/**
+ * @brief Reads binary PPM (P6) and RGB PAM (P7) files with a maximum
+ * value of 255
+ */
+class PpmReader : public RowReader {
+ public:
+  PpmReader();
+  virtual ~PpmReader();
+
+  /**
+   * @brief Open filename and read its header
+   */
+  bool open(const std::string& filename);
+
+  virtual int width() const;
+  virtual int height() const;
+  virtual bool read(unsigned char* rows, int numRows);
+
+ private:
+  FILE* _file;
+  int _width;
+  int _height;
+  // rows read so far
+  int _row;
+};
+
+/**
+ * @brief Writes binary PPM (P6) files
+ *
+ * Rows go to a temporary file that replaces filename on finish, so an
+ * Image mapped from filename, even the input of the same run, keeps its
+ * pixels.
+ */
+class PpmWriter : public RowWriter {
+ public:
+  PpmWriter();
+  virtual ~PpmWriter();
+
+  /**
+   * @brief Start filename and write the header of a width by height image
+   */
+  bool open(const std::string& filename, int width, int height);
+
+  virtual bool write(const unsigned char* rows, int numRows);
+  virtual bool finish();
+
+ private:
+  MappedFile* _file;
+  int _width;
+  // bytes of _file written so far
+  size_t _pos;
+};
+
+/**
+ * @brief Return whether filename ends with ext (e.g. ".ppm"), ignoring case
+ */
+bool hasExtension(const std::string& filename, const std::string& ext);
+
+/**
+ * @brief Open filename with the reader for its extension: .qoi, or PPM
+ * (.ppm or .pam) otherwise
+ * @return The reader, or null if the file cannot be opened
+ */
+std::unique_ptr<RowReader> openReader(const std::string& filename);
+
+/**
+ * @brief Create filename with the writer for its extension: .qoi, or PPM
+ * otherwise
+ * @return The writer, or null if the file cannot be created
+ */
+std::unique_ptr<RowWriter> openWriter(const std::string& filename, int width, int height);
+}  // namespace agl
+#endif  // AGL_ROWIO_H_
@@ -0,0 +1,767 @@
+/**
+ * Implementation of the vectorized kernels and their dispatch
+ *
+ * @file simd.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "simd.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AGL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC accepts AVX2 intrinsics in any function
+#define AGL_TARGET_AVX2
+#else
+#define AGL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace agl {
+namespace simd {
+
+typedef void (*BinaryKernel)(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+typedef void (*BlendKernel)(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight);
+typedef void (*FilterKernel)(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count);
+typedef void (*PixelFilterKernel)(const unsigned char* src, int srcCount, const int* first, const short* weights,
+   int taps, unsigned char* dst, int count);
+typedef void (*Box3Kernel)(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step);
+typedef void (*SobelKernel)(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast);
+typedef void (*DeinterleaveKernel)(const unsigned char* rgb, unsigned char* r, unsigned char* g, unsigned char* b,
+   int count);
+typedef void (*InterleaveKernel)(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+   unsigned char* rgb, int count);
+
+// One implementation of every kernel for a given instruction set
+struct Kernels {
+   const char* name;
+   BinaryKernel add;
+   BinaryKernel subtract;
+   BinaryKernel multiply;
+   BinaryKernel difference;
+   BinaryKernel lightest;
+   BinaryKernel darkest;
+   BlendKernel alphaBlend;
+   FilterKernel filterRows;
+   PixelFilterKernel filterPixels;
+   Box3Kernel box3Row;
+   SobelKernel sobelRow;
+   DeinterleaveKernel deinterleave;
+   InterleaveKernel interleave;
+};
+
+// Each operator is defined once per instruction set: scalar() works on one
+// byte, sse2() on 16 and avx2() on 32
+struct AddOp {
+   static unsigned char scalar(int x, int y) { return std::min(x + y, 255); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) { return _mm_adds_epu8(x, y); }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) { return _mm256_adds_epu8(x, y); }
+#endif
+};
+
+struct SubtractOp {
+   static unsigned char scalar(int x, int y) { return std::max(x - y, 0); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) { return _mm_subs_epu8(x, y); }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) { return _mm256_subs_epu8(x, y); }
+#endif
+};
+
+struct DifferenceOp {
+   static unsigned char scalar(int x, int y) { return std::abs(x - y); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) {
+      return _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+   }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) {
+      return _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+   }
+#endif
+};
+
+struct LightestOp {
+   static unsigned char scalar(int x, int y) { return std::max(x, y); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) { return _mm_max_epu8(x, y); }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) { return _mm256_max_epu8(x, y); }
+#endif
+};
+
+struct DarkestOp {
+   static unsigned char scalar(int x, int y) { return std::min(x, y); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) { return _mm_min_epu8(x, y); }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) { return _mm256_min_epu8(x, y); }
+#endif
+};
+
+// Products are formed in 16 bits and clamped with x - max(x - 255, 0)
+// before packing, since SSE2 has no unsigned 16-bit min
+struct MultiplyOp {
+   static unsigned char scalar(int x, int y) { return std::min(x * y, 255); }
+#ifdef AGL_X86
+   static __m128i sse2(__m128i x, __m128i y) {
+      __m128i zero = _mm_setzero_si128();
+      __m128i max = _mm_set1_epi16(255);
+      __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+      __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+      lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, max));
+      hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, max));
+      return _mm_packus_epi16(lo, hi);
+   }
+   AGL_TARGET_AVX2 static __m256i avx2(__m256i x, __m256i y) {
+      __m256i zero = _mm256_setzero_si256();
+      __m256i max = _mm256_set1_epi16(255);
+      __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(x, zero), _mm256_unpacklo_epi8(y, zero));
+      __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(x, zero), _mm256_unpackhi_epi8(y, zero));
+      lo = _mm256_min_epu16(lo, max);
+      hi = _mm256_min_epu16(hi, max);
+      // unpack and pack both work within 128-bit lanes, so order is kept
+      return _mm256_packus_epi16(lo, hi);
+   }
+#endif
+};
+
+template <class Op>
+static void scalarLoop(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   for (int i = 0; i < count; i++) {
+      dst[i] = Op::scalar(a[i], b[i]);
+   }
+}
+
+static void blendScalar(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight) {
+   for (int i = 0; i < count; i++) {
+      dst[i] = (a[i] * (256 - weight) + b[i] * weight + 128) >> 8;
+   }
+}
+
+// filter bytes [begin, count), the part of a row left after the vector loop
+static void filterTail(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst,
+   int begin, int count) {
+   for (int i = begin; i < count; i++) {
+      int sum = 1 << (FILTER_BITS - 1);
+      for (int t = 0; t < taps; t++) {
+         sum += weights[t] * rows[t][i];
+      }
+      dst[i] = std::min(std::max(sum >> FILTER_BITS, 0), 255);
+   }
+}
+
+static void filterScalar(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count) {
+   filterTail(rows, weights, taps, dst, 0, count);
+}
+
+// filter one RGB pixel from the taps pixels at px
+static void filterPixel(const unsigned char* px, const short* weights, int taps, unsigned char* dst) {
+   int r = 1 << (FILTER_BITS - 1), g = r, b = r;
+   for (int t = 0; t < taps; t++) {
+      r += weights[t] * px[t * 3];
+      g += weights[t] * px[t * 3 + 1];
+      b += weights[t] * px[t * 3 + 2];
+   }
+   dst[0] = std::min(std::max(r >> FILTER_BITS, 0), 255);
+   dst[1] = std::min(std::max(g >> FILTER_BITS, 0), 255);
+   dst[2] = std::min(std::max(b >> FILTER_BITS, 0), 255);
+}
+
+static void filterPixelsScalar(const unsigned char* src, int srcCount, const int* first, const short* weights,
+   int taps, unsigned char* dst, int count) {
+   for (int j = 0; j < count; j++) {
+      filterPixel(src + first[j] * 3, weights + (size_t) j * taps, taps, dst + j * 3);
+   }
+}
+
+// 7282 / 2^16 is 1/9 rounded up, close enough that (x * 7282) >> 16 is
+// x / 9 for every sum of nine bytes
+static const int NINTH = 7282;
+
+static void box3Scalar(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step) {
+   for (int k = 0; k < count; k++) {
+      int sum = top[k - step] + top[k] + top[k + step] + mid[k - step] + mid[k] + mid[k + step] +
+         bottom[k - step] + bottom[k] + bottom[k + step];
+      dst[k] = sum / 9;
+   }
+}
+
+// the magnitude is taken as stencil.cpp does for the edge columns, with a
+// float square root, which the vector kernels also use
+static void sobelScalar(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast) {
+   for (int k = 0; k < count; k++) {
+      int gx = (top[k - step] - top[k + step]) + 2 * (mid[k - step] - mid[k + step]) +
+         (bottom[k - step] - bottom[k + step]);
+      int gy = (top[k - step] + 2 * top[k] + top[k + step]) -
+         (bottom[k - step] + 2 * bottom[k] + bottom[k + step]);
+      if (fast) {
+         dst[k] = (unsigned char) std::min(std::abs(gx) + std::abs(gy), 255);
+      } else {
+         int squared = gx * gx + gy * gy;
+         dst[k] = squared >= 255 * 255 ? 255 : (unsigned char) sqrtf((float) squared);
+      }
+   }
+}
+
+static void deinterleaveScalar(const unsigned char* rgb, unsigned char* r, unsigned char* g, unsigned char* b,
+   int count) {
+   for (int i = 0; i < count; i++) {
+      r[i] = rgb[i * 3];
+      g[i] = rgb[i * 3 + 1];
+      b[i] = rgb[i * 3 + 2];
+   }
+}
+
+static void interleaveScalar(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+   unsigned char* rgb, int count) {
+   for (int i = 0; i < count; i++) {
+      rgb[i * 3] = r[i];
+      rgb[i * 3 + 1] = g[i];
+      rgb[i * 3 + 2] = b[i];
+   }
+}
+
+static const Kernels SCALAR = {
+   "scalar",
+   scalarLoop<AddOp>, scalarLoop<SubtractOp>, scalarLoop<MultiplyOp>,
+   scalarLoop<DifferenceOp>, scalarLoop<LightestOp>, scalarLoop<DarkestOp>,
+   blendScalar, filterScalar, filterPixelsScalar, box3Scalar, sobelScalar,
+   deinterleaveScalar, interleaveScalar
+};
+
+#ifdef AGL_X86
+
+template <class Op>
+static void sse2Loop(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   int i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+      __m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+      _mm_storeu_si128((__m128i*) (dst + i), Op::sse2(x, y));
+   }
+   scalarLoop<Op>(a + i, b + i, dst + i, count - i);
+}
+
+// a * (256 - w) + b * w + 128 is at most 65408, so it fits 16 unsigned bits
+static void blendSse2(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight) {
+   __m128i zero = _mm_setzero_si128();
+   __m128i wa = _mm_set1_epi16((short) (256 - weight));
+   __m128i wb = _mm_set1_epi16((short) weight);
+   __m128i half = _mm_set1_epi16(128);
+   int i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+      __m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+      __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), wa),
+         _mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), wb));
+      __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), wa),
+         _mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), wb));
+      lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+      hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+      _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+   }
+   blendScalar(a + i, b + i, dst + i, count - i, weight);
+}
+
+// Taps are taken in pairs: the bytes of two rows are interleaved and
+// widened, so one multiply-add applies both weights to four pixels in 32
+// bits. An odd last tap is paired with itself at weight 0. packs and
+// packus then clamp the sums to [0, 255] as the scalar code does.
+static void filterSse2(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count) {
+   __m128i zero = _mm_setzero_si128();
+   __m128i half = _mm_set1_epi32(1 << (FILTER_BITS - 1));
+   int i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m128i s0 = half, s1 = half, s2 = half, s3 = half;
+      for (int t = 0; t < taps; t += 2) {
+         bool pair = t + 1 < taps;
+         const unsigned char* second = pair ? rows[t + 1] : rows[t];
+         unsigned w = (unsigned short) weights[t] | (unsigned) (unsigned short) (pair ? weights[t + 1] : 0) << 16;
+         __m128i wv = _mm_set1_epi32((int) w);
+         __m128i x = _mm_loadu_si128((const __m128i*) (rows[t] + i));
+         __m128i y = _mm_loadu_si128((const __m128i*) (second + i));
+         __m128i lo = _mm_unpacklo_epi8(x, y);
+         __m128i hi = _mm_unpackhi_epi8(x, y);
+         s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), wv));
+         s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), wv));
+         s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), wv));
+         s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), wv));
+      }
+      __m128i a = _mm_packs_epi32(_mm_srai_epi32(s0, FILTER_BITS), _mm_srai_epi32(s1, FILTER_BITS));
+      __m128i b = _mm_packs_epi32(_mm_srai_epi32(s2, FILTER_BITS), _mm_srai_epi32(s3, FILTER_BITS));
+      _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(a, b));
+   }
+   filterTail(rows, weights, taps, dst, i, count);
+}
+
+// Taps are again taken in pairs: eight bytes from the first pixel of a
+// pair are interleaved with themselves shifted by one pixel, giving
+// r0 r1 g0 g1 b0 b1 as 16 bits, so one multiply-add sums both taps of all
+// three channels. The last load reads two bytes past the pair (three more
+// with an odd tap count), so pixels too close to the end of src are left
+// to the scalar code.
+static void filterPixelsSse2(const unsigned char* src, int srcCount, const int* first, const short* weights,
+   int taps, unsigned char* dst, int count) {
+   __m128i zero = _mm_setzero_si128();
+   __m128i half = _mm_set1_epi32(1 << (FILTER_BITS - 1));
+   // bytes from a pixel to the end of its last load
+   int reach = (taps + 1) / 2 * 6 + 2;
+   for (int j = 0; j < count; j++) {
+      const unsigned char* px = src + first[j] * 3;
+      const short* w = weights + (size_t) j * taps;
+      if (first[j] * 3 + reach > srcCount * 3) {
+         filterPixel(px, w, taps, dst + j * 3);
+         continue;
+      }
+      __m128i sum = half;
+      for (int t = 0; t < taps; t += 2) {
+         unsigned pair = (unsigned short) w[t] | (unsigned) (unsigned short) (t + 1 < taps ? w[t + 1] : 0) << 16;
+         __m128i x = _mm_loadl_epi64((const __m128i*) (px + t * 3));
+         __m128i xy = _mm_unpacklo_epi8(_mm_unpacklo_epi8(x, _mm_srli_si128(x, 3)), zero);
+         sum = _mm_add_epi32(sum, _mm_madd_epi16(xy, _mm_set1_epi32((int) pair)));
+      }
+      sum = _mm_srai_epi32(sum, FILTER_BITS);
+      sum = _mm_packus_epi16(_mm_packs_epi32(sum, sum), zero);
+      int rgb = _mm_cvtsi128_si32(sum);
+      memcpy(dst + j * 3, &rgb, 3);
+   }
+}
+
+// add the bytes at row - step, row and row + step to lo and hi, widened
+static inline void sum3Sse2(const unsigned char* row, int step, __m128i& lo, __m128i& hi) {
+   __m128i zero = _mm_setzero_si128();
+   for (int d = -step; d <= step; d += step) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (row + d));
+      lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(x, zero));
+      hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(x, zero));
+   }
+}
+
+static void box3Sse2(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step) {
+   __m128i ninth = _mm_set1_epi16(NINTH);
+   int k = 0;
+   for (; k + 16 <= count; k += 16) {
+      __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+      sum3Sse2(top + k, step, lo, hi);
+      sum3Sse2(mid + k, step, lo, hi);
+      sum3Sse2(bottom + k, step, lo, hi);
+      _mm_storeu_si128((__m128i*) (dst + k),
+         _mm_packus_epi16(_mm_mulhi_epu16(lo, ninth), _mm_mulhi_epu16(hi, ninth)));
+   }
+   box3Scalar(top + k, mid + k, bottom + k, dst + k, count - k, step);
+}
+
+// floor(sqrt(gx^2 + gy^2)) of eight 16-bit gradients, as 16 bits; the
+// squares are summed in 32 bits by multiply-adding each gx, gy pair
+static inline __m128i magnitudeSse2(__m128i gx, __m128i gy) {
+   __m128i lo = _mm_unpacklo_epi16(gx, gy);
+   __m128i hi = _mm_unpackhi_epi16(gx, gy);
+   lo = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))));
+   hi = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))));
+   return _mm_packs_epi32(lo, hi);
+}
+
+// gx and gy are at most 4 * 255 in magnitude, so they fit 16 signed bits;
+// packus then clamps the magnitudes to 255
+static void sobelSse2(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast) {
+   __m128i zero = _mm_setzero_si128();
+   int k = 0;
+   for (; k + 16 <= count; k += 16) {
+      __m128i out[2];
+      for (int half = 0; half < 2; half++) {
+         // the left, center and right bytes of each row, widened
+         __m128i v[3][3];
+         const unsigned char* rows[3] = {top + k, mid + k, bottom + k};
+         for (int r = 0; r < 3; r++) {
+            for (int l = 0; l < 3; l++) {
+               __m128i x = _mm_loadu_si128((const __m128i*) (rows[r] + (l - 1) * step));
+               v[r][l] = half ? _mm_unpackhi_epi8(x, zero) : _mm_unpacklo_epi8(x, zero);
+            }
+         }
+         __m128i gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(v[0][0], v[0][2]), _mm_sub_epi16(v[2][0], v[2][2])),
+            _mm_slli_epi16(_mm_sub_epi16(v[1][0], v[1][2]), 1));
+         __m128i gy = _mm_sub_epi16(
+            _mm_add_epi16(_mm_add_epi16(v[0][0], v[0][2]), _mm_slli_epi16(v[0][1], 1)),
+            _mm_add_epi16(_mm_add_epi16(v[2][0], v[2][2]), _mm_slli_epi16(v[2][1], 1)));
+         if (fast) {
+            // SSE2 has no 16-bit abs, so take max(x, -x)
+            __m128i ax = _mm_max_epi16(gx, _mm_sub_epi16(zero, gx));
+            __m128i ay = _mm_max_epi16(gy, _mm_sub_epi16(zero, gy));
+            out[half] = _mm_add_epi16(ax, ay);
+         } else {
+            out[half] = magnitudeSse2(gx, gy);
+         }
+      }
+      _mm_storeu_si128((__m128i*) (dst + k), _mm_packus_epi16(out[0], out[1]));
+   }
+   sobelScalar(top + k, mid + k, bottom + k, dst + k, count - k, step, fast);
+}
+
+template <class Op>
+AGL_TARGET_AVX2 static void avx2Loop(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   int i = 0;
+   for (; i + 32 <= count; i += 32) {
+      __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+      __m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+      _mm256_storeu_si256((__m256i*) (dst + i), Op::avx2(x, y));
+   }
+   scalarLoop<Op>(a + i, b + i, dst + i, count - i);
+}
+
+AGL_TARGET_AVX2 static void blendAvx2(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight) {
+   __m256i zero = _mm256_setzero_si256();
+   __m256i wa = _mm256_set1_epi16((short) (256 - weight));
+   __m256i wb = _mm256_set1_epi16((short) weight);
+   __m256i half = _mm256_set1_epi16(128);
+   int i = 0;
+   for (; i + 32 <= count; i += 32) {
+      __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+      __m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+      __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, zero), wa),
+         _mm256_mullo_epi16(_mm256_unpacklo_epi8(y, zero), wb));
+      __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, zero), wa),
+         _mm256_mullo_epi16(_mm256_unpackhi_epi8(y, zero), wb));
+      lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 8);
+      hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 8);
+      _mm256_storeu_si256((__m256i*) (dst + i), _mm256_packus_epi16(lo, hi));
+   }
+   blendScalar(a + i, b + i, dst + i, count - i, weight);
+}
+
+AGL_TARGET_AVX2 static void filterAvx2(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count) {
+   __m256i zero = _mm256_setzero_si256();
+   __m256i half = _mm256_set1_epi32(1 << (FILTER_BITS - 1));
+   int i = 0;
+   for (; i + 32 <= count; i += 32) {
+      __m256i s0 = half, s1 = half, s2 = half, s3 = half;
+      for (int t = 0; t < taps; t += 2) {
+         bool pair = t + 1 < taps;
+         const unsigned char* second = pair ? rows[t + 1] : rows[t];
+         unsigned w = (unsigned short) weights[t] | (unsigned) (unsigned short) (pair ? weights[t + 1] : 0) << 16;
+         __m256i wv = _mm256_set1_epi32((int) w);
+         __m256i x = _mm256_loadu_si256((const __m256i*) (rows[t] + i));
+         __m256i y = _mm256_loadu_si256((const __m256i*) (second + i));
+         __m256i lo = _mm256_unpacklo_epi8(x, y);
+         __m256i hi = _mm256_unpackhi_epi8(x, y);
+         s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), wv));
+         s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), wv));
+         s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), wv));
+         s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), wv));
+      }
+      // every step works within 128-bit lanes, so order is kept
+      __m256i a = _mm256_packs_epi32(_mm256_srai_epi32(s0, FILTER_BITS), _mm256_srai_epi32(s1, FILTER_BITS));
+      __m256i b = _mm256_packs_epi32(_mm256_srai_epi32(s2, FILTER_BITS), _mm256_srai_epi32(s3, FILTER_BITS));
+      _mm256_storeu_si256((__m256i*) (dst + i), _mm256_packus_epi16(a, b));
+   }
+   filterTail(rows, weights, taps, dst, i, count);
+}
+
+// Byte shuffle masks for 16 pixels held in three 16-byte blocks. For
+// deinterleave, byte p of the mask for block k and channel c selects that
+// channel of pixel p if it lies in the block; for interleave, byte i of
+// the mask for block k selects the pixel whose channel c is byte i of
+// block k. Every other byte is -1, which pshufb turns into 0.
+static __m128i deinterleaveMask(int block, int channel) {
+   alignas(16) char mask[16];
+   for (int p = 0; p < 16; p++) {
+      int byte = p * 3 + channel - block * 16;
+      mask[p] = (char) (0 <= byte && byte < 16 ? byte : -1);
+   }
+   return _mm_load_si128((const __m128i*) mask);
+}
+
+static __m128i interleaveMask(int block, int channel) {
+   alignas(16) char mask[16];
+   for (int i = 0; i < 16; i++) {
+      int byte = block * 16 + i;
+      mask[i] = (char) (byte % 3 == channel ? byte / 3 : -1);
+   }
+   return _mm_load_si128((const __m128i*) mask);
+}
+
+// SSE2 has no byte shuffle, so these use the SSSE3 pshufb that every AVX2
+// CPU has: each plane gathers its bytes from all three blocks (and each
+// block from all three planes), and the pieces are OR'ed together
+AGL_TARGET_AVX2 static void deinterleaveAvx2(const unsigned char* rgb, unsigned char* r, unsigned char* g,
+   unsigned char* b, int count) {
+   __m128i masks[3][3];
+   for (int c = 0; c < 3; c++) {
+      for (int k = 0; k < 3; k++) {
+         masks[c][k] = deinterleaveMask(k, c);
+      }
+   }
+   unsigned char* planes[3] = {r, g, b};
+   int i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (rgb + i * 3));
+      __m128i y = _mm_loadu_si128((const __m128i*) (rgb + i * 3 + 16));
+      __m128i z = _mm_loadu_si128((const __m128i*) (rgb + i * 3 + 32));
+      for (int c = 0; c < 3; c++) {
+         __m128i plane = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x, masks[c][0]),
+            _mm_shuffle_epi8(y, masks[c][1])), _mm_shuffle_epi8(z, masks[c][2]));
+         _mm_storeu_si128((__m128i*) (planes[c] + i), plane);
+      }
+   }
+   deinterleaveScalar(rgb + i * 3, r + i, g + i, b + i, count - i);
+}
+
+AGL_TARGET_AVX2 static void interleaveAvx2(const unsigned char* r, const unsigned char* g, const unsigned char* b,
+   unsigned char* rgb, int count) {
+   __m128i masks[3][3];
+   for (int k = 0; k < 3; k++) {
+      for (int c = 0; c < 3; c++) {
+         masks[k][c] = interleaveMask(k, c);
+      }
+   }
+   int i = 0;
+   for (; i + 16 <= count; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (r + i));
+      __m128i y = _mm_loadu_si128((const __m128i*) (g + i));
+      __m128i z = _mm_loadu_si128((const __m128i*) (b + i));
+      for (int k = 0; k < 3; k++) {
+         __m128i block = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x, masks[k][0]),
+            _mm_shuffle_epi8(y, masks[k][1])), _mm_shuffle_epi8(z, masks[k][2]));
+         _mm_storeu_si128((__m128i*) (rgb + i * 3 + k * 16), block);
+      }
+   }
+   interleaveScalar(r + i, g + i, b + i, rgb + i * 3, count - i);
+}
+
+AGL_TARGET_AVX2 static inline void sum3Avx2(const unsigned char* row, int step, __m256i& lo, __m256i& hi) {
+   __m256i zero = _mm256_setzero_si256();
+   for (int d = -step; d <= step; d += step) {
+      __m256i x = _mm256_loadu_si256((const __m256i*) (row + d));
+      lo = _mm256_add_epi16(lo, _mm256_unpacklo_epi8(x, zero));
+      hi = _mm256_add_epi16(hi, _mm256_unpackhi_epi8(x, zero));
+   }
+}
+
+AGL_TARGET_AVX2 static void box3Avx2(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step) {
+   __m256i ninth = _mm256_set1_epi16(NINTH);
+   int k = 0;
+   for (; k + 32 <= count; k += 32) {
+      __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+      sum3Avx2(top + k, step, lo, hi);
+      sum3Avx2(mid + k, step, lo, hi);
+      sum3Avx2(bottom + k, step, lo, hi);
+      // every step works within 128-bit lanes, so order is kept
+      _mm256_storeu_si256((__m256i*) (dst + k),
+         _mm256_packus_epi16(_mm256_mulhi_epu16(lo, ninth), _mm256_mulhi_epu16(hi, ninth)));
+   }
+   box3Scalar(top + k, mid + k, bottom + k, dst + k, count - k, step);
+}
+
+AGL_TARGET_AVX2 static inline __m256i magnitudeAvx2(__m256i gx, __m256i gy) {
+   __m256i lo = _mm256_unpacklo_epi16(gx, gy);
+   __m256i hi = _mm256_unpackhi_epi16(gx, gy);
+   lo = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(lo, lo))));
+   hi = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(hi, hi))));
+   return _mm256_packs_epi32(lo, hi);
+}
+
+AGL_TARGET_AVX2 static void sobelAvx2(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast) {
+   __m256i zero = _mm256_setzero_si256();
+   int k = 0;
+   for (; k + 32 <= count; k += 32) {
+      __m256i out[2];
+      for (int half = 0; half < 2; half++) {
+         __m256i v[3][3];
+         const unsigned char* rows[3] = {top + k, mid + k, bottom + k};
+         for (int r = 0; r < 3; r++) {
+            for (int l = 0; l < 3; l++) {
+               __m256i x = _mm256_loadu_si256((const __m256i*) (rows[r] + (l - 1) * step));
+               v[r][l] = half ? _mm256_unpackhi_epi8(x, zero) : _mm256_unpacklo_epi8(x, zero);
+            }
+         }
+         __m256i gx = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_sub_epi16(v[0][0], v[0][2]), _mm256_sub_epi16(v[2][0], v[2][2])),
+            _mm256_slli_epi16(_mm256_sub_epi16(v[1][0], v[1][2]), 1));
+         __m256i gy = _mm256_sub_epi16(
+            _mm256_add_epi16(_mm256_add_epi16(v[0][0], v[0][2]), _mm256_slli_epi16(v[0][1], 1)),
+            _mm256_add_epi16(_mm256_add_epi16(v[2][0], v[2][2]), _mm256_slli_epi16(v[2][1], 1)));
+         out[half] = fast ? _mm256_add_epi16(_mm256_abs_epi16(gx), _mm256_abs_epi16(gy)) : magnitudeAvx2(gx, gy);
+      }
+      // every step works within 128-bit lanes, so order is kept
+      _mm256_storeu_si256((__m256i*) (dst + k), _mm256_packus_epi16(out[0], out[1]));
+   }
+   sobelScalar(top + k, mid + k, bottom + k, dst + k, count - k, step, fast);
+}
+
+static const Kernels SSE2 = {
+   "sse2",
+   sse2Loop<AddOp>, sse2Loop<SubtractOp>, sse2Loop<MultiplyOp>,
+   sse2Loop<DifferenceOp>, sse2Loop<LightestOp>, sse2Loop<DarkestOp>,
+   blendSse2, filterSse2, filterPixelsSse2, box3Sse2, sobelSse2,
+   deinterleaveScalar, interleaveScalar
+};
+
+static const Kernels AVX2 = {
+   "avx2",
+   avx2Loop<AddOp>, avx2Loop<SubtractOp>, avx2Loop<MultiplyOp>,
+   avx2Loop<DifferenceOp>, avx2Loop<LightestOp>, avx2Loop<DarkestOp>,
+   // one pixel is too narrow to gain from 256 bits
+   blendAvx2, filterAvx2, filterPixelsSse2, box3Avx2, sobelAvx2,
+   deinterleaveAvx2, interleaveAvx2
+};
+
+static bool cpuHasSse2() {
+#if defined(__x86_64__) || defined(_M_X64)
+   return true;
+#elif defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return (info[3] & (1 << 26)) != 0;
+#else
+   return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7) {
+      return false;
+   }
+   __cpuid(info, 1);
+   // the OS must save the AVX registers (OSXSAVE, and XCR0 bits 1 and 2)
+   bool osxsave = (info[2] & (1 << 27)) != 0;
+   if (!osxsave || (_xgetbv(0) & 6) != 6) {
+      return false;
+   }
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // AGL_X86
+
+// Return the kernels for the named instruction set, or null if the CPU
+// does not support it
+static const Kernels* lookup(const std::string& name) {
+   if (name == "scalar") {
+      return &SCALAR;
+   }
+#ifdef AGL_X86
+   if (name == "sse2" && cpuHasSse2()) {
+      return &SSE2;
+   }
+   if (name == "avx2" && cpuHasAvx2()) {
+      return &AVX2;
+   }
+#endif
+   return nullptr;
+}
+
+static const Kernels* detect() {
+   const char* env = getenv("AGL_SIMD");
+   if (env && lookup(env)) {
+      return lookup(env);
+   }
+   const char* preferred[] = {"avx2", "sse2"};
+   for (const char* name : preferred) {
+      if (lookup(name)) {
+         return lookup(name);
+      }
+   }
+   return &SCALAR;
+}
+
+// the kernels in use; setIsa may switch them while other threads call in
+static std::atomic<const Kernels*>& active() {
+   static std::atomic<const Kernels*> kernels(detect());
+   return kernels;
+}
+
+const char* isa() {
+   return active().load()->name;
+}
+
+bool setIsa(const std::string& name) {
+   const Kernels* kernels = lookup(name);
+   if (!kernels) {
+      return false;
+   }
+   active() = kernels;
+   return true;
+}
+
+void add(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->add(a, b, dst, count);
+}
+
+void subtract(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->subtract(a, b, dst, count);
+}
+
+void multiply(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->multiply(a, b, dst, count);
+}
+
+void difference(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->difference(a, b, dst, count);
+}
+
+void lightest(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->lightest(a, b, dst, count);
+}
+
+void darkest(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count) {
+   active().load()->darkest(a, b, dst, count);
+}
+
+void alphaBlend(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight) {
+   active().load()->alphaBlend(a, b, dst, count, weight);
+}
+
+void filterRows(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count) {
+   active().load()->filterRows(rows, weights, taps, dst, count);
+}
+
+void filterPixels(const unsigned char* src, int srcCount, const int* first, const short* weights, int taps,
+   unsigned char* dst, int count) {
+   active().load()->filterPixels(src, srcCount, first, weights, taps, dst, count);
+}
+
+void box3Row(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step) {
+   active().load()->box3Row(top, mid, bottom, dst, count, step);
+}
+
+void sobelRow(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast) {
+   active().load()->sobelRow(top, mid, bottom, dst, count, step, fast);
+}
+
+void deinterleave(const unsigned char* rgb, unsigned char* r, unsigned char* g, unsigned char* b, int count) {
+   active().load()->deinterleave(rgb, r, g, b, count);
+}
+
+void interleave(const unsigned char* r, const unsigned char* g, const unsigned char* b, unsigned char* rgb, int count) {
+   active().load()->interleave(r, g, b, rgb, count);
+}
+
+int blendWeight(float alpha) {
+   return std::min(std::max((int) lround(alpha * 256), 0), 256);
+}
+
+}  // namespace simd
+}  // namespace agl
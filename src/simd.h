@@ -0,0 +1,96 @@
+/**
+ * Vectorized kernels for the binary blend operators, the resampler, the
+ * 3x3 stencils and the layout conversions, with the instruction set
+ * chosen at runtime
+ *
+ * Each blend kernel combines count bytes of a and b into dst. dst may be
+ * the same buffer as a or b. Every instruction set gives identical results.
+ *
+ * @file simd.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_SIMD_H_
+#define AGL_SIMD_H_
+
+#include <string>
+
+namespace agl {
+namespace simd {
+
+/**
+ * @brief Return the instruction set in use: "avx2", "sse2" or "scalar"
+ *
+ * The best one supported by the CPU is picked on first use, unless the
+ * AGL_SIMD environment variable names another one.
+ */
+const char* isa();
+
+/**
+ * @brief Use the given instruction set ("avx2", "sse2" or "scalar")
+ *
+ * Returns false, and keeps the current one, if the CPU does not support it.
+ */
+bool setIsa(const std::string& name);
+
+// dst = min(a + b, 255)
+void add(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = max(a - b, 0)
+void subtract(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = min(a * b, 255)
+void multiply(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = abs(a - b)
+void difference(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = max(a, b)
+void lightest(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = min(a, b)
+void darkest(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count);
+
+// dst = (a * (256 - weight) + b * weight + 128) / 256, weight in [0, 256]
+void alphaBlend(const unsigned char* a, const unsigned char* b, unsigned char* dst, int count, int weight);
+
+// Fixed-point weights for filterRows have this many fraction bits
+const int FILTER_BITS = 14;
+
+// dst = clamp((sum over t < taps of weights[t] * rows[t][i] + 2^13) >> 14, 0, 255),
+// with weights in FILTER_BITS fixed point; dst must not be one of the rows
+void filterRows(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, int count);
+
+// For each of count RGB pixels j of dst, per channel:
+// dst[j] = clamp((sum over t < taps of weights[j * taps + t] * src[first[j] + t] + 2^13) >> 14, 0, 255),
+// where src holds srcCount pixels and first[j] + taps <= srcCount
+void filterPixels(const unsigned char* src, int srcCount, const int* first, const short* weights, int taps,
+   unsigned char* dst, int count);
+
+// Rows of the 3x3 kernels below: byte k of dst comes from bytes k - step,
+// k and k + step of top, mid and bottom, for k in [0, count). step is 3
+// for interleaved RGB rows and 1 for planes, and the rows must be readable
+// step bytes beyond either end.
+
+// dst = (sum of the nine neighbors) / 9
+void box3Row(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step);
+
+// Sobel gradient magnitude, with gx left minus right and gy top minus
+// bottom: min(floor(sqrt(gx^2 + gy^2)), 255), or min(|gx| + |gy|, 255) if fast
+void sobelRow(const unsigned char* top, const unsigned char* mid, const unsigned char* bottom,
+   unsigned char* dst, int count, int step, bool fast);
+
+// Split count RGB pixels into red, green and blue planes
+void deinterleave(const unsigned char* rgb, unsigned char* r, unsigned char* g, unsigned char* b, int count);
+
+// Merge count pixels of red, green and blue planes into RGB pixels
+void interleave(const unsigned char* r, const unsigned char* g, const unsigned char* b, unsigned char* rgb, int count);
+
+// Convert a blend amount in [0, 1] to the weight used by alphaBlend
+int blendWeight(float alpha);
+
+}  // namespace simd
+}  // namespace agl
+#endif  // AGL_SIMD_H_
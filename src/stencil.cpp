@@ -0,0 +1,225 @@
+/**
+ * Implementation of the 3x3 neighborhood kernels
+ *
+ * @file stencil.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "stencil.h"
+
+#include "simd.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+namespace agl {
+namespace stencil {
+
+// box3 for a single pixel of CHANNELS interleaved channels, written to out
+template <int CHANNELS>
+static inline void boxPixel(const unsigned char* src, int srcFirst,
+   int width, int height, int i, int j, unsigned char* out) {
+   int rowSize = width * CHANNELS;
+   const unsigned char* center = src + (i - srcFirst) * rowSize + j * CHANNELS;
+   int sum[CHANNELS] = {};
+   for (int k = i - 1; k <= i + 1; k++) {
+      for (int l = j - 1; l <= j + 1; l++) {
+         const unsigned char* px = center;
+         if (0 <= k && k < height && 0 <= l && l < width) {
+            px = src + (k - srcFirst) * rowSize + l * CHANNELS;
+         }
+         for (int c = 0; c < CHANNELS; c++) {
+            sum[c] += px[c];
+         }
+      }
+   }
+   for (int c = 0; c < CHANNELS; c++) {
+      out[c] = sum[c] / 9;
+   }
+}
+
+template <int CHANNELS>
+static void boxBand(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   int rowSize = width * CHANNELS;
+   for (int i = first; i < last; i++) {
+      unsigned char* row = dst + (i - first) * rowSize;
+      if (i == 0 || i == height - 1) {
+         for (int j = 0; j < width; j++) {
+            boxPixel<CHANNELS>(src, srcFirst, width, height, i, j, row + j * CHANNELS);
+         }
+         continue;
+      }
+      const unsigned char* top = src + (i - 1 - srcFirst) * rowSize;
+      const unsigned char* mid = top + rowSize;
+      const unsigned char* bottom = mid + rowSize;
+      // interior pixels have all eight neighbors in the image, so every
+      // channel runs through the same vector kernel
+      if (width > 2) {
+         simd::box3Row(top + CHANNELS, mid + CHANNELS, bottom + CHANNELS, row + CHANNELS,
+            rowSize - 2 * CHANNELS, CHANNELS);
+      }
+      // the first and last columns
+      for (int j : {0, width - 1}) {
+         boxPixel<CHANNELS>(src, srcFirst, width, height, i, j, row + j * CHANNELS);
+      }
+   }
+}
+
+void box3(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   boxBand<3>(src, srcFirst, dst, width, height, first, last);
+}
+
+void box3Plane(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   boxBand<1>(src, srcFirst, dst, width, height, first, last);
+}
+
+// rows i - 1, i and i + 1 of src, with rows outside the image pointing
+// at zeros
+template <int CHANNELS>
+static inline void sobelRows(const unsigned char* src, int srcFirst, const unsigned char* zeros,
+   int width, int height, int i, const unsigned char* rows[3]) {
+   int rowSize = width * CHANNELS;
+   for (int k = 0; k < 3; k++) {
+      int row = i + k - 1;
+      rows[k] = 0 <= row && row < height ? src + (row - srcFirst) * rowSize : zeros;
+   }
+}
+
+// Sobel responses of channel c of pixel j, with gx left minus right and gy
+// top minus bottom; columns outside the image count as 0
+template <int CHANNELS>
+static inline void gradientAt(const unsigned char* rows[3], int width, int j, int c,
+   int& gx, int& gy) {
+   int v[3][3];
+   for (int k = 0; k < 3; k++) {
+      for (int l = 0; l < 3; l++) {
+         int col = j + l - 1;
+         v[k][l] = 0 <= col && col < width ? rows[k][col * CHANNELS + c] : 0;
+      }
+   }
+   gx = (v[0][0] - v[0][2]) + 2 * (v[1][0] - v[1][2]) + (v[2][0] - v[2][2]);
+   gy = (v[0][0] + 2 * v[0][1] + v[0][2]) - (v[2][0] + 2 * v[2][1] + v[2][2]);
+}
+
+// gradient magnitude clamped to 255: floor(sqrt(gx^2 + gy^2)), or
+// |gx| + |gy| when fast. Below 255^2, sqrtf of the sum is exact enough
+// that its floor matches the double one.
+template <bool FAST>
+static inline unsigned char magnitude(int gx, int gy) {
+   if (FAST) {
+      return (unsigned char) std::min(std::abs(gx) + std::abs(gy), 255);
+   }
+   int squared = gx * gx + gy * gy;
+   return squared >= 255 * 255 ? 255 : (unsigned char) sqrtf((float) squared);
+}
+
+template <bool FAST, int CHANNELS>
+static void sobelBand(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   int rowSize = width * CHANNELS;
+   std::vector<unsigned char> zeros(rowSize, 0);
+   for (int i = first; i < last; i++) {
+      const unsigned char* rows[3];
+      sobelRows<CHANNELS>(src, srcFirst, zeros.data(), width, height, i, rows);
+      const unsigned char* top = rows[0];
+      const unsigned char* mid = rows[1];
+      const unsigned char* bottom = rows[2];
+      unsigned char* out = dst + (i - first) * rowSize;
+      // interior bytes have both horizontal neighbors, CHANNELS bytes away,
+      // so every channel runs through the same vector kernel
+      if (width > 2) {
+         simd::sobelRow(top + CHANNELS, mid + CHANNELS, bottom + CHANNELS, out + CHANNELS,
+            rowSize - 2 * CHANNELS, CHANNELS, FAST);
+      }
+      // the first and last columns
+      for (int j : {0, width - 1}) {
+         for (int c = 0; c < CHANNELS; c++) {
+            int gx, gy;
+            gradientAt<CHANNELS>(rows, width, j, c, gx, gy);
+            out[j * CHANNELS + c] = magnitude<FAST>(gx, gy);
+         }
+      }
+   }
+}
+
+void sobel(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   sobelBand<false, 3>(src, srcFirst, dst, width, height, first, last);
+}
+
+void sobelFast(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   sobelBand<true, 3>(src, srcFirst, dst, width, height, first, last);
+}
+
+void sobelPlane(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   sobelBand<false, 1>(src, srcFirst, dst, width, height, first, last);
+}
+
+void sobelFastPlane(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   sobelBand<true, 1>(src, srcFirst, dst, width, height, first, last);
+}
+
+void sobelDirection(const unsigned char* src, int srcFirst, float* direction,
+   int width, int height, int first, int last) {
+   std::vector<unsigned char> zeros(width * 3, 0);
+   for (int i = first; i < last; i++) {
+      const unsigned char* rows[3];
+      sobelRows<3>(src, srcFirst, zeros.data(), width, height, i, rows);
+      const unsigned char* top = rows[0];
+      const unsigned char* mid = rows[1];
+      const unsigned char* bottom = rows[2];
+      float* out = direction + (size_t) (i - first) * width;
+      for (int j = 0; j < width; j++) {
+         bool interior = 0 < j && j < width - 1;
+         int bestX = 0, bestY = 0;
+         for (int c = 0; c < 3; c++) {
+            int gx, gy;
+            if (interior) {
+               int k = j * 3 + c;
+               gx = (top[k - 3] - top[k + 3]) + 2 * (mid[k - 3] - mid[k + 3]) +
+                  (bottom[k - 3] - bottom[k + 3]);
+               gy = (top[k - 3] + 2 * top[k] + top[k + 3]) -
+                  (bottom[k - 3] + 2 * bottom[k] + bottom[k + 3]);
+            } else {
+               gradientAt<3>(rows, width, j, c, gx, gy);
+            }
+            if (gx * gx + gy * gy > bestX * bestX + bestY * bestY) {
+               bestX = gx;
+               bestY = gy;
+            }
+         }
+         // gx and gy point towards the left and top, so negate them
+         out[j] = atan2f((float) -bestY, (float) -bestX);
+      }
+   }
+}
+
+void sharpen(const unsigned char* src, int srcFirst, unsigned char* dst,
+   int width, int height, int first, int last) {
+   int rowSize = width * 3;
+   for (int i = first; i < last; i++) {
+      const unsigned char* in = src + (i - srcFirst) * rowSize;
+      unsigned char* row = dst + (i - first) * rowSize;
+      for (int j = 0; j < width; j++) {
+         unsigned char blurred[3];
+         boxPixel<3>(src, srcFirst, width, height, i, j, blurred);
+         for (int c = 0; c < 3; c++) {
+            int x = in[j * 3 + c];
+            int detail = std::max(x - blurred[c], 0);
+            row[j * 3 + c] = std::min(detail + x, 255);
+         }
+      }
+   }
+}
+
+}  // namespace stencil
+}  // namespace agl
@@ -0,0 +1,258 @@
+/**
+ * Implementation of the streaming operator pipeline
+ *
+ * @file stream.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "stream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "pointops.h"
+#include "stencil.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace agl {
+
+// pixels per block of point-wise work (48 KB, fits in L2)
+static const int BLOCK_PIXELS = 16384;
+
+// bytes per band when the band size is chosen from the width
+static const int BAND_BYTES = 1024 * 1024;
+
+/**
+ * Each stencil stage, and the reader, is a level. A level produces bands
+ * of its output rows on request, then applies the point-wise stages
+ * recorded after it. A stencil level keeps a window of the rows of the
+ * level below that its next band needs and pulls only the rows it does
+ * not have yet, so every level reads its input once, top to bottom.
+ */
+class StreamPipeline::Runner {
+ public:
+  Runner(const StreamPipeline& pipeline, RowReader& input) :
+     _pipeline(pipeline), _input(input) {
+     this->_width = input.width();
+     this->_height = input.height();
+     this->_rowSize = (size_t) this->_width * 3;
+     const std::vector<Stage>& stages = pipeline._stages;
+     this->_levels.push_back(Level{-1, 0, 0, std::vector<unsigned char>(), 0, 0});
+     for (int s = 0; s < (int) stages.size(); s++) {
+        if (stages[s].radius > 0) {
+           this->_levels.push_back(Level{s, s + 1, s + 1, std::vector<unsigned char>(), 0, 0});
+        } else {
+           this->_levels.back().pointEnd = s + 1;
+        }
+     }
+  }
+
+  // return the number of levels
+  int size() const {
+     return (int) this->_levels.size();
+  }
+
+  // write rows [first, last) of the output of level into out
+  bool produce(int level, int first, int last, unsigned char* out) {
+     Level& lv = this->_levels[level];
+     if (lv.stencil < 0) {
+        if (!this->_input.read(out, last - first)) {
+           return false;
+        }
+     } else {
+        const Stage& stage = this->_pipeline._stages[lv.stencil];
+        int needFirst = std::max(first - stage.radius, 0);
+        int needLast = std::min(last + stage.radius, this->_height);
+        // drop the rows no later band needs
+        if (needFirst > lv.first) {
+           int keep = std::max(lv.last - needFirst, 0);
+           memmove(&lv.window[0], &lv.window[0] + (needFirst - lv.first) * this->_rowSize,
+              keep * this->_rowSize);
+           lv.first = needFirst;
+           lv.last = needFirst + keep;
+        }
+        size_t needBytes = (needLast - lv.first) * this->_rowSize;
+        if (lv.window.size() < needBytes) {
+           lv.window.resize(needBytes);
+        }
+        if (needLast > lv.last) {
+           unsigned char* rows = &lv.window[0] + (lv.last - lv.first) * this->_rowSize;
+           if (!this->produce(level - 1, lv.last, needLast, rows)) {
+              return false;
+           }
+           lv.last = needLast;
+        }
+        const unsigned char* window = &lv.window[0];
+        int windowFirst = lv.first;
+        parallelRows(last - first, this->_width, [&](int firstRow, int lastRow) {
+           stage.stencil(window, windowFirst, out + firstRow * this->_rowSize,
+              this->_width, this->_height, first + firstRow, first + lastRow);
+        });
+     }
+     this->applyPoints(lv, first, last, out);
+     return true;
+  }
+
+ private:
+  struct Level {
+    // index of the stencil stage, or -1 for the reader
+    int stencil;
+    // point-wise stages [pointBegin, pointEnd) applied to the output
+    int pointBegin;
+    int pointEnd;
+    // rows [first, last) of the level below
+    std::vector<unsigned char> window;
+    int first;
+    int last;
+  };
+
+  // run the point-wise stages of lv over output rows [first, last)
+  void applyPoints(const Level& lv, int first, int last, unsigned char* out) {
+     if (lv.pointBegin == lv.pointEnd) {
+        return;
+     }
+     const std::vector<Stage>& stages = this->_pipeline._stages;
+     size_t firstPixel = (size_t) first * this->_width;
+     int numPixels = (last - first) * this->_width;
+     parallelFor(0, numPixels, BLOCK_PIXELS, [&](int begin, int end) {
+        for (int idx = begin; idx < end; idx += BLOCK_PIXELS) {
+           int n = std::min(BLOCK_PIXELS, end - idx);
+           unsigned char* block = out + (size_t) idx * 3;
+           for (int s = lv.pointBegin; s < lv.pointEnd; s++) {
+              if (stages[s].isLut) {
+                 stages[s].table.apply(block, n);
+              } else {
+                 stages[s].point(block, firstPixel + idx, n);
+              }
+           }
+        }
+     });
+  }
+
+  const StreamPipeline& _pipeline;
+  RowReader& _input;
+  int _width;
+  int _height;
+  size_t _rowSize;
+  std::vector<Level> _levels;
+};
+
+StreamPipeline::StreamPipeline() {
+   this->_bandRows = 0;
+}
+
+StreamPipeline& StreamPipeline::swirl() {
+   return this->map("swirl", [](unsigned char* data, size_t first, int n) {
+      pointops::swirl(data, n);
+   });
+}
+
+StreamPipeline& StreamPipeline::invert() {
+   return this->lut("invert", Lut::invert());
+}
+
+StreamPipeline& StreamPipeline::grayscale() {
+   return this->map("grayscale", [](unsigned char* data, size_t first, int n) {
+      pointops::grayscale(data, n);
+   });
+}
+
+StreamPipeline& StreamPipeline::gammaCorrect(float gamma) {
+   return this->lut("gammaCorrect", Lut::gammaCorrect(gamma));
+}
+
+StreamPipeline& StreamPipeline::brighten(int percentage) {
+   return this->lut("brighten", Lut::brighten(percentage));
+}
+
+StreamPipeline& StreamPipeline::dim(int percentage) {
+   return this->lut("dim", Lut::dim(percentage));
+}
+
+StreamPipeline& StreamPipeline::fill(const Pixel& a, const Pixel& b) {
+   return this->map("fill", [a, b](unsigned char* data, size_t first, int n) {
+      pointops::fill(data, n, a, b);
+   });
+}
+
+StreamPipeline& StreamPipeline::blur() {
+   return this->stencil("blur", 1, stencil::box3);
+}
+
+StreamPipeline& StreamPipeline::sobel(const std::string& magnitude) {
+   if (magnitude != "exact" && magnitude != "fast") {
+      std::cerr << "Invalid magnitude argument!" << std::endl;
+      exit(1);
+   }
+   return this->stencil("sobel", 1, magnitude == "fast" ? stencil::sobelFast : stencil::sobel);
+}
+
+StreamPipeline& StreamPipeline::sharpen() {
+   return this->stencil("sharpen", 1, stencil::sharpen);
+}
+
+StreamPipeline& StreamPipeline::map(const std::string& name, const Pipeline::PointOp& op) {
+   this->_stages.push_back(Stage{name, 0, op, nullptr, false, Lut()});
+   return *this;
+}
+
+StreamPipeline& StreamPipeline::lut(const std::string& name, const Lut& table) {
+   if (!this->_stages.empty() && this->_stages.back().isLut) {
+      Stage& last = this->_stages.back();
+      last.name += "+" + name;
+      last.table = last.table.then(table);
+      return *this;
+   }
+   this->_stages.push_back(Stage{name, 0, nullptr, nullptr, true, table});
+   return *this;
+}
+
+StreamPipeline& StreamPipeline::stencil(const std::string& name, int radius, const StencilOp& op) {
+   this->_stages.push_back(Stage{name, std::max(radius, 1), nullptr, op, false, Lut()});
+   return *this;
+}
+
+StreamPipeline& StreamPipeline::bandRows(int rows) {
+   this->_bandRows = std::max(rows, 0);
+   return *this;
+}
+
+int StreamPipeline::size() const {
+   return (int) this->_stages.size();
+}
+
+bool StreamPipeline::run(RowReader& input, RowWriter& output) const {
+   int width = input.width();
+   int height = input.height();
+   int band = this->_bandRows;
+   if (band == 0) {
+      band = std::max(BAND_BYTES / std::max(width * 3, 1), 8);
+   }
+   trace::Scope scope("stream", width, height);
+   scope.arg("stages", this->_stages.size()).arg("bandRows", band);
+   Runner runner(*this, input);
+   std::vector<unsigned char> rows((size_t) band * width * 3);
+   for (int first = 0; first < height; first += band) {
+      int last = std::min(first + band, height);
+      if (!runner.produce(runner.size() - 1, first, last, &rows[0]) ||
+          !output.write(&rows[0], last - first)) {
+         return false;
+      }
+   }
+   return output.finish();
+}
+
+bool StreamPipeline::run(const std::string& input, const std::string& output) const {
+   std::unique_ptr<RowReader> reader = openReader(input);
+   if (!reader) {
+      return false;
+   }
+   std::unique_ptr<RowWriter> writer = openWriter(output, reader->width(), reader->height());
+   return writer && this->run(*reader, *writer);
+}
+
+}  // namespace agl
@@ -0,0 +1,135 @@
+/**
+ * Chain of operators applied to an image as it streams from a reader to a
+ * writer, holding only a few rows in memory
+ *
+ * @file stream.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_STREAM_H_
+#define AGL_STREAM_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "lut.h"
+#include "pipeline.h"
+#include "rowio.h"
+
+namespace agl {
+
+/**
+ * @brief Records operators and runs them over an image one band of rows
+ * at a time
+ *
+ * Only point-wise operators and operators that read a small neighborhood
+ * (blur, sobel, sharpen) can be streamed. Each neighborhood operator keeps
+ * a window of the rows it needs, so memory grows with the image width and
+ * the number of neighborhood operators, not with the image height. The
+ * result matches the same chain of Image operators.
+ *
+ * @verbatim
+ * StreamPipeline().blur().brighten(10).run("scan.ppm", "scan-out.qoi");
+ * @endverbatim
+ */
+class StreamPipeline {
+ public:
+  /**
+   * @brief Computes output rows [first, last) of a width by height image
+   *
+   * src holds input rows from srcFirst and includes every row within
+   * radius of [first, last) that is inside the image; see stencil.h.
+   */
+  typedef std::function<void(const unsigned char* src, int srcFirst, unsigned char* dst,
+     int width, int height, int first, int last)> StencilOp;
+
+  StreamPipeline();
+
+  // swirl the colors
+  StreamPipeline& swirl();
+
+  // Replace each pixel value "x" with 255-x
+  StreamPipeline& invert();
+
+  // Convert the image to grayscale
+  StreamPipeline& grayscale();
+
+  // Apply gamma correction
+  StreamPipeline& gammaCorrect(float gamma);
+
+  // Increase all pixel values by fixed percentage
+  StreamPipeline& brighten(int percentage);
+
+  // Decrease all pixel values by fixed percentage
+  StreamPipeline& dim(int percentage);
+
+  // Fill pixels of certain color with another color
+  StreamPipeline& fill(const Pixel& a, const Pixel& b);
+
+  // Apply simple box blur to image
+  StreamPipeline& blur();
+
+  // Accentuate edges in image, with the "exact" or "fast" magnitude (see
+  // Image::sobel)
+  StreamPipeline& sobel(const std::string& magnitude = "exact");
+
+  // Emphasize edges in image using unsharp mask filtering
+  StreamPipeline& sharpen();
+
+  // Record a custom point-wise operator
+  StreamPipeline& map(const std::string& name, const Pipeline::PointOp& op);
+
+  // Record a lookup table operator; merges with a lookup table recorded
+  // just before it
+  StreamPipeline& lut(const std::string& name, const Lut& table);
+
+  // Record a custom operator reading rows up to radius away
+  StreamPipeline& stencil(const std::string& name, int radius, const StencilOp& op);
+
+  /**
+   * @brief Set the number of rows produced per step (0 picks about 1 MB)
+   */
+  StreamPipeline& bandRows(int rows);
+
+  /**
+   * @brief Return the number of recorded operators
+   */
+  int size() const;
+
+  /**
+   * @brief Stream every row of input through the operators into output
+   */
+  bool run(RowReader& input, RowWriter& output) const;
+
+  /**
+   * @brief Stream the file input through the operators into the file
+   * output; each is PPM, PAM or QOI by its extension (see openReader)
+   */
+  bool run(const std::string& input, const std::string& output) const;
+
+ private:
+  typedef Pipeline::PointOp PointOp;
+
+  struct Stage {
+    std::string name;
+    // rows above and below needed by stencil; 0 for point-wise stages
+    int radius;
+    PointOp point;
+    StencilOp stencil;
+    // set for lookup table stages, which apply table instead of point
+    bool isLut;
+    Lut table;
+  };
+
+  // pulls bands of rows through the stages during run()
+  class Runner;
+
+  // operators in the order they were recorded
+  std::vector<Stage> _stages;
+  // rows per band, or 0 to choose from the width
+  int _bandRows;
+};
+}  // namespace agl
+#endif  // AGL_STREAM_H_
@@ -0,0 +1,202 @@
+/**
+ * Implementation of the work-stealing thread pool
+ *
+ * @file threadpool.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "threadpool.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+namespace agl {
+
+// pool and queue index of the worker running on this thread, if any
+static thread_local ThreadPool* tlsPool = nullptr;
+static thread_local int tlsIndex = -1;
+
+// pixels per band handed to parallelRows() callers
+static const int BAND_PIXELS = 32768;
+
+ThreadPool::ThreadPool(int numThreads) {
+   this->_size = std::max(numThreads, 1);
+   this->_pending = 0;
+   this->_waiting = 0;
+   this->_stop = false;
+   for (int i = 0; i < this->_size; i++) {
+      this->_queues.emplace_back(new Queue());
+   }
+   for (int i = 0; i < this->_size - 1; i++) {
+      this->_workers.emplace_back(&ThreadPool::work, this, i);
+   }
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard<std::mutex> lock(this->_sleepMutex);
+      this->_stop = true;
+   }
+   this->_wake.notify_all();
+   for (std::thread& worker : this->_workers) {
+      worker.join();
+   }
+}
+
+int ThreadPool::size() const {
+   return this->_size;
+}
+
+void ThreadPool::push(std::function<void()> task) {
+   // workers keep their own tasks; everyone else shares the last queue
+   int index = tlsPool == this ? tlsIndex : this->_size - 1;
+   {
+      std::lock_guard<std::mutex> lock(this->_queues[index]->mutex);
+      this->_queues[index]->tasks.push_back(std::move(task));
+   }
+   this->_pending++;
+   {
+      std::lock_guard<std::mutex> lock(this->_sleepMutex);
+      // a waiting caller of run() may be the only thread free to take it
+      if (this->_waiting > 0) {
+         this->_done.notify_all();
+      }
+   }
+   this->_wake.notify_one();
+}
+
+bool ThreadPool::runOne(int index) {
+   std::function<void()> task;
+   if (index >= 0) {
+      Queue& own = *this->_queues[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+         task = std::move(own.tasks.back());
+         own.tasks.pop_back();
+      }
+   }
+   for (int k = 1; !task && k <= this->_size; k++) {
+      Queue& victim = *this->_queues[(std::max(index, 0) + k) % this->_size];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+         task = std::move(victim.tasks.front());
+         victim.tasks.pop_front();
+      }
+   }
+   if (!task) {
+      return false;
+   }
+   this->_pending--;
+   task();
+   return true;
+}
+
+void ThreadPool::work(int index) {
+   tlsPool = this;
+   tlsIndex = index;
+   while (true) {
+      if (this->runOne(index)) {
+         continue;
+      }
+      std::unique_lock<std::mutex> lock(this->_sleepMutex);
+      this->_wake.wait(lock, [this] { return this->_stop || this->_pending > 0; });
+      if (this->_stop && this->_pending == 0) {
+         return;
+      }
+   }
+}
+
+void ThreadPool::run(int numTasks, const std::function<void(int)>& task) {
+   if (numTasks <= 0) {
+      return;
+   }
+   if (numTasks == 1 || this->_size == 1) {
+      for (int i = 0; i < numTasks; i++) {
+         task(i);
+      }
+      return;
+   }
+   std::atomic<int> remaining(numTasks - 1);
+   for (int i = 1; i < numTasks; i++) {
+      this->push([this, &task, &remaining, i] {
+         task(i);
+         if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(this->_sleepMutex);
+            this->_done.notify_all();
+         }
+      });
+   }
+   task(0);
+   // help with queued tasks, ours or anyone's, until ours are done; with
+   // nothing left to take, sleep instead of spinning
+   int index = tlsPool == this ? tlsIndex : -1;
+   while (remaining.load(std::memory_order_acquire) > 0) {
+      if (this->runOne(index)) {
+         continue;
+      }
+      std::unique_lock<std::mutex> lock(this->_sleepMutex);
+      this->_waiting++;
+      this->_done.wait(lock, [this, &remaining] {
+         return remaining.load(std::memory_order_acquire) == 0 || this->_pending > 0;
+      });
+      this->_waiting--;
+   }
+}
+
+static int defaultNumThreads() {
+   const char* env = getenv("AGL_NUM_THREADS");
+   if (env && atoi(env) > 0) {
+      return atoi(env);
+   }
+   return std::max((int) std::thread::hardware_concurrency(), 1);
+}
+
+static std::unique_ptr<ThreadPool>& sharedPool() {
+   static std::unique_ptr<ThreadPool> pool(new ThreadPool(defaultNumThreads()));
+   return pool;
+}
+
+ThreadPool& ThreadPool::shared() {
+   return *sharedPool();
+}
+
+void setNumThreads(int numThreads) {
+   if (numThreads <= 0) {
+      numThreads = std::max((int) std::thread::hardware_concurrency(), 1);
+   }
+   if (numThreads != sharedPool()->size()) {
+      sharedPool().reset(new ThreadPool(numThreads));
+   }
+}
+
+int numThreads() {
+   return ThreadPool::shared().size();
+}
+
+void parallelFor(int begin, int end, int grain,
+      const std::function<void(int first, int last)>& fn) {
+   int count = end - begin;
+   if (count <= 0) {
+      return;
+   }
+   ThreadPool& pool = ThreadPool::shared();
+   // a few chunks per thread so a slow chunk does not hold up the rest
+   int chunks = std::min((count + std::max(grain, 1) - 1) / std::max(grain, 1), pool.size() * 4);
+   if (chunks <= 1) {
+      fn(begin, end);
+      return;
+   }
+   pool.run(chunks, [begin, count, chunks, &fn](int i) {
+      int first = begin + (int) ((long long) count * i / chunks);
+      int last = begin + (int) ((long long) count * (i + 1) / chunks);
+      fn(first, last);
+   });
+}
+
+void parallelRows(int height, int width,
+      const std::function<void(int firstRow, int lastRow)>& fn) {
+   parallelFor(0, height, std::max(BAND_PIXELS / std::max(width, 1), 1), fn);
+}
+
+}  // namespace agl
@@ -0,0 +1,114 @@
+/**
+ * Work-stealing thread pool and the row-band scheduler used by the image
+ * operators
+ *
+ * @file threadpool.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_THREADPOOL_H_
+#define AGL_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace agl {
+
+/**
+ * @brief Fixed set of worker threads, each with its own task queue
+ *
+ * Workers take tasks from the back of their own queue and, when it is
+ * empty, steal from the front of the others. A thread waiting on run()
+ * executes queued tasks while it waits, so run() may be called from inside
+ * a task without deadlocking.
+ */
+class ThreadPool {
+ public:
+  /**
+   * @brief Start numThreads - 1 workers; the calling thread is the last one
+   */
+  explicit ThreadPool(int numThreads);
+  ~ThreadPool();
+
+  /** @brief Return the number of threads, including the caller of run()
+   */
+  int size() const;
+
+  /**
+   * @brief Call task(i) for every i in [0, numTasks) and wait for all of them
+   */
+  void run(int numTasks, const std::function<void(int)>& task);
+
+  /**
+   * @brief Return the pool shared by the image operators
+   */
+  static ThreadPool& shared();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void work(int index);
+  void push(std::function<void()> task);
+  bool runOne(int index);
+
+  // number of threads, including the caller of run()
+  int _size;
+  // one queue per worker, plus one for tasks pushed by other threads
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+  // tasks pushed and not yet started, used to put idle workers to sleep
+  std::atomic<int> _pending;
+  std::mutex _sleepMutex;
+  std::condition_variable _wake;
+  // callers of run() with nothing to take sleep on _done until a task is
+  // pushed or their own tasks finish; _waiting counts them
+  std::condition_variable _done;
+  int _waiting;
+  bool _stop;
+};
+
+/**
+ * @brief Set the number of threads used by the image operators
+ * @param numThreads The thread count, or 0 for one per hardware thread
+ *
+ * Must not be called while an operator is running. The default is taken
+ * from the AGL_NUM_THREADS environment variable, or the hardware thread
+ * count when it is unset. Results do not depend on the thread count.
+ */
+void setNumThreads(int numThreads);
+
+/** @brief Return the number of threads used by the image operators
+ */
+int numThreads();
+
+/**
+ * @brief Call fn(first, last) on sub-ranges covering [begin, end) in parallel
+ * @param grain The smallest sub-range worth handing to another thread
+ *
+ * Every index is passed to exactly one call, so operators that write only
+ * to their own indices give the same result as a serial loop.
+ */
+void parallelFor(int begin, int end, int grain,
+   const std::function<void(int first, int last)>& fn);
+
+/**
+ * @brief Call fn(firstRow, lastRow) on bands of rows of a width-wide image
+ *
+ * Bands hold enough pixels to amortize scheduling and are small enough to
+ * balance the load across threads.
+ */
+void parallelRows(int height, int width,
+   const std::function<void(int firstRow, int lastRow)>& fn);
+
+}  // namespace agl
+#endif  // AGL_THREADPOOL_H_
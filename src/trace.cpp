@@ -0,0 +1,236 @@
+/**
+ * Implementation of operator tracing
+ *
+ * @file trace.cpp
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include "bufferpool.h"
+
+namespace agl {
+namespace trace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Recorder {
+  std::atomic<bool> enabled;
+  std::mutex mutex;
+  std::vector<Event> events;
+  // event times are relative to this
+  Clock::time_point epoch;
+  std::atomic<int> numThreads;
+  std::string exitFile;
+};
+
+// write the trace named by AGL_TRACE and the summary; registered with atexit
+static void reportAtExit();
+
+// create the recorder, enabled if AGL_TRACE is set
+static Recorder* createRecorder() {
+   Recorder* recorder = new Recorder();
+   recorder->epoch = Clock::now();
+   recorder->numThreads = 0;
+   const char* env = getenv("AGL_TRACE");
+   recorder->enabled = env && *env;
+   if (recorder->enabled) {
+      recorder->exitFile = env;
+      atexit(reportAtExit);
+   }
+   return recorder;
+}
+
+static Recorder& recorder() {
+   // never destroyed, so calls traced during exit can still be recorded
+   static Recorder* recorder = createRecorder();
+   return *recorder;
+}
+
+// innermost active scope on this thread
+static thread_local Scope* current = NULL;
+
+static int threadId() {
+   static thread_local int id = recorder().numThreads++;
+   return id;
+}
+
+static std::string escape(const std::string& text) {
+   std::string escaped;
+   for (char c : text) {
+      if (c == '"' || c == '\\') {
+         escaped += '\\';
+         escaped += c;
+      } else if ((unsigned char) c < 0x20) {
+         char code[8];
+         snprintf(code, sizeof(code), "\\u%04x", c);
+         escaped += code;
+      } else {
+         escaped += c;
+      }
+   }
+   return escaped;
+}
+
+bool enabled() {
+   return recorder().enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled) {
+   recorder().enabled = enabled;
+}
+
+std::vector<Event> events() {
+   Recorder& r = recorder();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   return r.events;
+}
+
+void clear() {
+   Recorder& r = recorder();
+   std::lock_guard<std::mutex> lock(r.mutex);
+   r.events.clear();
+}
+
+bool writeChromeTrace(const std::string& filename) {
+   std::vector<Event> all = events();
+   std::ofstream out(filename);
+   out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+   out << std::fixed << std::setprecision(3);
+   for (size_t i = 0; i < all.size(); i++) {
+      const Event& e = all[i];
+      out << (i ? ",\n" : "\n")
+         << "{\"name\": \"" << escape(e.name) << "\", \"cat\": \"agl\", \"ph\": \"X\""
+         << ", \"pid\": 1, \"tid\": " << e.thread << ", \"ts\": " << e.startUs
+         << ", \"dur\": " << e.durationUs << ", \"args\": {\"width\": " << e.width
+         << ", \"height\": " << e.height << ", \"bytes\": " << e.bytesAllocated
+         << (e.args.empty() ? "" : ", ") << e.args << "}}";
+   }
+   out << "\n]}\n";
+   out.close();
+   if (!out) {
+      std::cerr << "Cannot write " << filename << std::endl;
+      return false;
+   }
+   return true;
+}
+
+void writeSummary(std::ostream& os) {
+   struct Total {
+     int calls;
+     double us;
+     double selfUs;
+     size_t bytes;
+   };
+   std::map<std::string, Total> totals;
+   double allSelfUs = 0;
+   for (const Event& e : events()) {
+      Total& total = totals[e.name];
+      total.calls++;
+      total.us += e.durationUs;
+      total.selfUs += e.selfUs;
+      total.bytes += e.bytesAllocated;
+      allSelfUs += e.selfUs;
+   }
+   std::vector<std::pair<std::string, Total>> rows(totals.begin(), totals.end());
+   std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, Total>& a,
+      const std::pair<std::string, Total>& b) { return a.second.selfUs > b.second.selfUs; });
+
+   std::ios::fmtflags flags = os.flags();
+   os << std::left << std::setw(16) << "operator" << std::right << std::setw(8) << "calls"
+      << std::setw(12) << "total ms" << std::setw(12) << "self ms" << std::setw(8) << "self %"
+      << std::setw(12) << "MB alloc" << std::endl;
+   os << std::fixed;
+   for (const auto& row : rows) {
+      const Total& t = row.second;
+      os << std::left << std::setw(16) << row.first << std::right << std::setw(8) << t.calls
+         << std::setprecision(3) << std::setw(12) << t.us / 1000 << std::setw(12) << t.selfUs / 1000
+         << std::setprecision(1) << std::setw(8) << (allSelfUs > 0 ? 100 * t.selfUs / allSelfUs : 0)
+         << std::setw(12) << t.bytes / (1024.0 * 1024.0) << std::endl;
+   }
+   os.flags(flags);
+}
+
+static void reportAtExit() {
+   Recorder& r = recorder();
+   r.enabled = false;
+   if (writeChromeTrace(r.exitFile)) {
+      std::cerr << "Trace written to " << r.exitFile << std::endl;
+   }
+   writeSummary(std::cerr);
+}
+
+Scope::Scope(const char* name, int width, int height) {
+   this->_active = enabled();
+   if (!this->_active) {
+      return;
+   }
+   this->_event.name = name;
+   this->_event.width = width;
+   this->_event.height = height;
+   this->_startBytes = BufferPool::threadBytes();
+   this->_childUs = 0;
+   this->_parent = current;
+   current = this;
+   this->_start = Clock::now();
+}
+
+Scope::~Scope() {
+   if (!this->_active) {
+      return;
+   }
+   Clock::time_point end = Clock::now();
+   Recorder& r = recorder();
+   Event& e = this->_event;
+   e.startUs = std::chrono::duration<double, std::micro>(this->_start - r.epoch).count();
+   e.durationUs = std::chrono::duration<double, std::micro>(end - this->_start).count();
+   e.selfUs = std::max(e.durationUs - this->_childUs, 0.0);
+   e.bytesAllocated = BufferPool::threadBytes() - this->_startBytes;
+   e.thread = threadId();
+   current = this->_parent;
+   if (this->_parent) {
+      this->_parent->_childUs += e.durationUs;
+   }
+   std::lock_guard<std::mutex> lock(r.mutex);
+   r.events.push_back(std::move(e));
+}
+
+Scope& Scope::arg(const char* key, double value) {
+   if (this->_active) {
+      std::ostringstream member;
+      member << (this->_event.args.empty() ? "" : ", ") << "\"" << key << "\": " << value;
+      this->_event.args += member.str();
+   }
+   return *this;
+}
+
+Scope& Scope::arg(const char* key, const std::string& value) {
+   if (this->_active) {
+      this->_event.args += (this->_event.args.empty() ? "\"" : ", \"");
+      this->_event.args += std::string(key) + "\": \"" + escape(value) + "\"";
+   }
+   return *this;
+}
+
+void Scope::setSize(int width, int height) {
+   this->_event.width = width;
+   this->_event.height = height;
+}
+
+bool Scope::active() const {
+   return this->_active;
+}
+
+}  // namespace trace
+}  // namespace agl
@@ -0,0 +1,114 @@
+/**
+ * Optional tracing of operator calls, with Chrome trace export and a
+ * summary table
+ *
+ * @file trace.h
+ * @author Keith Mburu
+ * @version 2026-10-18
+ */
+
+#ifndef AGL_TRACE_H_
+#define AGL_TRACE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace agl {
+namespace trace {
+
+/**
+ * @brief One traced call
+ */
+struct Event {
+  std::string name;
+  // parameters as JSON object members, e.g. "sigma": 8, "method": "auto"
+  std::string args;
+  int width;
+  int height;
+  // small id of the calling thread, in order of first use
+  int thread;
+  double startUs;
+  double durationUs;
+  // duration minus that of the traced calls made from inside this one
+  double selfUs;
+  // bytes of pixel buffers the calling thread acquired during the call
+  size_t bytesAllocated;
+};
+
+/**
+ * @brief Return whether calls are being recorded
+ *
+ * Tracing is off unless the AGL_TRACE environment variable names a file.
+ * Then it starts on, and at exit the Chrome trace is written to that file
+ * and the summary to stderr.
+ */
+bool enabled();
+
+/** @brief Start or stop recording calls
+ */
+void setEnabled(bool enabled);
+
+/** @brief Return a copy of the calls recorded so far, in order of return
+ */
+std::vector<Event> events();
+
+/** @brief Forget the recorded calls
+ */
+void clear();
+
+/**
+ * @brief Write the recorded calls as Chrome trace events, for
+ * chrome://tracing or ui.perfetto.dev
+ */
+bool writeChromeTrace(const std::string& filename);
+
+/**
+ * @brief Write the calls, totalled by name and sorted by self time, as a
+ * table
+ */
+void writeSummary(std::ostream& os);
+
+/**
+ * @brief Records a call from construction to destruction, if tracing is
+ * enabled when it is constructed
+ *
+ * @verbatim
+ * trace::Scope scope("blurGaussian", this->_width, this->_height);
+ * scope.arg("sigma", sigma).arg("method", method);
+ * @endverbatim
+ */
+class Scope {
+ public:
+  Scope(const char* name, int width = 0, int height = 0);
+  ~Scope();
+
+  // add a parameter to the event
+  Scope& arg(const char* key, double value);
+  Scope& arg(const char* key, const std::string& value);
+
+  // set the dimensions, when they are only known later (e.g. load)
+  void setSize(int width, int height);
+
+  // whether this call is recorded; arguments that are costly to build
+  // can be skipped otherwise
+  bool active() const;
+
+ private:
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  bool _active;
+  Event _event;
+  std::chrono::steady_clock::time_point _start;
+  size_t _startBytes;
+  double _childUs;
+  // enclosing scope on this thread
+  Scope* _parent;
+};
+
+}  // namespace trace
+}  // namespace agl
+#endif  // AGL_TRACE_H_